@@ -1,3 +1,5 @@
+#define _GNU_SOURCE // asprintf
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -6,6 +8,9 @@
 #include "filereader.h"
 #include "config.h"
 #include "vm.h"
+#include "loader.h"
+#include "bytecodefile.h"
+#include "trace.h"
 
 #define CONFIG_FILE "build/.bolt_vm_config.yml"
 
@@ -13,9 +18,11 @@ char* getUsage(char* prog_name) {
     char* verbose = "\t-v, --verbose:\tDisplay the internal VM state at each execution cycle\n";
     char* memory = "\t-m, --memory:\tDisplay the amount of memory configured in your configuration file then stop running\n";
     char* config = "\t-c, --config [CONFIG_FILE_PATH]: Use your own custom configuration file for memory limits; the default configuration will be used if your file is missing or has improper values\n";
+    char* bytecode = "\t-b, --bytecode [OUTPUT_FILE_PATH]: Convert FILE to a binary bytecode file that can be run in place of FILE then stop running\n";
+    char* pairs = "\t-p, --pairs:\tRun FILE without superinstructions and display how often each pair of opcodes executed in sequence\n";
     char* help = "\t-h, --help:\tShow this help message\n";
     char* message = "";
-    asprintf(&message, "Usage: %s FILE [OPTIONS]\nOPTIONS:\n%s%s%s%s", prog_name, verbose, memory, config, help);
+    asprintf(&message, "Usage: %s FILE [OPTIONS]\nOPTIONS:\n%s%s%s%s%s%s", prog_name, verbose, memory, config, bytecode, pairs, help);
     return message;
 }
 
@@ -23,7 +30,9 @@ int main(int argc, char** argv) {
     char filename[256];
     bool verbose = false;
     bool showMemory = false;
-    char config_file[256];
+    bool showPairs = false;
+    char config_file[256] = "";
+    char bytecode_file[256] = "";
     switch(argc) {
         case 2:
             if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0) {
@@ -39,6 +48,7 @@ int main(int argc, char** argv) {
         case 3:
             strncpy(filename, argv[1], strlen(argv[1]) + 1);
             verbose = (strcmp(argv[2], "-v") == 0 || strcmp(argv[2], "--verbose") == 0);
+            showPairs = (strcmp(argv[2], "-p") == 0 || strcmp(argv[2], "--pairs") == 0);
             break;
         case 4:
             if (strcmp(argv[1], "-m") == 0 || strcmp(argv[1], "--memory") == 0) {
@@ -55,6 +65,8 @@ int main(int argc, char** argv) {
                 strncpy(filename, argv[1], strlen(argv[1]) + 1);
                 if (strcmp(argv[2], "-c") == 0 || strcmp(argv[2], "--config") == 0)
                     strncpy(config_file, argv[3], strlen(argv[3]) + 1);
+                else if (strcmp(argv[2], "-b") == 0 || strcmp(argv[2], "--bytecode") == 0)
+                    strncpy(bytecode_file, argv[3], strlen(argv[3]) + 1);
             }
             break;
         case 5:
@@ -85,7 +97,25 @@ int main(int argc, char** argv) {
         return 0;
     }
 
-    SourceCode* src = read_file(filename);
+    if (strlen(bytecode_file) != 0) {
+        SourceCode* src = read_file(filename);
+        if (src == NULL || !loadSourceCode(src))
+            return -1;
+        bool converted = writeBytecodeFile(src, bytecode_file, hashFile(filename));
+        if (!converted)
+            fprintf(stderr, "Error: Could not write bytecode file '%s'\n", bytecode_file);
+        deleteSourceCode(src);
+        return converted ? 0 : -1;
+    }
+    SourceCode* src;
+    if (showPairs) {
+        // fused programs would hide the pairs worth fusing, so skip the cache and the fusion pass
+        src = read_file(filename);
+        if (src == NULL || !decodeSourceCode(src, false))
+            return -1;
+    }
+    else
+        src = isBytecodeFile(filename) ? readBytecodeFile(filename) : readSourceWithCache(filename, verbose);
     if (src == NULL)
         return -1;
     if (verbose) {
@@ -95,7 +125,11 @@ int main(int argc, char** argv) {
     VM* vm = init(src, conf);
     if (vm == NULL)
         return -1;
+    if (showPairs)
+        enablePairHistogram(vm);
     ExitCode runStatus = run(vm, verbose);
+    if (showPairs)
+        displayPairHistogram(vm);
 
     destroy(vm);
     deleteSourceCode(src);
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE // asprintf
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,203 +8,324 @@
 #include "builtin.h"
 #include "impl_builtin.h"
 
-bool isBuiltinFunction(char* name) {
-    char* builtins[] = {
-        "print",
-        "println",
-        "printerr",
-        "_length_s",
-        "_length_a",
-        "capacity",
-        "getType",
-        "max",
-        "min",
-        "replace",
-        "replaceAll",
-        "split",
-        "_slice_s",
-        "_slice_a",
-        "append",
-        "prepend",
-        "insert",
-        "_remove_indx_a",
-        "_remove_val_a",
-        "_remove_all_val_a",
-        "_contains_s",
-        "_contains_a",
-        "indexOf",
-        "toString",
-        "_toInt_s",
-        "_toInt_d",
-        "_toDouble_s",
-        "_toDouble_i",
-        "at",
-        "join",
-        "_reverse_s",
-        "_reverse_a",
-        "sort",
-        "startsWith",
-        "endsWith",
-        "sleep",
-        "exit",
-        "fileExists",
-        "createFile",
-        "readFile",
-        "writeToFile",
-        "appendToFile",
-        "renameFile",
-        "deleteFile",
-        "getEnv",
-        "setEnv"
-    };
-    int end = 45;
-    for (int i = 0; i < end; i++) {
-        if (strcmp(name, builtins[i]) == 0)
-            return true;
-    }
-    return false;
+DataConstant builtinPrint(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    print(params[0], false);
+    return createNone();
 }
 
-DataConstant callBuiltinFunction(char* name, int argc, DataConstant* params, VM* vm, Frame* frame, bool* globalsExpanded, bool verbose) {
-    if (strcmp(name, "print") == 0)
-        print(params[0], false);
-    if (strcmp(name, "println") == 0)
-        print(params[0], true);
-    if (strcmp(name, "printerr") == 0) {
-        if (argc == 1)
-            printerr(params[0], false, 0);
-        else
-            printerr(params[0], params[1].value.boolVal, params[2].value.intVal);
-    }
-    if (strcmp(name, "_length_s") == 0)
-        return createInt((int) strlen(params[0].value.strVal));
-    if (strcmp(name, "_length_a") == 0)
-        return createInt(params[0].length);
-    if (strcmp(name, "capacity") == 0)
-        return createInt(params[0].size);
-    if (strcmp(name, "getType") == 0)
-        return createString(getType(params[0]));
-    if (strcmp(name, "max") == 0)
-        return getMax(params[0], params[1]);
-    if (strcmp(name, "min") == 0)
-        return getMax(params[0], params[1]);
-    if (strcmp(name, "replace") == 0)
-        return createString(replace(params[0].value.strVal, params[1].value.strVal, params[2].value.strVal, false));
-    if (strcmp(name, "replaceAll") == 0)
-        return createString(replace(params[0].value.strVal, params[1].value.strVal, params[2].value.strVal, true));
-    if (strcmp(name, "split") == 0) {
-        char* delim = argc == 2 ? params[1].value.strVal : NULL;
-        return splitString(params[0].value.strVal, delim, vm, frame, globalsExpanded, verbose);
-    }
-    if (strcmp(name, "_slice_s") == 0) {
-        char* string = params[0].value.strVal;
-        int end = argc == 2 ? (int) strlen(string) : params[2].value.intVal;
-        return createString(slice(string, params[1].value.intVal, end, &vm->state));
-    }
-    if (strcmp(name, "_slice_a") == 0) {
-        DataConstant array = params[0];
-        int end = argc == 2 ? array.length : params[2].value.intVal;
-        return sliceArr(array, params[1].value.intVal, end, vm, frame, globalsExpanded, verbose);
-    }
-    if (strcmp(name, "append") == 0) {
-        DataConstant array = params[0];
-        append(&array, params[1], &vm->state);
-        return array;
-    }
-    if (strcmp(name, "prepend") == 0) {
-        DataConstant array = params[0];
-        prepend(&array, params[1], &vm->state);
-        return array;
-    }
-    if (strcmp(name, "insert") == 0) {
-        DataConstant array = params[0];
-        insert(&array, params[1], params[2].value.intVal, &vm->state);
-        return array;
-    }
-    if (strcmp(name, "_remove_indx_a") == 0) {
-        int index = params[1].value.intVal;
+DataConstant builtinPrintln(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    print(params[0], true);
+    return createNone();
+}
+
+DataConstant builtinPrinterr(int argc, DataConstant* params, UNUSED VM* vm) {
+    if (argc == 1)
+        printerr(params[0], false, 0);
+    else
+        printerr(params[0], asBool(params[1]), argc == 3 ? asInt(params[2]) : 0);
+    return createNone();
+}
+
+DataConstant builtinLengthStr(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createInt((int) getStringLength(params[0]));
+}
+
+DataConstant builtinLengthArr(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createInt(getArrayHeader(params[0])->length);
+}
+
+DataConstant builtinCapacity(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createInt(getArrayHeader(params[0])->capacity);
+}
+
+DataConstant builtinGetType(UNUSED int argc, DataConstant* params, VM* vm) {
+    return adoptString(vm, getType(params[0]));
+}
+
+DataConstant builtinMax(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return getMax(params[0], params[1]);
+}
+
+DataConstant builtinMin(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return getMin(params[0], params[1]);
+}
+
+DataConstant builtinReplace(UNUSED int argc, DataConstant* params, VM* vm) {
+    return adoptString(vm, replace(asString(params[0]), asString(params[1]), asString(params[2]), false));
+}
+
+DataConstant builtinReplaceAll(UNUSED int argc, DataConstant* params, VM* vm) {
+    return adoptString(vm, replace(asString(params[0]), asString(params[1]), asString(params[2]), true));
+}
+
+DataConstant builtinSplit(int argc, DataConstant* params, VM* vm) {
+    char* delim = argc == 2 ? asString(flattenString(vm, params[1])) : NULL;
+    return splitString(params[0], delim, vm);
+}
+
+DataConstant builtinSliceStr(int argc, DataConstant* params, VM* vm) {
+    int end = argc == 2 ? (int) getStringLength(params[0]) : asInt(params[2]);
+    return slice(params[0], asInt(params[1]), end, vm);
+}
+
+DataConstant builtinSliceArr(int argc, DataConstant* params, VM* vm) {
+    DataConstant array = params[0];
+    int end = argc == 2 ? getArrayHeader(array)->length : asInt(params[2]);
+    return sliceArr(array, asInt(params[1]), end, vm);
+}
+
+DataConstant builtinAppend(UNUSED int argc, DataConstant* params, VM* vm) {
+    DataConstant array = params[0];
+    if (!unshareArray(vm, array))
+        return createNone();
+    append(&array, params[1], &vm->state);
+    return array;
+}
+
+DataConstant builtinPrepend(UNUSED int argc, DataConstant* params, VM* vm) {
+    DataConstant array = params[0];
+    if (!unshareArray(vm, array))
+        return createNone();
+    prepend(&array, params[1], &vm->state);
+    return array;
+}
+
+DataConstant builtinInsert(UNUSED int argc, DataConstant* params, VM* vm) {
+    DataConstant array = params[0];
+    if (!unshareArray(vm, array))
+        return createNone();
+    insert(&array, params[1], asInt(params[2]), &vm->state);
+    return array;
+}
+
+DataConstant builtinRemoveIndex(UNUSED int argc, DataConstant* params, VM* vm) {
+    int index = asInt(params[1]);
+    if (!unshareArray(vm, params[0]))
+        return createNone();
+    removeByIndex(&params[0], index, &vm->state);
+    return params[0];
+}
+
+DataConstant builtinRemoveValue(UNUSED int argc, DataConstant* params, VM* vm) {
+    int index = indexOf(params[0], params[1]);
+    if (index != -1 && !unshareArray(vm, params[0]))
+        return createNone();
+    if (index != -1)
         removeByIndex(&params[0], index, &vm->state);
+    return params[0];
+}
+
+DataConstant builtinRemoveAllValues(UNUSED int argc, DataConstant* params, VM* vm) {
+    if (indexOf(params[0], params[1]) == -1)
         return params[0];
-    }
-    if (strcmp(name, "_remove_val_a") == 0) {
-        int index = indexOf(params[0], params[1]);
-        if (index != -1)
-            removeByIndex(&params[0], index, &vm->state);
-        return params[0];
-    }
-    if (strcmp(name, "_remove_all_val_a") == 0) {
-        int index = indexOf(params[0], params[1]);
-        while (index != -1) {
-            removeByIndex(&params[0], index, &vm->state);
-            index = indexOf(params[0], params[1]);
-        }
-        return params[0];
-    }
-    if (strcmp(name, "_contains_s") == 0)
-        return createBoolean(contains(params[0].value.strVal, params[1].value.strVal));
-    if (strcmp(name, "_contains_a") == 0)
-        return createBoolean(arrayContains(params[0], params[1]));
-    if (strcmp(name, "indexOf") == 0)
-        return createInt(indexOf(params[0], params[1]));
-    if (strcmp(name, "toString") == 0)
-        return createString(toString(params[0]));
-    if (strcmp(name, "_toInt_s") == 0)
-        return createInt(atoi(params[0].value.strVal));
-    if (strcmp(name, "_toInt_d") == 0)
-        return createInt((int) lround(params[0].value.dblVal));
-    if (strcmp(name, "_toDouble_s") == 0)
-        return createDouble(atof(params[0].value.strVal));
-    if (strcmp(name, "_toDouble_i") == 0)
-        return createDouble((double) params[0].value.intVal);
-    if (strcmp(name, "at") == 0)
-        return createString(at(params[0].value.strVal, params[1].value.intVal, &vm->state));
-    if (strcmp(name, "join") == 0) {
-        char* delim = argc == 1 ? "" : params[1].value.strVal;
-        return createString(join(params[0], delim));
-    }
-    if (strcmp(name, "_reverse_s") == 0)
-        return createString(reverse(params[0].value.strVal));
-    if (strcmp(name, "_reverse_a") == 0) {
-        reverseArr(params[0]);
-        return params[0];
-    }
-    if (strcmp(name, "sort") == 0)
-        sort(params[0]);
-    if (strcmp(name, "startsWith") == 0)
-        return createBoolean(startsWith_(params[0].value.strVal, params[1].value.strVal));
-    if (strcmp(name, "endsWith") == 0)
-        return createBoolean(endsWith(params[0].value.strVal, params[1].value.strVal));
-    if (strcmp(name, "sleep") == 0)
-        sleep_(params[0]);
-    if (strcmp(name, "exit") == 0) {
-        if (argc == 1)
-            exit(params[0].value.intVal);
-        exit(0);
-    }
-    if (strcmp(name, "fileExists") == 0)
-        return createBoolean(fileExists(params[0].value.strVal));
-    if (strcmp(name, "createFile") == 0)
-        createFile(params[0].value.strVal, &vm->state);
-    if (strcmp(name, "readFile") == 0)
-        return readFile(params[0].value.strVal, vm, frame, globalsExpanded, verbose);
-    if (strcmp(name, "writeToFile") == 0)
-        writeToFile(params[0].value.strVal, params[1].value.strVal, "w", &vm->state);
-    if (strcmp(name, "appendToFile") == 0)
-        writeToFile(params[0].value.strVal, params[1].value.strVal, "a", &vm->state);
-    if (strcmp(name, "renameFile") == 0)
-        renameFile(params[0].value.strVal, params[1].value.strVal, &vm->state);
-    if (strcmp(name, "deleteFile") == 0)
-        deleteFile(params[0].value.strVal, &vm->state);
-    if (strcmp(name, "getEnv") == 0)
-        return createString(getenv(params[0].value.strVal));
-    if (strcmp(name, "setEnv") == 0) {
-        char* envStr;
-        asprintf(&envStr, "%s=%s", params[0].value.strVal, params[1].value.strVal);
-        int set = putenv(envStr);
-        if (set != 0) {
-            fprintf(stderr, "Failed to set environment variable\n");
-            *&vm->state = (ExitCode) set;
-        }
+    if (!unshareArray(vm, params[0]))
+        return createNone();
+    removeAllValues(params[0], params[1]);
+    return params[0];
+}
+
+DataConstant builtinContainsStr(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createBoolean(contains(asString(params[0]), asString(params[1])));
+}
+
+DataConstant builtinContainsArr(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createBoolean(arrayContains(params[0], params[1]));
+}
+
+DataConstant builtinIndexOf(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createInt(indexOf(params[0], params[1]));
+}
+
+DataConstant builtinToString(UNUSED int argc, DataConstant* params, VM* vm) {
+    return adoptString(vm, toString(params[0]));
+}
+
+DataConstant builtinStrToInt(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createInt(atoi(asString(params[0])));
+}
+
+DataConstant builtinDoubleToInt(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createInt((int) lround(asDouble(params[0])));
+}
+
+DataConstant builtinStrToDouble(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createDouble(atof(asString(params[0])));
+}
+
+DataConstant builtinIntToDouble(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createDouble((double) asInt(params[0]));
+}
+
+DataConstant builtinAt(UNUSED int argc, DataConstant* params, VM* vm) {
+    return at(params[0], asInt(params[1]), vm);
+}
+
+DataConstant builtinJoin(int argc, DataConstant* params, VM* vm) {
+    char* delim = argc == 1 ? "" : asString(params[1]);
+    return adoptString(vm, join(params[0], delim));
+}
+
+DataConstant builtinReverseStr(UNUSED int argc, DataConstant* params, VM* vm) {
+    return adoptString(vm, reverse(asString(params[0])));
+}
+
+DataConstant builtinReverseArr(UNUSED int argc, DataConstant* params, VM* vm) {
+    if (!unshareArray(vm, params[0]))
+        return createNone();
+    reverseArr(params[0]);
+    return params[0];
+}
+
+DataConstant builtinSort(UNUSED int argc, DataConstant* params, VM* vm) {
+    if (!unshareArray(vm, params[0]))
+        return createNone();
+    sort(params[0]);
+    return createNone();
+}
+
+DataConstant builtinStartsWith(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createBoolean(startsWith_(asString(params[0]), asString(params[1])));
+}
+
+DataConstant builtinEndsWith(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createBoolean(endsWith(asString(params[0]), asString(params[1])));
+}
+
+DataConstant builtinSleep(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    sleep_(params[0]);
+    return createNone();
+}
+
+DataConstant builtinExit(int argc, DataConstant* params, UNUSED VM* vm) {
+    if (argc == 1)
+        exit(asInt(params[0]));
+    exit(0);
+}
+
+DataConstant builtinFileExists(UNUSED int argc, DataConstant* params, UNUSED VM* vm) {
+    return createBoolean(fileExists(asString(params[0])));
+}
+
+DataConstant builtinCreateFile(UNUSED int argc, DataConstant* params, VM* vm) {
+    createFile(asString(params[0]), &vm->state);
+    return createNone();
+}
+
+DataConstant builtinReadFile(UNUSED int argc, DataConstant* params, VM* vm) {
+    return readFile(asString(params[0]), vm);
+}
+
+DataConstant builtinWriteToFile(UNUSED int argc, DataConstant* params, VM* vm) {
+    writeToFile(asString(params[0]), asString(params[1]), "w", &vm->state);
+    return createNone();
+}
+
+DataConstant builtinAppendToFile(UNUSED int argc, DataConstant* params, VM* vm) {
+    writeToFile(asString(params[0]), asString(params[1]), "a", &vm->state);
+    return createNone();
+}
+
+DataConstant builtinRenameFile(UNUSED int argc, DataConstant* params, VM* vm) {
+    renameFile(asString(params[0]), asString(params[1]), &vm->state);
+    return createNone();
+}
+
+DataConstant builtinDeleteFile(UNUSED int argc, DataConstant* params, VM* vm) {
+    deleteFile(asString(params[0]), &vm->state);
+    return createNone();
+}
+
+DataConstant builtinGetEnv(UNUSED int argc, DataConstant* params, VM* vm) {
+    char* value = getenv(asString(params[0]));
+    return value == NULL ? createString(NULL) : adoptString(vm, strdup(value));
+}
+
+DataConstant builtinSetEnv(UNUSED int argc, DataConstant* params, VM* vm) {
+    char* envStr;
+    asprintf(&envStr, "%s=%s", asString(params[0]), asString(params[1]));
+    int set = putenv(envStr);
+    if (set != 0) {
+        fprintf(stderr, "Failed to set environment variable\n");
+        vm->state = (ExitCode) set;
     }
     return createNone();
+}
+
+BuiltinFunction builtinTable[BUILTIN_COUNT] = {
+    {"print", 1, 1, builtinPrint, false},
+    {"println", 1, 1, builtinPrintln, false},
+    {"printerr", 1, 3, builtinPrinterr, false},
+    {"_length_s", 1, 1, builtinLengthStr, true},
+    {"_length_a", 1, 1, builtinLengthArr, false},
+    {"capacity", 1, 1, builtinCapacity, false},
+    {"getType", 1, 1, builtinGetType, false},
+    {"max", 2, 2, builtinMax, false},
+    {"min", 2, 2, builtinMin, false},
+    {"replace", 3, 3, builtinReplace, false},
+    {"replaceAll", 3, 3, builtinReplaceAll, false},
+    {"split", 1, 2, builtinSplit, true},
+    {"_slice_s", 2, 3, builtinSliceStr, true},
+    {"_slice_a", 2, 3, builtinSliceArr, false},
+    {"append", 2, 2, builtinAppend, false},
+    {"prepend", 2, 2, builtinPrepend, false},
+    {"insert", 3, 3, builtinInsert, false},
+    {"_remove_indx_a", 2, 2, builtinRemoveIndex, false},
+    {"_remove_val_a", 2, 2, builtinRemoveValue, false},
+    {"_remove_all_val_a", 2, 2, builtinRemoveAllValues, false},
+    {"_contains_s", 2, 2, builtinContainsStr, false},
+    {"_contains_a", 2, 2, builtinContainsArr, false},
+    {"indexOf", 2, 2, builtinIndexOf, false},
+    {"toString", 1, 1, builtinToString, false},
+    {"_toInt_s", 1, 1, builtinStrToInt, false},
+    {"_toInt_d", 1, 1, builtinDoubleToInt, false},
+    {"_toDouble_s", 1, 1, builtinStrToDouble, false},
+    {"_toDouble_i", 1, 1, builtinIntToDouble, false},
+    {"at", 2, 2, builtinAt, true},
+    {"join", 1, 2, builtinJoin, false},
+    {"_reverse_s", 1, 1, builtinReverseStr, false},
+    {"_reverse_a", 1, 1, builtinReverseArr, false},
+    {"sort", 1, 1, builtinSort, false},
+    {"startsWith", 2, 2, builtinStartsWith, false},
+    {"endsWith", 2, 2, builtinEndsWith, false},
+    {"sleep", 1, 1, builtinSleep, false},
+    {"exit", 0, 1, builtinExit, false},
+    {"fileExists", 1, 1, builtinFileExists, false},
+    {"createFile", 1, 1, builtinCreateFile, false},
+    {"readFile", 1, 1, builtinReadFile, false},
+    {"writeToFile", 2, 2, builtinWriteToFile, false},
+    {"appendToFile", 2, 2, builtinAppendToFile, false},
+    {"renameFile", 2, 2, builtinRenameFile, false},
+    {"deleteFile", 1, 1, builtinDeleteFile, false},
+    {"getEnv", 1, 1, builtinGetEnv, false},
+    {"setEnv", 2, 2, builtinSetEnv, false}
+};
+
+int getBuiltinId(char* name) {
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        if (strcmp(name, builtinTable[i].name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+bool isBuiltinFunction(char* name) {
+    return getBuiltinId(name) != -1;
+}
+
+bool checkBuiltinArity(int id, int argc) {
+    BuiltinFunction builtin = builtinTable[id];
+    if (argc >= builtin.minArgs && argc <= builtin.maxArgs)
+        return true;
+    if (builtin.minArgs == builtin.maxArgs)
+        fprintf(stderr, "Error: builtin function '%s' expects %d arguments but received %d\n", builtin.name, builtin.minArgs, argc);
+    else
+        fprintf(stderr, "Error: builtin function '%s' expects %d to %d arguments but received %d\n", builtin.name, builtin.minArgs, builtin.maxArgs, argc);
+    return false;
+}
+
+DataConstant callBuiltinFunction(char* name, int argc, DataConstant* params, VM* vm) {
+    int id = getBuiltinId(name);
+    if (id == -1)
+        return createNone();
+    return builtinTable[id].handler(argc, params, vm);
 }
\ No newline at end of file
@@ -8,7 +8,23 @@
 #include "dataconstant.h"
 #include "exitcode.h"
 
+#define BUILTIN_COUNT 46
+
+typedef DataConstant (*BuiltinHandler)(int argc, DataConstant* params, VM* vm);
+
+typedef struct {
+    char* name;
+    int minArgs;
+    int maxArgs;
+    BuiltinHandler handler;
+    bool readsViews; // takes string views as they are instead of a NUL terminated copy
+} BuiltinFunction;
+
+extern BuiltinFunction builtinTable[BUILTIN_COUNT];
+
+int getBuiltinId(char* name);
 bool isBuiltinFunction(char* name);
-DataConstant callBuiltinFunction(char* name, int argc, DataConstant* params, VM* vm, Frame* frame, bool* globalsExpanded, bool verbose);
+bool checkBuiltinArity(int id, int argc);
+DataConstant callBuiltinFunction(char* name, int argc, DataConstant* params, VM* vm);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "bytecode.h"
+
+static char* opcodeNames[OPCODE_COUNT] = {
+    [UNKNOWN] = "UNKNOWN",
+    [HALT] = "HALT",
+    [LOAD_CONST] = "LOAD_CONST",
+    [DUP] = "DUP",
+    [POP] = "POP",
+    [CONCAT] = "CONCAT",
+    [REPEATSTR] = "REPEATSTR",
+    [ADD] = "ADD",
+    [SUB] = "SUB",
+    [MUL] = "MUL",
+    [DIV] = "DIV",
+    [REM] = "REM",
+    [POW] = "POW",
+    [EQ] = "EQ",
+    [NE] = "NE",
+    [LT] = "LT",
+    [LE] = "LE",
+    [GT] = "GT",
+    [GE] = "GE",
+    [NOT] = "NOT",
+    [OR] = "OR",
+    [AND] = "AND",
+    [XOR] = "XOR",
+    [B_AND] = "B_AND",
+    [STORE] = "STORE",
+    [LOAD] = "LOAD",
+    [GSTORE] = "GSTORE",
+    [GLOAD] = "GLOAD",
+    [JMP] = "JMP",
+    [JMPT] = "JMPT",
+    [JMPF] = "JMPF",
+    [SJMPT] = "SJMPT",
+    [SJMPF] = "SJMPF",
+    [EJMPT] = "EJMPT",
+    [EJMPF] = "EJMPF",
+    [EJMP] = "EJMP",
+    [SELECT] = "SELECT",
+    [CALL] = "CALL",
+    [CALL_BUILTIN] = "CALL",
+    [RET] = "RET",
+    [BUILDARR] = "BUILDARR",
+    [COPYARR] = "COPYARR",
+    [AGET] = "AGET",
+    [ASTORE] = "ASTORE",
+    [INC_LOCAL] = "INC_LOCAL",
+    [CMP_LOCALS_EJMPF] = "CMP_LOCALS_EJMPF",
+    [CMP_LOCAL_CONST_EJMPF] = "CMP_LOCAL_CONST_EJMPF",
+    [LOAD_AGET] = "LOAD_AGET",
+    [ADD_INT_INT] = "ADD_INT_INT",
+    [ADD_DBL_DBL] = "ADD_DBL_DBL",
+    [SUB_INT_INT] = "SUB_INT_INT",
+    [SUB_DBL_DBL] = "SUB_DBL_DBL",
+    [MUL_INT_INT] = "MUL_INT_INT",
+    [MUL_DBL_DBL] = "MUL_DBL_DBL",
+    [EQ_INT_INT] = "EQ_INT_INT",
+    [EQ_DBL_DBL] = "EQ_DBL_DBL",
+    [NE_INT_INT] = "NE_INT_INT",
+    [NE_DBL_DBL] = "NE_DBL_DBL",
+    [LT_INT_INT] = "LT_INT_INT",
+    [LT_DBL_DBL] = "LT_DBL_DBL",
+    [LE_INT_INT] = "LE_INT_INT",
+    [LE_DBL_DBL] = "LE_DBL_DBL",
+    [GT_INT_INT] = "GT_INT_INT",
+    [GT_DBL_DBL] = "GT_DBL_DBL",
+    [GE_INT_INT] = "GE_INT_INT",
+    [GE_DBL_DBL] = "GE_DBL_DBL"
+};
+
+// operand type -> specialized opcode for every instruction adaptive quickening can rewrite
+static Opcode specializations[OPCODE_COUNT][None + 1] = {
+    [ADD] = {[Int] = ADD_INT_INT, [Dbl] = ADD_DBL_DBL},
+    [SUB] = {[Int] = SUB_INT_INT, [Dbl] = SUB_DBL_DBL},
+    [MUL] = {[Int] = MUL_INT_INT, [Dbl] = MUL_DBL_DBL},
+    [EQ] = {[Int] = EQ_INT_INT, [Dbl] = EQ_DBL_DBL},
+    [NE] = {[Int] = NE_INT_INT, [Dbl] = NE_DBL_DBL},
+    [LT] = {[Int] = LT_INT_INT, [Dbl] = LT_DBL_DBL},
+    [LE] = {[Int] = LE_INT_INT, [Dbl] = LE_DBL_DBL},
+    [GT] = {[Int] = GT_INT_INT, [Dbl] = GT_DBL_DBL},
+    [GE] = {[Int] = GE_INT_INT, [Dbl] = GE_DBL_DBL}
+};
+
+static Opcode genericOpcodes[OPCODE_COUNT] = {
+    [ADD_INT_INT] = ADD,
+    [ADD_DBL_DBL] = ADD,
+    [SUB_INT_INT] = SUB,
+    [SUB_DBL_DBL] = SUB,
+    [MUL_INT_INT] = MUL,
+    [MUL_DBL_DBL] = MUL,
+    [EQ_INT_INT] = EQ,
+    [EQ_DBL_DBL] = EQ,
+    [NE_INT_INT] = NE,
+    [NE_DBL_DBL] = NE,
+    [LT_INT_INT] = LT,
+    [LT_DBL_DBL] = LT,
+    [LE_INT_INT] = LE,
+    [LE_DBL_DBL] = LE,
+    [GT_INT_INT] = GT,
+    [GT_DBL_DBL] = GT,
+    [GE_INT_INT] = GE,
+    [GE_DBL_DBL] = GE
+};
+
+Opcode getOpcode(char* mnemonic) {
+    for (int i = UNKNOWN + 1; i < FIRST_SUPERINSTRUCTION; i++) {
+        if (strcmp(opcodeNames[i], mnemonic) == 0)
+            return (Opcode) i;
+    }
+    return UNKNOWN;
+}
+
+char* getOpcodeName(Opcode opcode) {
+    if (opcode < 0 || opcode >= OPCODE_COUNT)
+        return opcodeNames[UNKNOWN];
+    return opcodeNames[opcode];
+}
+
+bool isComparison(Opcode opcode) {
+    return opcode >= EQ && opcode <= GE;
+}
+
+ComparisonOperator getComparisonOperator(Opcode opcode) {
+    return (ComparisonOperator) (opcode - EQ); // the comparison opcodes are declared in the same order
+}
+
+/**
+ * Rewrite a generic instruction in place into its variant for two operands of the given type
+ * Instructions that keep deoptimizing have mixed operand types and are left generic
+*/
+void quickenInstruction(Instruction* instr, Datatype type) {
+    if (instr->operands[1] >= MAX_DEOPTIMIZATIONS || specializations[instr->opcode][type] == UNKNOWN)
+        return;
+    instr->opcode = specializations[instr->opcode][type];
+}
+
+/**
+ * Turn a specialized instruction that saw other operand types back into its generic opcode
+*/
+void deoptimizeInstruction(Instruction* instr) {
+    instr->opcode = genericOpcodes[instr->opcode];
+    instr->operands[1] = instr->operands[1] == NO_OPERAND ? 1 : instr->operands[1] + 1;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdbool.h>
+
+#include "dataconstant.h"
+
+typedef enum {
+    UNKNOWN = 0,
+    HALT,
+    LOAD_CONST,
+    DUP,
+    POP,
+    CONCAT,
+    REPEATSTR,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    REM,
+    POW,
+    EQ, // EQ to GE follow the order of ComparisonOperator
+    NE,
+    LT,
+    LE,
+    GT,
+    GE,
+    NOT,
+    OR,
+    AND,
+    XOR,
+    B_AND,
+    STORE,
+    LOAD,
+    GSTORE,
+    GLOAD,
+    JMP,
+    JMPT,
+    JMPF,
+    SJMPT,
+    SJMPF,
+    EJMPT,
+    EJMPF,
+    EJMP,
+    SELECT,
+    CALL,
+    CALL_BUILTIN, // CALL resolved to a builtin function at link time
+    RET,
+    BUILDARR,
+    COPYARR,
+    AGET,
+    ASTORE,
+    // superinstructions are only created by the loader's fusion pass
+    INC_LOCAL, // LOAD n LOAD_CONST k ADD STORE n
+    CMP_LOCALS_EJMPF, // LOAD a LOAD b <comparison> EJMPF
+    CMP_LOCAL_CONST_EJMPF, // LOAD a LOAD_CONST k <comparison> EJMPF
+    LOAD_AGET, // LOAD array LOAD index AGET
+    // specialized instructions are only created at runtime by adaptive quickening and fall back to their generic opcode on other operand types
+    ADD_INT_INT,
+    ADD_DBL_DBL,
+    SUB_INT_INT,
+    SUB_DBL_DBL,
+    MUL_INT_INT,
+    MUL_DBL_DBL,
+    EQ_INT_INT,
+    EQ_DBL_DBL,
+    NE_INT_INT,
+    NE_DBL_DBL,
+    LT_INT_INT,
+    LT_DBL_DBL,
+    LE_INT_INT,
+    LE_DBL_DBL,
+    GT_INT_INT,
+    GT_DBL_DBL,
+    GE_INT_INT,
+    GE_DBL_DBL,
+    OPCODE_COUNT
+} Opcode;
+
+#define FIRST_SUPERINSTRUCTION INC_LOCAL
+
+#define NO_OPERAND -1
+
+// a specializable instruction deoptimized this many times stays generic
+#define MAX_DEOPTIMIZATIONS 4
+
+/**
+ * A decoded instruction
+ * Instructions are stored at the index of their opcode in the function body so pc, return addresses and jump points keep their meaning
+ * width is the number of tokens (opcode + operands) the instruction spans; operand slots are never executed
+ * block is the index of the jump point that starts at this instruction or NO_OPERAND
+ * Superinstructions span the instructions they replace, which stay in place so their operands can still be read
+ * Specializable instructions count their deoptimizations in operands[1], which is NO_OPERAND until the first one
+*/
+typedef struct {
+    Opcode opcode;
+    int width;
+    int block;
+    int operands[3];
+} Instruction;
+
+Opcode getOpcode(char* mnemonic);
+bool isComparison(Opcode opcode);
+ComparisonOperator getComparisonOperator(Opcode opcode);
+char* getOpcodeName(Opcode opcode);
+void quickenInstruction(Instruction* instr, Datatype type);
+void deoptimizeInstruction(Instruction* instr);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,460 @@
+#define _GNU_SOURCE // asprintf
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bytecodefile.h"
+#include "loader.h"
+#include "builtin.h"
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+} ByteBuffer;
+
+size_t appendBytes(ByteBuffer* buffer, void* bytes, size_t size) {
+    if (buffer->length + size > buffer->capacity) {
+        while (buffer->length + size > buffer->capacity)
+            buffer->capacity *= 2;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+    size_t offset = buffer->length;
+    if (bytes != NULL)
+        memcpy(buffer->data + offset, bytes, size);
+    else
+        memset(buffer->data + offset, 0, size);
+    buffer->length += size;
+    return offset;
+}
+
+size_t alignBuffer(ByteBuffer* buffer) {
+    size_t padding = (8 - buffer->length % 8) % 8;
+    appendBytes(buffer, NULL, padding);
+    return buffer->length;
+}
+
+uint32_t appendString(ByteBuffer* strings, char* string) {
+    return (uint32_t) appendBytes(strings, string, strlen(string) + 1);
+}
+
+bool isBytecodeFile(char* filename) {
+    char magic[4];
+    FILE* fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return false;
+    size_t read = fread(magic, 1, sizeof(magic), fp);
+    fclose(fp);
+    return read == sizeof(magic) && memcmp(magic, BYTECODE_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * Write decoded and linked source code so it can be mapped and run without parsing
+*/
+bool writeBytecodeFile(SourceCode* src, char* filename, uint64_t sourceHash) {
+    ByteBuffer image = {malloc(4096), 0, 4096};
+    ByteBuffer strings = {malloc(4096), 0, 4096};
+    BytecodeHeader header;
+    memcpy(header.magic, BYTECODE_MAGIC, sizeof(header.magic));
+    header.version = BYTECODE_VERSION;
+    header.sourceHash = sourceHash;
+    header.buildHash = getBuildHash();
+    header.functionCount = src->length;
+    appendBytes(&image, &header, sizeof(BytecodeHeader));
+    header.functionTableOffset = alignBuffer(&image);
+    appendBytes(&image, NULL, sizeof(FunctionEntry) * src->length);
+
+    Function* func;
+    FunctionEntry entry;
+    for (int i = 0; i < src->length; i++) {
+        func = &src->code[i];
+        entry.label = appendString(&strings, func->label);
+        entry.tokenCount = func->body->length;
+        entry.constCnt = func->constCnt;
+        entry.jmpCnt = func->jmpCnt;
+
+        entry.tokensOffset = alignBuffer(&image);
+        for (int j = 0; j < func->body->length; j++) {
+            uint32_t token = appendString(&strings, getFromSV(func->body, j));
+            appendBytes(&image, &token, sizeof(uint32_t));
+        }
+
+        entry.bytecodeOffset = alignBuffer(&image);
+        appendBytes(&image, func->bytecode, sizeof(Instruction) * (func->body->length + 1));
+
+        entry.constantsOffset = alignBuffer(&image);
+        for (int j = 0; j < func->constCnt; j++) {
+            DataConstant constant = func->constants[j];
+            ConstantEntry constEntry = {valueType(constant), 0, 0};
+            if (valueType(constant) == Int)
+                constEntry.value = asInt(constant);
+            else if (valueType(constant) == Bool)
+                constEntry.value = asBool(constant);
+            else if (valueType(constant) == Dbl)
+                constEntry.dblVal = asDouble(constant);
+            else if (valueType(constant) == Str)
+                constEntry.value = appendString(&strings, asString(constant));
+            appendBytes(&image, &constEntry, sizeof(ConstantEntry));
+        }
+
+        entry.jumpsOffset = alignBuffer(&image);
+        for (int j = 0; j < func->jmpCnt; j++) {
+            JumpEntry jump = {appendString(&strings, func->jumpPoints[j].label), func->jumpPoints[j].start, func->jumpPoints[j].end};
+            appendBytes(&image, &jump, sizeof(JumpEntry));
+        }
+        memcpy(image.data + header.functionTableOffset + sizeof(FunctionEntry) * i, &entry, sizeof(FunctionEntry));
+    }
+
+    header.stringTableOffset = alignBuffer(&image);
+    header.stringTableSize = strings.length;
+    appendBytes(&image, strings.data, strings.length);
+    header.fileSize = image.length;
+    memcpy(image.data, &header, sizeof(BytecodeHeader));
+
+    // write next to the target and rename so concurrent runs never map a partially written file
+    bool written = false;
+    char* tempFile;
+    asprintf(&tempFile, "%s.%d.tmp", filename, (int) getpid());
+    FILE* fp = fopen(tempFile, "wb");
+    if (fp != NULL) {
+        written = fwrite(image.data, 1, image.length, fp) == image.length;
+        written = fclose(fp) == 0 && written;
+        written = written && rename(tempFile, filename) == 0;
+        if (!written)
+            remove(tempFile);
+    }
+    free(tempFile);
+    free(strings.data);
+    free(image.data);
+    return written;
+}
+
+/**
+ * Check that count entries of size bytes starting at offset are aligned and lie inside the file
+*/
+bool isValidSection(BytecodeHeader* header, uint32_t offset, uint32_t count, size_t size) {
+    return offset % 8 == 0 && offset >= sizeof(BytecodeHeader) && (uint64_t) offset + (uint64_t) count * size <= header->fileSize;
+}
+
+bool isValidString(BytecodeHeader* header, int64_t offset) {
+    return offset >= 0 && offset < header->stringTableSize;
+}
+
+bool isValidIndex(int index, uint32_t count) {
+    return index >= 0 && (uint32_t) index < count;
+}
+
+bool isValidTarget(int pc, uint32_t tokenCount) {
+    return pc >= 0 && (uint32_t) pc <= tokenCount;
+}
+
+/**
+ * Check every operand the interpreter uses without bounds checks: opcodes, widths, jump targets, pool indices and call targets
+ * Jumps can land on any slot so every slot is checked, not just the ones reached by stepping over widths
+*/
+bool validateInstructions(FunctionEntry* entry, Instruction* bytecode, uint32_t functionCount) {
+    Instruction* instr;
+    if (bytecode[entry->tokenCount].opcode != UNKNOWN || bytecode[entry->tokenCount].operands[0] != NO_OPERAND)
+        return false;
+    for (uint32_t pc = 0; pc < entry->tokenCount; pc++) {
+        instr = &bytecode[pc];
+        if ((uint32_t) instr->opcode >= OPCODE_COUNT || instr->width < 1 || pc + instr->width > entry->tokenCount)
+            return false;
+        if (instr->block != NO_OPERAND && !isValidIndex(instr->block, entry->jmpCnt))
+            return false;
+        switch (instr->opcode) {
+            case UNKNOWN:
+                if (instr->operands[0] != NO_OPERAND && !isValidIndex(instr->operands[0], entry->tokenCount))
+                    return false;
+                break;
+            case LOAD_CONST:
+                if (!isValidIndex(instr->operands[0], entry->constCnt))
+                    return false;
+                break;
+            case JMP:
+            case JMPT:
+            case JMPF:
+            case SJMPT:
+            case SJMPF:
+                if (!isValidIndex(instr->operands[1], entry->tokenCount))
+                    return false;
+                if (instr->operands[2] != NO_OPERAND && (!isValidIndex(instr->operands[2], entry->jmpCnt) || !isValidTarget(instr->operands[0], entry->tokenCount)))
+                    return false;
+                break;
+            case EJMPT:
+            case EJMPF:
+                if (!isValidTarget(instr->operands[0], entry->tokenCount))
+                    return false;
+                break;
+            case CALL:
+                if (!isValidIndex(instr->operands[1], entry->tokenCount))
+                    return false;
+                if (instr->operands[2] != NO_OPERAND && !isValidIndex(instr->operands[2], functionCount))
+                    return false;
+                break;
+            case CALL_BUILTIN:
+                if (!isValidIndex(instr->operands[2], BUILTIN_COUNT))
+                    return false;
+                break;
+            case INC_LOCAL:
+                if (!isValidIndex(instr->operands[1], entry->constCnt))
+                    return false;
+                break;
+            case CMP_LOCAL_CONST_EJMPF:
+                if (!isValidIndex(instr->operands[1], entry->constCnt))
+                    return false;
+                // fall through
+            case CMP_LOCALS_EJMPF:
+                if (instr->operands[2] < EQ || instr->operands[2] > GE || bytecode[pc + instr->width - 1].opcode != EJMPF)
+                    return false; // the fused EJMPF's target is checked with its own slot
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+/**
+ * Check that every section, string and index of a mapped file stays inside the file so a truncated or corrupt file is rejected before it is run
+*/
+bool validateBytecodeFile(char* map, BytecodeHeader* header) {
+    if (!isValidSection(header, header->functionTableOffset, header->functionCount, sizeof(FunctionEntry)))
+        return false;
+    if (!isValidSection(header, header->stringTableOffset, header->stringTableSize, 1) || header->stringTableSize == 0)
+        return false;
+    char* strings = map + header->stringTableOffset;
+    if (strings[header->stringTableSize - 1] != '\0')
+        return false;
+    FunctionEntry* entries = (FunctionEntry*) (map + header->functionTableOffset);
+    for (uint32_t i = 0; i < header->functionCount; i++) {
+        FunctionEntry* entry = &entries[i];
+        if (!isValidString(header, entry->label) || entry->jmpCnt > 16)
+            return false;
+        if (!isValidSection(header, entry->tokensOffset, entry->tokenCount, sizeof(uint32_t)) || !isValidSection(header, entry->bytecodeOffset, entry->tokenCount + 1, sizeof(Instruction)))
+            return false;
+        if (!isValidSection(header, entry->constantsOffset, entry->constCnt, sizeof(ConstantEntry)) || !isValidSection(header, entry->jumpsOffset, entry->jmpCnt, sizeof(JumpEntry)))
+            return false;
+        uint32_t* tokens = (uint32_t*) (map + entry->tokensOffset);
+        for (uint32_t j = 0; j < entry->tokenCount; j++) {
+            if (!isValidString(header, tokens[j]))
+                return false;
+        }
+        ConstantEntry* constants = (ConstantEntry*) (map + entry->constantsOffset);
+        for (uint32_t j = 0; j < entry->constCnt; j++) {
+            if (constants[j].type == Str && !isValidString(header, constants[j].value))
+                return false;
+        }
+        JumpEntry* jumps = (JumpEntry*) (map + entry->jumpsOffset);
+        for (uint32_t j = 0; j < entry->jmpCnt; j++) {
+            if (!isValidString(header, jumps[j].label) || !isValidTarget(jumps[j].start, entry->tokenCount) || !isValidTarget(jumps[j].end, entry->tokenCount))
+                return false;
+        }
+        if (!validateInstructions(entry, (Instruction*) (map + entry->bytecodeOffset), header->functionCount))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Map a bytecode file into memory and point the source code at it
+ * Instructions are used in place; the mapping is private so quickening the code never touches the file
+*/
+SourceCode* readBytecodeFile(char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd == -1) {
+        perror("Error");
+        fprintf(stderr, "Cause: '%s'\n", filename);
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size < (off_t) sizeof(BytecodeHeader)) {
+        fprintf(stderr, "Error: '%s' is not a valid bytecode file\n", filename);
+        close(fd);
+        return NULL;
+    }
+    char* map = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error");
+        fprintf(stderr, "Cause: '%s'\n", filename);
+        return NULL;
+    }
+    BytecodeHeader* header = (BytecodeHeader*) map;
+    if (memcmp(header->magic, BYTECODE_MAGIC, sizeof(header->magic)) != 0 || header->fileSize != (uint32_t) info.st_size || header->functionCount > 256) {
+        fprintf(stderr, "Error: '%s' is not a valid bytecode file\n", filename);
+        munmap(map, info.st_size);
+        return NULL;
+    }
+    if (header->version != BYTECODE_VERSION) {
+        fprintf(stderr, "Error: '%s' was built for bytecode version %u but this VM runs version %d\n", filename, header->version, BYTECODE_VERSION);
+        munmap(map, info.st_size);
+        return NULL;
+    }
+    if (header->buildHash != getBuildHash()) {
+        fprintf(stderr, "Error: '%s' was written by a build of the VM with different opcodes or builtins\n", filename);
+        munmap(map, info.st_size);
+        return NULL;
+    }
+    if (!validateBytecodeFile(map, header)) {
+        fprintf(stderr, "Error: '%s' is not a valid bytecode file\n", filename);
+        munmap(map, info.st_size);
+        return NULL;
+    }
+
+    char* strings = map + header->stringTableOffset;
+    FunctionEntry* entries = (FunctionEntry*) (map + header->functionTableOffset);
+    SourceCode* src = malloc(sizeof(SourceCode));
+    src->length = header->functionCount;
+    src->loaded = true;
+    src->mapping = map;
+    src->mappingSize = info.st_size;
+    for (int i = 0; i < src->length; i++) {
+        FunctionEntry entry = entries[i];
+        Function* func = &src->code[i];
+        func->label = strings + entry.label;
+
+        uint32_t* tokens = (uint32_t*) (map + entry.tokensOffset);
+        func->body = createStringVector();
+        func->body->capacity = entry.tokenCount + 1;
+        func->body->strings = realloc(func->body->strings, sizeof(char*) * func->body->capacity);
+        for (uint32_t j = 0; j < entry.tokenCount; j++) {
+            func->body->strings[j] = strings + tokens[j];
+        }
+        func->body->length = entry.tokenCount;
+
+        func->bytecode = (Instruction*) (map + entry.bytecodeOffset);
+
+        ConstantEntry* constants = (ConstantEntry*) (map + entry.constantsOffset);
+        func->constCnt = entry.constCnt;
+        func->constants = malloc(sizeof(DataConstant) * (entry.constCnt > 0 ? entry.constCnt : 1));
+        for (uint32_t j = 0; j < entry.constCnt; j++) {
+            switch (constants[j].type) {
+                case Int:
+                    func->constants[j] = createInt(constants[j].value);
+                    break;
+                case Bool:
+                    func->constants[j] = createBoolean(constants[j].value);
+                    break;
+                case Dbl:
+                    func->constants[j] = createDouble(constants[j].dblVal);
+                    break;
+                case Str:
+                    func->constants[j] = createString(strings + constants[j].value);
+                    break;
+                case Null:
+                    func->constants[j] = createNull();
+                    break;
+                default:
+                    func->constants[j] = createNone();
+                    break;
+            }
+        }
+
+        JumpEntry* jumps = (JumpEntry*) (map + entry.jumpsOffset);
+        func->jmpCnt = entry.jmpCnt;
+        for (int j = 0; j < func->jmpCnt; j++) {
+            func->jumpPoints[j] = (JumpPoint) {strings + jumps[j].label, jumps[j].start, jumps[j].end};
+        }
+    }
+    return src;
+}
+
+uint64_t hashBytes(uint64_t hash, void* bytes, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash ^= ((unsigned char*) bytes)[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t hashFile(char* filename) {
+    uint64_t hash = 14695981039346656037ULL; // 64 bit FNV-1a
+    FILE* fp = fopen(filename, "rb");
+    if (fp == NULL)
+        return 0;
+    unsigned char buff[4096];
+    size_t read;
+    while ((read = fread(buff, 1, sizeof(buff), fp)) > 0) {
+        hash = hashBytes(hash, buff, read);
+    }
+    fclose(fp);
+    return hash;
+}
+
+/**
+ * Hash everything compiled into this VM that a bytecode file depends on: the opcode and builtin numbering, the datatype tags and the instruction layout
+ * Files written by a build that differs in any of them are rejected even when BYTECODE_VERSION was not bumped
+*/
+uint64_t getBuildHash() {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < OPCODE_COUNT; i++) {
+        char* name = getOpcodeName(i);
+        hash = hashBytes(hash, name, strlen(name) + 1);
+    }
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        hash = hashBytes(hash, builtinTable[i].name, strlen(builtinTable[i].name) + 1);
+        hash = hashBytes(hash, &builtinTable[i].minArgs, sizeof(builtinTable[i].minArgs));
+        hash = hashBytes(hash, &builtinTable[i].maxArgs, sizeof(builtinTable[i].maxArgs));
+    }
+    Datatype types[] = {Int, Dbl, Str, Bool, Null, None};
+    hash = hashBytes(hash, types, sizeof(types));
+    size_t layout[] = {sizeof(Instruction), offsetof(Instruction, operands), sizeof(BytecodeHeader), sizeof(FunctionEntry), sizeof(ConstantEntry), sizeof(JumpEntry)};
+    return hashBytes(hash, layout, sizeof(layout));
+}
+
+char* getCachePath(char* filename) {
+    char* cachePath;
+    asprintf(&cachePath, "%s.bbc", filename);
+    return cachePath;
+}
+
+/**
+ * Map the cached conversion of a source file if it was written by this build of the VM from the same text
+ * Returns NULL without reporting anything when there is no cache for this text; a corrupt cache is reported and rebuilt by the caller
+*/
+SourceCode* readCachedBytecode(char* cachePath, uint64_t sourceHash) {
+    BytecodeHeader header;
+    FILE* fp = fopen(cachePath, "rb");
+    if (fp == NULL)
+        return NULL;
+    size_t read = fread(&header, sizeof(BytecodeHeader), 1, fp);
+    fclose(fp);
+    if (read != 1 || memcmp(header.magic, BYTECODE_MAGIC, sizeof(header.magic)) != 0)
+        return NULL;
+    if (header.version != BYTECODE_VERSION || header.buildHash != getBuildHash() || header.sourceHash != sourceHash)
+        return NULL;
+    return readBytecodeFile(cachePath);
+}
+
+/**
+ * Load a text source file through its bytecode cache, refreshing the cache when the text changed
+*/
+SourceCode* readSourceWithCache(char* filename, bool verbose) {
+    uint64_t sourceHash = hashFile(filename);
+    char* cachePath = getCachePath(filename);
+    SourceCode* src = readCachedBytecode(cachePath, sourceHash);
+    if (src != NULL) {
+        if (verbose)
+            printf("INFO: Using cached bytecode '%s'\n", cachePath);
+        free(cachePath);
+        return src;
+    }
+    src = read_file(filename);
+    if (src != NULL) {
+        if (!loadSourceCode(src)) {
+            deleteSourceCode(src);
+            src = NULL;
+        }
+        else if (!writeBytecodeFile(src, cachePath, sourceHash) && verbose)
+            printf("INFO: Could not write bytecode cache '%s'\n", cachePath);
+    }
+    free(cachePath);
+    return src;
+}
\ No newline at end of file
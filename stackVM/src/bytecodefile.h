@@ -0,0 +1,64 @@
+#ifndef BYTECODEFILE_H
+#define BYTECODEFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "filereader.h"
+
+#define BYTECODE_MAGIC "BOLT"
+#define BYTECODE_VERSION 4 // bump whenever the file layout changes; opcode, builtin and Instruction changes are caught by buildHash
+
+/**
+ * Binary bytecode container
+ * Layout: header, function table, per function sections (tokens, instructions, constants, jumps), string table
+ * Every offset is relative to the start of the file and every section is 8 byte aligned
+ * Values are stored in the byte order of the machine that wrote the file
+ * sourceHash identifies the text the file was converted from so it can double as a cache
+ * buildHash identifies the opcode, builtin and datatype numbering of the VM that wrote the file
+*/
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceHash;
+    uint64_t buildHash;
+    uint32_t fileSize;
+    uint32_t functionCount;
+    uint32_t functionTableOffset;
+    uint32_t stringTableOffset;
+    uint32_t stringTableSize;
+} BytecodeHeader;
+
+typedef struct {
+    uint32_t label; // string table offset
+    uint32_t tokenCount;
+    uint32_t tokensOffset; // string table offset of every token, only read for error messages
+    uint32_t bytecodeOffset; // tokenCount + 1 linked instructions
+    uint32_t constantsOffset;
+    uint32_t constCnt;
+    uint32_t jumpsOffset;
+    uint32_t jmpCnt;
+} FunctionEntry;
+
+typedef struct {
+    uint32_t type;
+    int32_t value; // int, bool or string table offset
+    double dblVal;
+} ConstantEntry;
+
+typedef struct {
+    uint32_t label; // string table offset
+    int32_t start;
+    int32_t end;
+} JumpEntry;
+
+bool isBytecodeFile(char* filename);
+bool writeBytecodeFile(SourceCode* src, char* filename, uint64_t sourceHash);
+SourceCode* readBytecodeFile(char* filename);
+uint64_t hashFile(char* filename);
+uint64_t getBuildHash();
+char* getCachePath(char* filename);
+SourceCode* readCachedBytecode(char* cachePath, uint64_t sourceHash);
+SourceCode* readSourceWithCache(char* filename, bool verbose);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "collector.h"
+
+int hashString(char* string, int mask) {
+    uint64_t hash = (uint64_t) (uintptr_t) string * 11400714819323198485ULL; // Fibonacci hashing spreads the aligned addresses
+    return (int) (hash >> 32) & mask;
+}
+
+StringSet buildStringSet(VM* vm) {
+    StringSet set;
+    int capacity = 16;
+    while (capacity < vm->stringCount * 2) {
+        capacity *= 2;
+    }
+    set.slots = malloc(sizeof(int) * capacity);
+    set.mask = capacity - 1;
+    set.marked = calloc(vm->stringCount > 0 ? vm->stringCount : 1, sizeof(bool));
+    for (int i = 0; i < capacity; i++) {
+        set.slots[i] = NO_OPERAND;
+    }
+    int slot;
+    for (int i = 0; i < vm->stringCount; i++) {
+        slot = hashString(vm->strings[i], set.mask);
+        while (set.slots[slot] != NO_OPERAND) {
+            slot = (slot + 1) & set.mask;
+        }
+        set.slots[slot] = i;
+    }
+    return set;
+}
+
+void markString(VM* vm, StringSet* set, char* string) {
+    int slot = hashString(string, set->mask);
+    while (set->slots[slot] != NO_OPERAND) {
+        if (vm->strings[set->slots[slot]] == string) {
+            set->marked[set->slots[slot]] = true;
+            return;
+        }
+        slot = (slot + 1) & set->mask;
+    }
+}
+
+void markValues(VM* vm, StringSet* set, DataConstant* values, int count);
+
+/**
+ * Mark a rope and its parts, walking down whichever side is a rope so ropes built in a loop do not recurse once per part
+*/
+void markRope(VM* vm, StringSet* set, RopeNode* rope) {
+    while (!rope->marked) {
+        rope->marked = true;
+        if (rope->flat != NULL) {
+            markString(vm, set, rope->flat);
+            return;
+        }
+        if (valueType(rope->left) == Rope && valueType(rope->right) == Rope) {
+            markRope(vm, set, getRope(rope->right));
+            rope = getRope(rope->left);
+        }
+        else if (valueType(rope->left) == Rope) {
+            markValues(vm, set, &rope->right, 1);
+            rope = getRope(rope->left);
+        }
+        else if (valueType(rope->right) == Rope) {
+            markValues(vm, set, &rope->left, 1);
+            rope = getRope(rope->right);
+        }
+        else {
+            markValues(vm, set, &rope->left, 1);
+            markValues(vm, set, &rope->right, 1);
+            return;
+        }
+    }
+}
+
+void markValues(VM* vm, StringSet* set, DataConstant* values, int count) {
+    ArrayHeader* array;
+    ViewNode* view;
+    for (int i = 0; i < count; i++) {
+        if (valueType(values[i]) == Str && asString(values[i]) != NULL)
+            markString(vm, set, asString(values[i]));
+        else if (valueType(values[i]) == Rope)
+            markRope(vm, set, getRope(values[i]));
+        else if (valueType(values[i]) == View) {
+            view = getView(values[i]);
+            view->marked = true;
+            markString(vm, set, view->parent != NULL ? view->parent : view->flat);
+        }
+        else if (valueType(values[i]) == Addr) {
+            array = getArrayHeader(values[i]);
+            if (array->marked)
+                continue;
+            array->marked = true;
+            markValues(vm, set, array->storage->values, array->capacity);
+        }
+    }
+}
+
+/**
+ * Free every string, rope, view and array the program can no longer reach
+ * Roots are the stacks and locals of the active frames, the globals and the pinned values; arrays are followed to their elements
+ * Only called where every value still in use is in one of the roots
+*/
+void collectGarbage(VM* vm) {
+    for (ArrayHeader* array = vm->arrays; array != NULL; array = array->next) {
+        array->marked = false;
+    }
+    for (RopeNode* rope = vm->ropes; rope != NULL; rope = rope->next) {
+        rope->marked = false;
+    }
+    for (ViewNode* view = vm->views; view != NULL; view = view->next) {
+        view->marked = false;
+    }
+    StringSet set = buildStringSet(vm);
+    Frame* frame;
+    for (int i = 0; i <= vm->fp; i++) {
+        frame = vm->callStack[i];
+        markValues(vm, &set, frame->stack, frame->sp + 1);
+        markValues(vm, &set, frame->locals, frame->lp + 1);
+    }
+    markValues(vm, &set, vm->globals, vm->gp + 1);
+    for (Pin* pin = vm->pins; pin != NULL; pin = pin->next) {
+        markValues(vm, &set, &pin->value, 1);
+    }
+
+    long freedBytes = 0;
+    int live = 0;
+    for (int i = 0; i < vm->stringCount; i++) {
+        if (set.marked[i])
+            vm->strings[live++] = vm->strings[i];
+        else {
+            freedBytes += strlen(vm->strings[i]) + 1;
+            free(vm->strings[i]);
+        }
+    }
+    vm->stringCount = live;
+    vm->stringBytes -= freedBytes;
+
+    RopeNode** ropeLink = &vm->ropes;
+    RopeNode* rope;
+    while (*ropeLink != NULL) {
+        rope = *ropeLink;
+        if (rope->marked)
+            ropeLink = &rope->next;
+        else {
+            *ropeLink = rope->next;
+            vm->stringBytes -= sizeof(RopeNode);
+            freedBytes += sizeof(RopeNode);
+            free(rope);
+        }
+    }
+
+    ViewNode** viewLink = &vm->views;
+    ViewNode* view;
+    while (*viewLink != NULL) {
+        view = *viewLink;
+        if (view->marked)
+            viewLink = &view->next;
+        else {
+            *viewLink = view->next;
+            vm->stringBytes -= sizeof(ViewNode);
+            freedBytes += sizeof(ViewNode);
+            free(view);
+        }
+    }
+
+    long arrayBytes;
+    ArrayHeader** link = &vm->arrays;
+    ArrayHeader* array;
+    while (*link != NULL) {
+        array = *link;
+        if (array->marked)
+            link = &array->next;
+        else {
+            *link = array->next;
+            arrayBytes = sizeof(ArrayHeader);
+            if (--array->storage->refs == 0) { // copies that are still reachable keep shared storage alive
+                arrayBytes += sizeof(ArrayStorage) + sizeof(DataConstant) * array->capacity;
+                free(array->storage);
+            }
+            vm->heapBytes -= arrayBytes;
+            freedBytes += arrayBytes;
+            free(array);
+        }
+    }
+
+    long liveBytes = vm->stringBytes + vm->heapBytes;
+    vm->collectionThreshold = liveBytes * 2 > MIN_COLLECTION_THRESHOLD ? liveBytes * 2 : MIN_COLLECTION_THRESHOLD;
+    free(set.slots);
+    free(set.marked);
+    if (vm->hooks != NULL && vm->hooks->onCollect != NULL)
+        vm->hooks->onCollect(vm, freedBytes);
+}
\ No newline at end of file
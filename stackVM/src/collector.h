@@ -0,0 +1,21 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include "vm.h"
+
+// string and array bytes a program may hold before the first collection
+#define MIN_COLLECTION_THRESHOLD (1 << 20)
+
+/**
+ * Index of the VM's strings by address, rebuilt for every collection
+ * Strings that are not in the set (constants, literals) are never freed by the collector
+*/
+typedef struct {
+    int* slots; // index into vm->strings or NO_OPERAND
+    int mask;
+    bool* marked; // one flag per index into vm->strings
+} StringSet;
+
+void collectGarbage(VM* vm);
+
+#endif
\ No newline at end of file
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE // asprintf
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -47,6 +49,7 @@ VMConfig getDefaultConfig() {
     VMConfig conf;
     conf.dynamicResourceExpansionEnabled = true;
     conf.useHeapStorageBackup = true;
+    conf.adaptiveSpecializationEnabled = true;
     conf.framesSoftMax = 1 << 9;
     conf.framesHardMax = 1 << 10;
     conf.stackSizeSoftMax = 1 << 10;
@@ -109,6 +112,9 @@ VMConfig readConfigFile(char* filePath) {
                     if (strcmp(key, "HeapStorageBackup") == 0) {
                         conf.useHeapStorageBackup = (strcmp(value, "disabled") != 0);
                     }
+                    if (strcmp(key, "AdaptiveSpecialization") == 0) {
+                        conf.adaptiveSpecializationEnabled = (strcmp(value, "disabled") != 0);
+                    }
                     if (strcmp(key, "frames_soft_max") == 0) {
                         conf.framesSoftMax = (short) processValue(value, filePath, line);
                     }
@@ -184,6 +190,7 @@ void printEstimatedMemory(VMConfig conf) {
 void displayVMConfig(VMConfig conf) {
     printf("DynamicResourceExpansion: %s\n", conf.dynamicResourceExpansionEnabled ? "enabled" : "disabled");
     printf("HeapStorageBackup: %s\n", conf.useHeapStorageBackup ? "enabled" : "disabled");
+    printf("AdaptiveSpecialization: %s\n", conf.adaptiveSpecializationEnabled ? "enabled" : "disabled");
     printf("frames_soft_max: %hd frames\n", conf.framesSoftMax);
     printf("frames_hard_max: %hd frames\n", conf.framesHardMax);
     printf("stack_size_soft_max: %ld B (%ld values)\n", conf.stackSizeSoftMax, conf.stackSizeSoftMax / sizeof(DataConstant));
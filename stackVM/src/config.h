@@ -6,6 +6,7 @@
 typedef struct {
     bool dynamicResourceExpansionEnabled;
     bool useHeapStorageBackup;
+    bool adaptiveSpecializationEnabled;
     short framesSoftMax;
     short framesHardMax;
     long globalsSoftMax;
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE // asprintf
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -6,353 +8,289 @@
 
 #include "dataconstant.h"
 
+/**
+ * Describe a value in a newly allocated string
+*/
 char* toString(DataConstant data) {
     char* string = "";
-    if (data.type == Int)
-        asprintf(&string, "%d", data.value.intVal);
-    if (data.type == Dbl)
-        asprintf(&string, "%f", data.value.dblVal);
-    if (data.type == Addr)
-        asprintf(&string, "%p (%d)", getArrayStart(data), data.size);
-    if (data.type == Bool)
-        return data.value.boolVal ? "true" : "false";
-    if (data.type == Str) {
-        asprintf(&string, "\"%s\"", data.value.strVal);
+    if (valueType(data) == Int)
+        asprintf(&string, "%d", asInt(data));
+    if (valueType(data) == Dbl)
+        asprintf(&string, "%f", asDouble(data));
+    if (valueType(data) == Addr)
+        asprintf(&string, "%p (%d)", getArrayStart(data), getArrayHeader(data)->capacity);
+    if (valueType(data) == Bool)
+        string = strdup(asBool(data) ? "true" : "false");
+    if (valueType(data) == Str) {
+        asprintf(&string, "\"%s\"", asString(data));
     }
-    if (data.type == Null)
-        return "null";
-    if (data.type == None)
-        return "None";
+    if (valueType(data) == Rope) {
+        char* characters = writeRope(getRope(data));
+        asprintf(&string, "\"%s\"", characters);
+        free(characters);
+    }
+    if (valueType(data) == View)
+        asprintf(&string, "\"%.*s\"", (int) getView(data)->length, getView(data)->start);
+    if (valueType(data) == Null)
+        string = strdup("null");
+    if (valueType(data) == None)
+        string = strdup("None");
     return string;
 }
 
 DataConstant readInt(char* value) {
-    DataConstant data;
-    data.size = 1;
-    data.length = 1;
-    data.type = Int;
-    data.value.intVal = atoi(value);
-    return data;
-}
-
-DataConstant createInt(int value) {
-    DataConstant data;
-    data.size = 1;
-    data.length = 1;
-    data.type = Int;
-    data.value.intVal = value;
-    return data;
+    return createInt(atoi(value));
 }
 
 DataConstant readDouble(char* value) {
-    DataConstant data;
-    data.size = 1;
-    data.length = 1;
-    data.type = Dbl;
-    data.value.dblVal = atof(value);
-    return data;
-}
-
-DataConstant createDouble(double value) {
-    DataConstant data;
-    data.size = 1;
-    data.length = 1;
-    data.type = Dbl;
-    data.value.dblVal = value;
-    return data;
+    return createDouble(atof(value));
 }
 
 DataConstant readBoolean(char* value) {
-    DataConstant data;
-    data.type = Bool;
-    data.size = 1;
-    data.length = 1;
-    data.value.boolVal = strcmp(value, "true") == 0;
-    return data;
+    return createBoolean(strcmp(value, "true") == 0);
 }
 
-DataConstant createBoolean(bool value) {
-    DataConstant data;
-    data.type = Bool;
-    data.size = 1;
-    data.length = 1;
-    data.value.boolVal = value;
-    return data;
+bool isZero(DataConstant data) {
+    if (valueType(data) == Dbl)
+        return asDouble(data) == 0;
+    if (valueType(data) == Int)
+        return asInt(data) == 0;
+    return false;
 }
 
-DataConstant createString(char* value) {
-    DataConstant data;
-    data.type = Str;
-    data.size = 1;
-    data.length = 1;
-    data.value.strVal = value;
-    return data;
+bool isEqual(DataConstant lhs, DataConstant rhs) {
+    if (valueType(lhs) == Int && (valueType(rhs) == Int || valueType(rhs) == Dbl))
+        return valueType(rhs) == Int ? asInt(lhs) == asInt(rhs) : asInt(lhs) == asDouble(rhs);
+    if (valueType(lhs) == Dbl && (valueType(rhs) == Int || valueType(rhs) == Dbl))
+        return valueType(rhs) == Dbl ? asDouble(lhs) == asDouble(rhs) : asDouble(lhs) == asInt(rhs);
+    if (valueType(lhs) == Bool && valueType(rhs) == Bool)
+        return asBool(lhs) == asBool(rhs);
+    if ((valueType(lhs) == Str || valueType(lhs) == View) && (valueType(rhs) == Str || valueType(rhs) == View)) {
+        long length = getStringLength(lhs);
+        if (length != getStringLength(rhs))
+            return false;
+        return memcmp(getCharacters(lhs), getCharacters(rhs), length) == 0;
+    }
+    if (valueType(lhs) == Null && valueType(rhs) == Null)
+        return true;
+    return false;
 }
 
-DataConstant createNull() {
-    DataConstant data;
-    data.type = Null;
-    data.size = 1;
-    data.length = 1;
-    return data;
-}
+typedef bool (*ComparisonHandler)(DataConstant lhs, DataConstant rhs);
+typedef DataConstant (*ArithmeticHandler)(DataConstant lhs, DataConstant rhs);
 
-DataConstant createNone() {
-    DataConstant data;
-    data.type = None;
-    data.size = 0;
-    data.length = 0;
-    return data;
-}
+// Each numeric handler family covers int-int, int-double, double-int and double-double operands
+#define NUMERIC_COMPARISON(name, operator) \
+    bool name##IntInt(DataConstant lhs, DataConstant rhs) { return asInt(lhs) operator asInt(rhs); } \
+    bool name##IntDbl(DataConstant lhs, DataConstant rhs) { return asInt(lhs) operator asDouble(rhs); } \
+    bool name##DblInt(DataConstant lhs, DataConstant rhs) { return asDouble(lhs) operator asInt(rhs); } \
+    bool name##DblDbl(DataConstant lhs, DataConstant rhs) { return asDouble(lhs) operator asDouble(rhs); }
 
-DataConstant createAddr(DataConstant* addr, int offset, int capacity, int length) {
-    DataConstant data;
-    data.type = Addr;
-    data.size = capacity;
-    data.length = length;
-    data.value.address = addr;
-    data.offset = offset;
-    return data;
+#define NUMERIC_ARITHMETIC(name, intExpr, dblExpr) \
+    DataConstant name##IntInt(DataConstant lhs, DataConstant rhs) { int l = asInt(lhs), r = asInt(rhs); return intExpr; } \
+    DataConstant name##IntDbl(DataConstant lhs, DataConstant rhs) { double l = asInt(lhs), r = asDouble(rhs); return dblExpr; } \
+    DataConstant name##DblInt(DataConstant lhs, DataConstant rhs) { double l = asDouble(lhs), r = asInt(rhs); return dblExpr; } \
+    DataConstant name##DblDbl(DataConstant lhs, DataConstant rhs) { double l = asDouble(lhs), r = asDouble(rhs); return dblExpr; }
+
+#define NUMERIC_ENTRIES(operator, name) \
+    [operator][Int][Int] = name##IntInt, \
+    [operator][Int][Dbl] = name##IntDbl, \
+    [operator][Dbl][Int] = name##DblInt, \
+    [operator][Dbl][Dbl] = name##DblDbl
+
+NUMERIC_COMPARISON(less, <)
+NUMERIC_COMPARISON(lessEqual, <=)
+NUMERIC_COMPARISON(greater, >)
+NUMERIC_COMPARISON(greaterEqual, >=)
+
+DataConstant divisionByZero() {
+    fprintf(stderr, "Error: Division by zero\n");
+    return createNone();
 }
 
-bool isZero(DataConstant data) {
-    if (data.type == Dbl)
-        return data.value.dblVal == 0;
-    if (data.type == Int)
-        return data.value.intVal == 0;
-    return false;
+/**
+ * Raise base to a non-negative exponent by squaring, so large exponents take O(log n) multiplications
+ * Negative exponents truncate towards zero like integer division does
+*/
+int powInt(int base, int exponent) {
+    if (exponent < 0) {
+        if (base == 1 || base == -1)
+            return exponent % 2 == 0 ? 1 : base;
+        return 0;
+    }
+    unsigned int result = 1;
+    unsigned int factor = (unsigned int) base; // unsigned so overflow wraps instead of being undefined
+    while (exponent > 0) {
+        if (exponent & 1)
+            result *= factor;
+        factor *= factor;
+        exponent >>= 1;
+    }
+    return (int) result;
 }
 
-bool isEqual(DataConstant lhs, DataConstant rhs) {
-    if (lhs.type == Int && (rhs.type == Int || rhs.type == Dbl))
-        return rhs.type == Int ? lhs.value.intVal == rhs.value.intVal : lhs.value.intVal == rhs.value.dblVal;
-    if (lhs.type == Dbl && (rhs.type == Int || rhs.type == Dbl))
-        return rhs.type == Dbl ? lhs.value.dblVal == rhs.value.dblVal : lhs.value.dblVal == rhs.value.intVal;
-    if (lhs.type == Bool && rhs.type == Bool)
-        return lhs.value.boolVal == rhs.value.boolVal;
-    if (lhs.type == Str && rhs.type == Str) {
-        if (strlen(lhs.value.strVal) != strlen(rhs.value.strVal))
-            return false;
-        return strcmp(lhs.value.strVal, rhs.value.strVal) == 0;
+DataConstant powDouble(double base, double exponent) {
+    if (base == 0 && exponent < 0) {
+        fprintf(stderr, "Error: Zero cannot be raised to a negative power\n");
+        return createNone();
     }
-    if (lhs.type == Null && rhs.type == Null)
-        return true;
-    return false;
+    return createDouble(pow(base, exponent));
 }
 
+NUMERIC_ARITHMETIC(add, createInt(l + r), createDouble(l + r))
+NUMERIC_ARITHMETIC(subtract, createInt(l - r), createDouble(l - r))
+NUMERIC_ARITHMETIC(multiply, createInt(l * r), createDouble(l * r))
+NUMERIC_ARITHMETIC(divide, r == 0 ? divisionByZero() : createInt(l / r), r == 0 ? divisionByZero() : createDouble(l / r))
+NUMERIC_ARITHMETIC(remainder, r == 0 ? divisionByZero() : createInt(l % r), r == 0 ? divisionByZero() : createDouble(fmod(l, r)))
+NUMERIC_ARITHMETIC(power, l == 0 && r < 0 ? powDouble(l, r) : createInt(powInt(l, r)), powDouble(l, r))
+
+// Indexed by [operator][lhs type][rhs type]; missing entries are unsupported operand types
+ComparisonHandler comparisonHandlers[ComparisonOperatorCount][None + 1][None + 1] = {
+    NUMERIC_ENTRIES(CmpLt, less),
+    NUMERIC_ENTRIES(CmpLe, lessEqual),
+    NUMERIC_ENTRIES(CmpGt, greater),
+    NUMERIC_ENTRIES(CmpGe, greaterEqual)
+};
+
+ArithmeticHandler arithmeticHandlers[ArithmeticOperatorCount][None + 1][None + 1] = {
+    NUMERIC_ENTRIES(OpAdd, add),
+    NUMERIC_ENTRIES(OpSub, subtract),
+    NUMERIC_ENTRIES(OpMul, multiply),
+    NUMERIC_ENTRIES(OpDiv, divide),
+    NUMERIC_ENTRIES(OpRem, remainder),
+    NUMERIC_ENTRIES(OpPow, power)
+};
+
 /**
  * Cases:
- *  int (<, <=, >, >=) int
- *  double (<, <=, >, >=) double
- *  int (<, <=, >, >=) double
- *  double (<, <=, >, >=) int
  *  equality (any matching types)
  *  equality (any type with null)
  *  equality (int and double (either way))
+ *  int or double (<, <=, >, >=) int or double; ordering any other types is false
 */
-DataConstant compareData(DataConstant lhs, DataConstant rhs, char* comparison) {
-    DataConstant result;
-    result.type = Bool;
-    result.size = 1;
-    result.length = 1;
-    if (strcmp(comparison, "==") == 0)
-        result.value.boolVal = isEqual(lhs, rhs);
-    else if (strcmp(comparison, "!=") == 0)
-        result.value.boolVal = !isEqual(lhs, rhs);
-    else {
-        if ((lhs.type != Int && lhs.type != Dbl) || (rhs.type != Dbl && rhs.type != Int))
-            result.value.boolVal = false;
-        if (strcmp(comparison, "<") == 0) {
-            if (lhs.type == Int)
-                result.value.boolVal = rhs.type == Int ? lhs.value.intVal < rhs.value.intVal : lhs.value.intVal < rhs.value.dblVal;
-            if (lhs.type == Dbl)
-                result.value.boolVal = rhs.type == Dbl ? lhs.value.dblVal < rhs.value.dblVal : lhs.value.dblVal < rhs.value.intVal;
-        }
-        if (strcmp(comparison, "<=") == 0) {
-            if (lhs.type == Int)
-                result.value.boolVal = rhs.type == Int ? lhs.value.intVal <= rhs.value.intVal : lhs.value.intVal <= rhs.value.dblVal;
-            if (lhs.type == Dbl)
-                result.value.boolVal = rhs.type == Dbl ? lhs.value.dblVal <= rhs.value.dblVal : lhs.value.dblVal <= rhs.value.intVal;
-        }
-        if (strcmp(comparison, ">") == 0) {
-            if (lhs.type == Int)
-                result.value.boolVal = rhs.type == Int ? lhs.value.intVal > rhs.value.intVal : lhs.value.intVal > rhs.value.dblVal;
-            if (lhs.type == Dbl)
-                result.value.boolVal = rhs.type == Dbl ? lhs.value.dblVal > rhs.value.dblVal : lhs.value.dblVal > rhs.value.intVal;
-        }
-        if (strcmp(comparison, ">=") == 0) {
-            if (lhs.type == Int)
-                result.value.boolVal = rhs.type == Int ? lhs.value.intVal >= rhs.value.intVal : lhs.value.intVal >= rhs.value.dblVal;
-            if (lhs.type == Dbl)
-                result.value.boolVal = rhs.type == Dbl ? lhs.value.dblVal >= rhs.value.dblVal : lhs.value.dblVal >= rhs.value.intVal;
-        }
-    }
-    return result;
+DataConstant compareData(DataConstant lhs, DataConstant rhs, ComparisonOperator comparison) {
+    if (comparison == CmpEq || comparison == CmpNe)
+        return createBoolean(isEqual(lhs, rhs) == (comparison == CmpEq));
+    ComparisonHandler handler = comparisonHandlers[comparison][valueType(lhs)][valueType(rhs)];
+    return createBoolean(handler != NULL && handler(lhs, rhs));
 }
 
 DataConstant getMax(DataConstant lhs, DataConstant rhs) {
-    return compareData(lhs, rhs, ">=").value.boolVal ? lhs : rhs;
+    return asBool(compareData(lhs, rhs, CmpGe)) ? lhs : rhs;
 }
 
 DataConstant getMin(DataConstant lhs, DataConstant rhs) {
-    return compareData(lhs, rhs, "<=").value.boolVal ? lhs : rhs;
+    return asBool(compareData(lhs, rhs, CmpLe)) ? lhs : rhs;
 }
 
-DataConstant binaryArithmeticOperation(DataConstant lhs, DataConstant rhs, char* operation) {
-    DataConstant result;
-    if (strcmp(operation, "+") == 0) {
-        if (lhs.type == Dbl || rhs.type == Dbl) {
-            result.type = Dbl;
-            if (lhs.type == rhs.type)
-                result.value.dblVal = lhs.value.dblVal + rhs.value.dblVal;
-            else if (lhs.type == Int)
-                result.value.dblVal = lhs.value.intVal + rhs.value.dblVal;
-            else
-                result.value.dblVal = lhs.value.dblVal + rhs.value.intVal;
-        }
-        else {
-            result.type = Int;
-            result.value.intVal = lhs.value.intVal + rhs.value.intVal;
-        }
-    }
-    else if (strcmp(operation, "-") == 0) {
-        if (lhs.type == Dbl || rhs.type == Dbl) {
-            result.type = Dbl;
-            if (lhs.type == rhs.type)
-                result.value.dblVal = lhs.value.dblVal - rhs.value.dblVal;
-            else if (lhs.type == Int)
-                result.value.dblVal = lhs.value.intVal - rhs.value.dblVal;
-            else
-                result.value.dblVal = lhs.value.dblVal - rhs.value.intVal;
-        }
-        else {
-            result.type = Int;
-            result.value.intVal = lhs.value.intVal - rhs.value.intVal;
-        }
-    }
-    if (strcmp(operation, "*") == 0) {
-        if (lhs.type == Dbl || rhs.type == Dbl) {
-            result.type = Dbl;
-            if (lhs.type == rhs.type)
-                result.value.dblVal = lhs.value.dblVal * rhs.value.dblVal;
-            else if (lhs.type == Int)
-                result.value.dblVal = lhs.value.intVal * rhs.value.dblVal;
-            else
-                result.value.dblVal = lhs.value.dblVal * rhs.value.intVal;
-        }
-        else {
-            result.type = Int;
-            result.value.intVal = lhs.value.intVal * rhs.value.intVal;
-        }
-    }
-    if (strcmp(operation, "/") == 0) {
-        if (isZero(rhs)) {
-            fprintf(stderr, "Error: Division by zero\n");
-            return createNone();
-        }
-        if (lhs.type == Dbl || rhs.type == Dbl) {
-            result.type = Dbl;
-            if (lhs.type == rhs.type)
-                result.value.dblVal = lhs.value.dblVal / rhs.value.dblVal;
-            else if (lhs.type == Int)
-                result.value.dblVal = lhs.value.intVal / rhs.value.dblVal;
-            else
-                result.value.dblVal = lhs.value.dblVal / rhs.value.intVal;
-        }
-        else {
-            result.type = Int;
-            result.value.intVal = lhs.value.intVal / rhs.value.intVal;
-        }
-    }
-    if (strcmp(operation, "mod") == 0) {
-        if (isZero(rhs)) {
-            fprintf(stderr, "Error: Division by zero\n");
-            return createNone();
-        }
-        if (lhs.type == Dbl || rhs.type == Dbl) {
-            result.type = Dbl;
-            if (lhs.type == rhs.type)
-                result.value.dblVal = fmod(lhs.value.dblVal, rhs.value.dblVal);
-            else if (lhs.type == Int)
-                result.value.dblVal = fmod(lhs.value.intVal, rhs.value.dblVal);
-            else
-                result.value.dblVal = fmod(lhs.value.dblVal, rhs.value.intVal);
-        }
-        else {
-            result.type = Int;
-            result.value.intVal = lhs.value.intVal % rhs.value.intVal;
-        }
-    }
-    if (strcmp(operation, "exp") == 0) {
-        if (isZero(lhs)) {
-            DataConstant lessThanZero = compareData(rhs, createInt(0), "<");
-            if (lessThanZero.value.boolVal) {
-                fprintf(stderr, "Error: Zero cannot be raised to a negative power\n");
-                return createNone();
-            }
-        }
-        if (lhs.type == Dbl || rhs.type == Dbl) {
-            result.type = Dbl;
-            if (lhs.type == rhs.type)
-                result.value.dblVal = pow(lhs.value.dblVal, rhs.value.dblVal);
-            else if (lhs.type == Int)
-                result.value.dblVal = pow(lhs.value.intVal, rhs.value.dblVal);
-            else
-                result.value.dblVal = pow(lhs.value.dblVal, rhs.value.intVal);
-        }
-        else {
-            result.type = Int;
-            result.value.intVal = (int) lround(pow(lhs.value.intVal, rhs.value.intVal));
-        }
+/**
+ * Apply an arithmetic operator to two numbers
+ * Returns None after reporting the error for division by zero, zero to a negative power and non-numeric operands
+*/
+DataConstant binaryArithmeticOperation(DataConstant lhs, DataConstant rhs, ArithmeticOperator operation) {
+    ArithmeticHandler handler = arithmeticHandlers[operation][valueType(lhs)][valueType(rhs)];
+    if (handler == NULL) {
+        fprintf(stderr, "Error: Unsupported operand types for arithmetic\n");
+        return createNone();
     }
-    result.size = 1;
-    result.length = 1;
-    return result;
+    return handler(lhs, rhs);
+}
+
+ArrayHeader* getArrayHeader(DataConstant array) {
+    return (ArrayHeader*) asAddress(array);
 }
 
 DataConstant* getArrayStart(DataConstant array) {
-    return (DataConstant *) array.value.address + array.offset;
+    return getArrayHeader(array)->storage->values;
 }
 
-DataConstant copyAddr(DataConstant src, int* destPtr, DataConstant** dest) {
-   return partialCopyAddr(src, 0, src.length, destPtr, dest);
+/**
+ * Store an element and keep the array's element type up to date
+ * Callers grow the length after storing a new element, so an empty array takes the type of its first element
+ * Callers writing to an array that may share its storage unshare it first
+ * Views count as strings, code reading the elements of a string array handles both
+*/
+void setArrayElement(ArrayHeader* array, int index, DataConstant element) {
+    array->storage->values[index] = element;
+    if (valueType(element) == Addr)
+        array->holdsArrays = true;
+    Datatype type = valueType(element) == View ? Str : valueType(element);
+    if (type == None || type == array->elementType)
+        return;
+    array->elementType = array->length == 0 ? type : None;
 }
 
-DataConstant partialCopyAddr(DataConstant src, int begin, int len, int* destPtr, DataConstant** dest) {
-    DataConstant copy;
-    copy.type = Addr;
-    copy.size = src.size;
-    copy.length = len;
-    copy.value.address = *dest;
-    copy.offset = *destPtr + 1;
-    DataConstant* start = getArrayStart(src) + begin;
-    DataConstant* stop = start + src.size;
-    DataConstant* lengthEnd = start + len;
-    DataConstant* arrayRefs[src.size];
-    int arrayRefCount = 0;
-    for (DataConstant* curr = start; curr != lengthEnd && curr != stop; curr++) {
-        if (curr->type == Addr) {
-            *curr = copyAddr(*curr, destPtr, dest);
-            arrayRefs[arrayRefCount++] = curr;
+RopeNode* getRope(DataConstant rope) {
+    return (RopeNode*) asAddress(rope);
+}
+
+ViewNode* getView(DataConstant view) {
+    return (ViewNode*) asAddress(view);
+}
+
+long getStringLength(DataConstant string) {
+    if (valueType(string) == Rope)
+        return getRope(string)->length;
+    if (valueType(string) == View)
+        return getView(string)->length;
+    return (long) strlen(asString(string));
+}
+
+/**
+ * Get the first character of a string or view; only a view's length says where its characters end
+*/
+char* getCharacters(DataConstant string) {
+    return valueType(string) == View ? getView(string)->start : asString(string);
+}
+
+/**
+ * Order two strings or views the way strcmp orders strings
+*/
+int compareStrings(DataConstant lhs, DataConstant rhs) {
+    long lhsLength = getStringLength(lhs);
+    long rhsLength = getStringLength(rhs);
+    int order = memcmp(getCharacters(lhs), getCharacters(rhs), lhsLength < rhsLength ? lhsLength : rhsLength);
+    if (order != 0)
+        return order;
+    return (lhsLength > rhsLength) - (lhsLength < rhsLength);
+}
+
+/**
+ * Copy the characters of a rope into a newly allocated string
+ * Parts are visited with an explicit stack since ropes built in a loop are as deep as the loop ran
+*/
+char* writeRope(RopeNode* rope) {
+    char* string = malloc(rope->length + 1);
+    long position = 0;
+    int capacity = 16;
+    int count = 0;
+    DataConstant* pending = malloc(sizeof(DataConstant) * capacity);
+    pending[count++] = createRope(rope);
+    DataConstant part;
+    RopeNode* node;
+    long length;
+    while (count > 0) {
+        part = pending[--count];
+        if (valueType(part) == Str || valueType(part) == View) {
+            length = getStringLength(part);
+            memcpy(string + position, getCharacters(part), length);
+            position += length;
+            continue;
         }
-        else
-            (*dest)[++(*destPtr)] = *curr;
-    }
-    if (arrayRefCount != 0)
-        copy.offset = *destPtr + 1;
-    for (int i = 0; i < arrayRefCount; i++) {
-        (*dest)[++(*destPtr)] = *(arrayRefs[i]);
-    }
-    if (len < src.size) {
-        for (DataConstant* curr = lengthEnd; curr != stop; curr++) {
-            (*dest)[++(*destPtr)] = createNone();
+        node = getRope(part);
+        if (node->flat != NULL) {
+            memcpy(string + position, node->flat, node->length);
+            position += node->length;
+            continue;
+        }
+        if (count + 2 > capacity) {
+            capacity *= 2;
+            pending = realloc(pending, sizeof(DataConstant) * capacity);
         }
+        pending[count++] = node->right; // written once everything on the left is
+        pending[count++] = node->left;
     }
-    return copy;
-}
-
-DataConstant expandExistingAddr(DataConstant src, int capacity, int* destPtr, DataConstant** dest) {
-    src.size = capacity;
-    DataConstant copy = copyAddr(src, destPtr, dest);
-    return copy;
+    free(pending);
+    string[position] = '\0';
+    return string;
 }
\ No newline at end of file
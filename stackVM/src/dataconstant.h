@@ -2,6 +2,8 @@
 #define DATACONSTANT_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 typedef enum {
     Addr = 1,
@@ -10,47 +12,200 @@ typedef enum {
     Str,
     Bool,
     Null,
+    Rope, // a string built by CONCAT that has not been copied into one buffer yet
+    View, // characters of another string, only copied into a string of their own when they must be NUL terminated
     None
 } Datatype;
 
-typedef union memberVal {
-    int intVal;
-    double dblVal;
-    bool boolVal;
-    char* strVal;
-    void* address; // pointer to the container of the array values (globals or locals)
-} DataValue;
+typedef enum {
+    OpAdd,
+    OpSub,
+    OpMul,
+    OpDiv,
+    OpRem,
+    OpPow,
+    ArithmeticOperatorCount
+} ArithmeticOperator;
+
+// in the same order as the comparison opcodes EQ to GE
+typedef enum {
+    CmpEq,
+    CmpNe,
+    CmpLt,
+    CmpLe,
+    CmpGt,
+    CmpGe,
+    ComparisonOperatorCount
+} ComparisonOperator;
+
+typedef struct ArrayHeader ArrayHeader;
+typedef struct RopeNode RopeNode;
+typedef struct ViewNode ViewNode;
 
+/**
+ * An 8 byte NaN-boxed value
+ * Doubles are stored as they are, with every NaN stored as the canonical quiet NaN
+ * Every other type sets the sign, exponent and quiet bits, which no stored double does, keeps a 3 bit tag in bits 48 to 50
+ * and its payload in the low 48 bits: the int, the bool, or the pointer to the string, array, rope or view
+ * Read values through valueType and the as* accessors rather than the bits
+*/
 typedef struct {
-    Datatype type;
-    DataValue value;
-    int size;
-    int length;
-    int offset; // store the index of the start of the array
+    uint64_t bits;
 } DataConstant;
 
+_Static_assert(sizeof(DataConstant) == 8, "stack, locals, globals and array storage are sized for 8 byte values");
+
+#define BOXED_MASK 0xFFF8000000000000ULL // sign, exponent and quiet bits all set
+#define PAYLOAD_MASK 0x0000FFFFFFFFFFFFULL
+#define CANONICAL_NAN 0x7FF8000000000000ULL
+
+// Dbl is not tagged, so the tags of the types after it are one lower
+static inline DataConstant boxValue(Datatype type, uint64_t payload) {
+    uint64_t tag = type < Dbl ? type - Addr : type - Addr - 1;
+    return (DataConstant) {BOXED_MASK | tag << 48 | (payload & PAYLOAD_MASK)};
+}
+
+static inline Datatype valueType(DataConstant data) {
+    if ((data.bits & BOXED_MASK) != BOXED_MASK)
+        return Dbl;
+    int tag = (data.bits >> 48) & 7;
+    return tag < Dbl - Addr ? Addr + tag : Addr + tag + 1;
+}
+
+static inline int asInt(DataConstant data) {
+    return (int) (uint32_t) data.bits;
+}
+
+static inline double asDouble(DataConstant data) {
+    double value;
+    memcpy(&value, &data.bits, sizeof(double));
+    return value;
+}
+
+static inline bool asBool(DataConstant data) {
+    return (data.bits & 1) != 0;
+}
+
+static inline void* asAddress(DataConstant data) {
+    return (void*) (uintptr_t) (data.bits & PAYLOAD_MASK);
+}
+
+static inline char* asString(DataConstant data) {
+    return (char*) asAddress(data);
+}
+
+static inline DataConstant createInt(int value) {
+    return boxValue(Int, (uint32_t) value);
+}
+
+static inline DataConstant createDouble(double value) {
+    DataConstant data;
+    if (value != value)
+        data.bits = CANONICAL_NAN;
+    else
+        memcpy(&data.bits, &value, sizeof(double));
+    return data;
+}
+
+static inline DataConstant createBoolean(bool value) {
+    return boxValue(Bool, value);
+}
+
+static inline DataConstant createString(char* value) {
+    return boxValue(Str, (uintptr_t) value);
+}
+
+static inline DataConstant createNull() {
+    return boxValue(Null, 0);
+}
+
+static inline DataConstant createNone() {
+    return boxValue(None, 0);
+}
+
+static inline DataConstant createAddr(ArrayHeader* array) {
+    return boxValue(Addr, (uintptr_t) array);
+}
+
+static inline DataConstant createRope(RopeNode* rope) {
+    return boxValue(Rope, (uintptr_t) rope);
+}
+
+static inline DataConstant createView(ViewNode* view) {
+    return boxValue(View, (uintptr_t) view);
+}
+
+/**
+ * Contiguous element storage, shared by copies of an array until one of them is written
+*/
+typedef struct {
+    int refs; // array objects using this storage
+    DataConstant values[];
+} ArrayStorage;
+
+/**
+ * An array object: its header and a pointer to its element storage
+ * Addr values only hold a pointer to it, so passing, returning or storing an array never copies its elements
+*/
+struct ArrayHeader {
+    int capacity;
+    int length;
+    Datatype elementType; // type shared by the elements, None while empty or once different types have been stored
+    bool holdsArrays; // an array was stored at some point, so copies cannot share storage
+    bool marked; // reached by the current collection
+    ArrayHeader* next; // the VM chains every array it allocates so they can be released
+    ArrayStorage* storage;
+};
+
+// concatenations shorter than this are copied right away, longer ones become ropes
+#define MIN_ROPE_LENGTH 64
+
+/**
+ * The concatenation of two strings, each a Str, a view or another rope, copied into a single string the first time it is read
+*/
+struct RopeNode {
+    long length;
+    bool marked; // reached by the current collection
+    DataConstant left; // both parts are None once the rope has been flattened
+    DataConstant right;
+    char* flat; // NULL until the rope is first read
+    RopeNode* next; // the VM chains every rope it creates so they can be released
+};
+
+/**
+ * A substring that borrows the characters of the string it was taken from and keeps that string alive
+*/
+struct ViewNode {
+    long length;
+    bool marked; // reached by the current collection
+    char* parent; // the VM owned string holding the characters, NULL once they have been copied into flat
+    char* start; // not NUL terminated unless the view ends where its parent does
+    char* flat; // NULL until the view is passed to something that needs a NUL terminated string
+    ViewNode* next; // the VM chains every view it creates so they can be released
+};
+
 DataConstant readInt(char* value);
-DataConstant createInt(int value);
 DataConstant readDouble(char* value);
-DataConstant createDouble(double value);
 DataConstant readBoolean(char* value);
-DataConstant createBoolean(bool value);
-DataConstant createString(char* value);
-DataConstant createNull();
-DataConstant createNone();
-DataConstant createAddr(DataConstant* addr, int offset, int capacity, int length);
 
 char* toString(DataConstant data);
 bool isZero(DataConstant data);
 bool isEqual(DataConstant lhs, DataConstant rhs);
-DataConstant compareData(DataConstant lhs, DataConstant rhs, char* comparison);
+DataConstant compareData(DataConstant lhs, DataConstant rhs, ComparisonOperator comparison);
 DataConstant getMax(DataConstant lhs, DataConstant rhs);
 DataConstant getMin(DataConstant lhs, DataConstant rhs);
-DataConstant binaryArithmeticOperation(DataConstant lhs, DataConstant rhs, char* operation);
+int powInt(int base, int exponent);
+DataConstant binaryArithmeticOperation(DataConstant lhs, DataConstant rhs, ArithmeticOperator operation);
 
+ArrayHeader* getArrayHeader(DataConstant array);
 DataConstant* getArrayStart(DataConstant array);
-DataConstant copyAddr(DataConstant src, int* destPtr, DataConstant** dest);
-DataConstant partialCopyAddr(DataConstant src, int begin, int len, int* destPtr, DataConstant** dest);
-DataConstant expandExistingAddr(DataConstant src, int capacity, int* destPtr, DataConstant** dest);
+void setArrayElement(ArrayHeader* array, int index, DataConstant element);
+
+RopeNode* getRope(DataConstant rope);
+ViewNode* getView(DataConstant view);
+long getStringLength(DataConstant string);
+char* getCharacters(DataConstant string);
+int compareStrings(DataConstant lhs, DataConstant rhs);
+char* writeRope(RopeNode* rope);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "filereader.h" 
 
@@ -15,14 +16,30 @@ bool startsWith(char* in, char chr) {
     return false;
 }
 
+/**
+ * A jump block without an EJMP runs to the end of its function
+*/
+void endOpenJumpBlocks(Function* func, int length) {
+    for (int i = 0; i < func->jmpCnt; i++) {
+        if (func->jumpPoints[i].end == -1)
+            func->jumpPoints[i].end = length;
+    }
+}
+
 SourceCode* read_file(char* filename) {
     SourceCode* code = malloc(sizeof(SourceCode));
     code->length = 0;
+    code->loaded = false;
+    code->mapping = NULL;
+    code->mappingSize = 0;
     Function func;
     JumpPoint jmp;
     FILE* fp;
     func.jmpCnt = 0;
-    int count;
+    func.bytecode = NULL;
+    func.constants = NULL;
+    func.constCnt = 0;
+    int count = 0;
     fp = fopen(filename, "r");
     if (fp == NULL || ferror(fp)) {
         perror("Error");
@@ -49,10 +66,12 @@ SourceCode* read_file(char* filename) {
             trimSV(line);
             jmp.label = getFromSV(line, 0);
             jmp.start = count;
+            jmp.end = -1;
             func.jumpPoints[func.jmpCnt++] = jmp;
         }
         else if (strcmp(buff, "\n") == 0) {
             if (!prevWasBlank) {
+                endOpenJumpBlocks(&func, count);
                 func.body = out;
                 out = createStringVector();
                 code->code[code->length++] = func;
@@ -74,6 +93,7 @@ SourceCode* read_file(char* filename) {
             free(line);
         }
     }
+    endOpenJumpBlocks(&func, count);
     func.body = out;
     code->code[code->length++] = func;
     fclose(fp);
@@ -98,6 +118,15 @@ void displayCode(SourceCode* src) {
 void deleteSourceCode(SourceCode* src) {
     for (int i = 0; i < src->length; i++) {
         freeStringVector(src->code[i].body);
+        for (int j = 0; j < src->code[i].constCnt && src->mapping == NULL; j++) {
+            if (valueType(src->code[i].constants[j]) == Str)
+                free(asString(src->code[i].constants[j])); // string literals are copied out of the source by the loader
+        }
+        free(src->code[i].constants);
+        if (src->mapping == NULL)
+            free(src->code[i].bytecode);
     }
+    if (src->mapping != NULL)
+        munmap(src->mapping, src->mappingSize);
     free(src);
 }
\ No newline at end of file
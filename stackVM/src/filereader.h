@@ -2,8 +2,11 @@
 #define FILEREADER_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "stringvector.h"
+#include "dataconstant.h"
+#include "bytecode.h"
 
 typedef struct {
     char* label;
@@ -14,6 +17,9 @@ typedef struct {
 typedef struct {
     char* label;
     StringVector* body;
+    Instruction* bytecode;
+    DataConstant* constants;
+    int constCnt;
     JumpPoint jumpPoints[16];
     int jmpCnt;
 } Function;
@@ -21,9 +27,13 @@ typedef struct {
 typedef struct {
     int length;
     Function code[256];
+    bool loaded; // decoded and linked
+    void* mapping; // bytecode file the functions point into, NULL when read from text
+    size_t mappingSize;
 } SourceCode;
 
 bool startsWith(char* in, char chr);
+void endOpenJumpBlocks(Function* func, int length);
 SourceCode* read_file(char* filename);
 void displayCode(SourceCode* src);
 void deleteSourceCode(SourceCode* src);
@@ -5,39 +5,52 @@
 
 #include "frame.h"
 
-Frame* loadFrame(StringVector* code, JumpPoint* jumps, int jc, long stackSize, long localsSize, int pc, int argc, DataConstant* params) {
+/**
+ * Create a frame whose locals start at locals, where the caller left its argc arguments
+ * The arguments become the first locals without being copied
+*/
+Frame* loadFrame(StringVector* code, Instruction* bytecode, JumpPoint* jumps, int jc, int pc, DataConstant* locals, int argc, int localsCapacity) {
     Frame* frame = malloc(sizeof(Frame));
+    return resetFrame(frame, code, bytecode, jumps, jc, pc, locals, argc, localsCapacity);
+}
+
+// reuse a frame that returned for another call
+Frame* resetFrame(Frame* frame, StringVector* code, Instruction* bytecode, JumpPoint* jumps, int jc, int pc, DataConstant* locals, int argc, int localsCapacity) {
     frame->instructions = code;
+    frame->bytecode = bytecode;
+    frame->constants = NULL;
     frame->returnAddr = pc;
     frame->jumps = jumps;
     frame->jc = jc;
     frame->pc = 0;
-    frame->lp = -1;
+    frame->locals = locals;
+    frame->localsCapacity = localsCapacity;
+    frame->stack = locals + localsCapacity;
+    frame->lp = argc - 1;
     frame->sp = -1;
-    frame->stack = malloc(sizeof(DataConstant) * stackSize);
-    frame->locals = malloc(sizeof(DataConstant) * localsSize);
-    frame->expandedStack = false;
-    frame->expandedLocals = false;
-    for (int i = 0; i < argc; i++) {
-        frame->locals[++frame->lp] = params[i];
-    }
     return frame;
 }
 
+// the values belong to the VM's data stack, so only the frame itself is freed
 void deleteFrame(Frame* frame) {
-    free(frame->locals);
-    free(frame->stack);
     free(frame);
 }
 
-Frame* expandStack(Frame* frame, long stackSize) {
-    frame->stack = realloc(frame->stack, sizeof(DataConstant) *  stackSize);
-    return frame;
+/**
+ * Move the operand stack so the locals window holds localsCapacity values
+ * Only the frame on top of the call stack may grow, nothing lies past its operand stack
+*/
+void moveStack(Frame* frame, int localsCapacity) {
+    DataConstant* stack = frame->locals + localsCapacity;
+    memmove(stack, frame->stack, sizeof(DataConstant) * (frame->sp + 1));
+    frame->stack = stack;
+    frame->localsCapacity = localsCapacity;
 }
 
-Frame* expandLocals(Frame* frame, long localsSize) {
-    frame->locals = realloc(frame->locals, sizeof(DataConstant) * localsSize);
-    return frame;
+// keep the windows at the same offsets once the data stack has been moved
+void rebaseFrame(Frame* frame, DataConstant* from, DataConstant* to) {
+    frame->locals = to + (frame->locals - from);
+    frame->stack = to + (frame->stack - from);
 }
 
 void framePush(Frame* frame, DataConstant value) {
@@ -48,16 +61,38 @@ DataConstant framePop(Frame* frame) {
     return frame->stack[frame->sp--];
 }
 
+/**
+ * Reverse the top argc values in place so the former top comes first, the order calls expect their parameters in
+ * They stay on the stack, where the collector can see them, until the caller drops them; any push may move them
+*/
+DataConstant* reverseArguments(Frame* frame, int argc) {
+    DataConstant* args = frame->stack + frame->sp - argc + 1;
+    DataConstant temp;
+    for (int i = 0; i < argc / 2; i++) {
+        temp = args[i];
+        args[i] = args[argc - i - 1];
+        args[argc - i - 1] = temp;
+    }
+    return args;
+}
+
+void frameDrop(Frame* frame, int count) {
+    frame->sp -= count;
+}
+
 DataConstant frameTop(Frame* frame) {
     return frame->stack[frame->sp];
 }
 
-char* getNextInstruction(Frame* frame) {
-    return getFromSV(frame->instructions, frame->pc++);
+// the value depth places below the top of the stack
+DataConstant framePeek(Frame* frame, int depth) {
+    return frame->stack[frame->sp - depth];
 }
 
-char* peekNextInstruction(Frame* frame) {
-    return getFromSV(frame->instructions, frame->pc);
+Instruction* fetchInstruction(Frame* frame) {
+    Instruction* instr = &frame->bytecode[frame->pc];
+    frame->pc += instr->width;
+    return instr;
 }
 
 DataConstant loadLocal(Frame* frame, int addr) {
@@ -72,33 +107,10 @@ void storeLocalAtAddr(Frame* frame, DataConstant value, int addr) { // overwrite
     frame->locals[addr] = value;
 }
 
-void incrementPC(Frame* frame) {
-    frame->pc++;
-}
-
 void setPC(Frame* frame, int addr) {
     frame->pc = addr;
 }
 
-int getJumpStart(Frame* frame, char* label) {
-    JumpPoint jmp;
-    for (int i = 0; i < frame->jc; i++) {
-        jmp = frame->jumps[i];
-        if (strcmp(jmp.label, label) == 0)
-            return jmp.start;
-    }
-    return -1;
-}
-
-int getJumpEnd(Frame* frame, char* label) {
-    JumpPoint jmp;
-    for (int i = 0; i < frame->jc; i++) {
-        jmp = frame->jumps[i];
-        if (strcmp(jmp.label, label) == 0)
-            return jmp.end;
-    }
-    return -1;
-}
 
 void print_array(char* array_label, DataConstant* array, int end_index) {
     if (end_index == -1) {
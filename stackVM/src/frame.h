@@ -5,36 +5,43 @@
 #include "stringvector.h"
 #include "filereader.h"
 
+/**
+ * A function call
+ * locals and stack are windows into the VM's data stack: the locals come first and the operand stack starts localsCapacity values later
+*/
 typedef struct {
     DataConstant* stack;
     DataConstant* locals;
+    int localsCapacity;
+    int stackCapacity; // highest sp the operand stack window has room for, grows from the stack soft max toward the hard max
+    int function; // index of the called function in the source code
     StringVector* instructions;
+    Instruction* bytecode;
+    DataConstant* constants;
     JumpPoint* jumps;
     int jc;
     int pc;
     int sp;
     int lp;
     int returnAddr;
-    bool expandedStack;
-    bool expandedLocals;
 } Frame;
 
-Frame* loadFrame(StringVector* code, JumpPoint* jumps, int jc, long stackSize, long localsSize, int pc, int argc, DataConstant* params);
+Frame* loadFrame(StringVector* code, Instruction* bytecode, JumpPoint* jumps, int jc, int pc, DataConstant* locals, int argc, int localsCapacity);
+Frame* resetFrame(Frame* frame, StringVector* code, Instruction* bytecode, JumpPoint* jumps, int jc, int pc, DataConstant* locals, int argc, int localsCapacity);
 void deleteFrame(Frame* frame);
-Frame* expandStack(Frame* frame, long stackSize);
-Frame* expandLocals(Frame* frame, long localsSize);
+void moveStack(Frame* frame, int localsCapacity);
+void rebaseFrame(Frame* frame, DataConstant* from, DataConstant* to);
 void framePush(Frame* frame, DataConstant value);
 DataConstant framePop(Frame* frame);
+DataConstant* reverseArguments(Frame* frame, int argc);
+void frameDrop(Frame* frame, int count);
 DataConstant frameTop(Frame* frame);
-char* getNextInstruction(Frame* frame);
-char* peekNextInstruction(Frame* frame);
+DataConstant framePeek(Frame* frame, int depth);
+Instruction* fetchInstruction(Frame* frame);
 DataConstant loadLocal(Frame* frame, int addr);
 void storeLocal(Frame* frame, DataConstant value);
 void storeLocalAtAddr(Frame*, DataConstant value, int addr);
-void incrementPC(Frame* frame);
 void setPC(Frame* frame, int addr);
-int getJumpStart(Frame* frame, char* label);
-int getJumpEnd(Frame* frame, char* label);
 void print_array(char* array_label, DataConstant* array, int array_size);
 bool stackIsEmpty(Frame* frame);
 
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE // asprintf
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,23 +8,25 @@
 
 #include "impl_builtin.h"
 
-#define DEFAULT_LINES 1024
+#define DEFAULT_FILE_BYTES 4096
 
 void print(DataConstant data, bool newLine) {
     char end = newLine ? '\n' : '\0';
-    if (data.type == Int)
-        printf("%d%c", data.value.intVal, end);
-    if (data.type == Dbl)
-        printf("%f%c", data.value.dblVal, end);
-    if (data.type == Str)
-        printf("%s%c", data.value.strVal, end);
-    if (data.type == Bool)
-        printf("%s%c",toString(data), end);
-    if (data.type == Null)
+    if (valueType(data) == Int)
+        printf("%d%c", asInt(data), end);
+    if (valueType(data) == Dbl)
+        printf("%f%c", asDouble(data), end);
+    if (valueType(data) == Str)
+        printf("%s%c", asString(data), end);
+    if (valueType(data) == View)
+        printf("%.*s%c", (int) getView(data)->length, getView(data)->start, end);
+    if (valueType(data) == Bool)
+        printf("%s%c", asBool(data) ? "true" : "false", end);
+    if (valueType(data) == Null)
         printf("null%c", end);
-    if (data.type == Addr) {
+    if (valueType(data) == Addr) {
         DataConstant* start = getArrayStart(data);
-        DataConstant* stop = start + data.length;
+        DataConstant* stop = start + getArrayHeader(data)->length;
         printf("[");
         for (DataConstant* curr = start; curr != stop; curr++) {
             print(*curr, false);
@@ -35,65 +39,74 @@ void print(DataConstant data, bool newLine) {
 }
 
 void printerr(DataConstant data, bool terminates, int exitCode) {
-    fprintf(stderr, "%s\n", data.value.strVal);
+    fprintf(stderr, "%s\n", asString(data));
     if (terminates)
         exit(exitCode);
 }
 
+// strings returned by the builtins below are newly allocated so the VM can take ownership of them
+
 char* getType(DataConstant data) {
-    switch (data.type) {
+    switch (valueType(data)) {
         case Int:
-            return "int";
+            return strdup("int");
         case Dbl:
-            return "double";
+            return strdup("double");
         case Bool:
-            return "boolean";
+            return strdup("boolean");
         case Str:
-            return "string";
+        case View:
+            return strdup("string");
         case Null:
-            return "null";
+            return strdup("null");
         case None:
-            return "None";
+            return strdup("None");
         case Addr:
-            if (data.length == 0)
-                return "Array<>";
+            if (getArrayHeader(data)->length == 0)
+                return strdup("Array<>");
             char* type = "";
-            char* subType = "";
+            char* subType = NULL;
             DataConstant* start = getArrayStart(data);
-            DataConstant* end = start + data.length;
+            DataConstant* end = start + getArrayHeader(data)->length;
             for (DataConstant* curr = start; curr != end; curr++) {
-                if (curr->type == Addr && curr->length == 0 && curr < end - 1)
+                if (valueType(*curr) == Addr && getArrayHeader(*curr)->length == 0 && curr < end - 1)
                     continue;
-                if (curr->type != Null && curr->type != None) {
+                if (valueType(*curr) != Null && valueType(*curr) != None) {
                     subType = getType(*curr);
                     break;
                 }
             }
-            asprintf(&type, "Array<%s>", subType);
+            asprintf(&type, "Array<%s>", subType == NULL ? "" : subType);
+            free(subType);
             return type;
         default:
-            return "Unknown";
+            return strdup("Unknown");
     }
 }
 
 void sleep_(DataConstant seconds) {
-    if (seconds.type == Dbl) {
-        int time = (int) lround(1000000 * seconds.value.dblVal);
+    if (valueType(seconds) == Dbl) {
+        int time = (int) lround(1000000 * asDouble(seconds));
         usleep(time);
     }
-    if (seconds.type == Int)
-        sleep(seconds.value.intVal);
+    if (valueType(seconds) == Int)
+        sleep(asInt(seconds));
 }
 
-char* at(char* str, int index, ExitCode* vmState) {
-    if (index < 0 || index >= (int)strlen(str)) {
-        fprintf(stderr, "IndexError: String index out of range in function call 'at(\"%s\", %d)'\n", str, index);
-        *vmState = memory_err;
-        return "";
+// at, slice and split return views of their string instead of copies
+// a Str does not know its length, so at and slice only look for its end as far as they need to
+
+long getLengthUpTo(DataConstant string, long limit) {
+    return valueType(string) == View ? getView(string)->length : (long) strnlen(asString(string), limit < 0 ? 0 : limit);
+}
+
+DataConstant at(DataConstant string, int index, VM* vm) {
+    if (index < 0 || index >= getLengthUpTo(string, index + 1L)) {
+        fprintf(stderr, "IndexError: String index out of range in function call 'at(\"%.*s\", %d)'\n", (int) getStringLength(string), getCharacters(string), index);
+        vm->state = memory_err;
+        return createString("");
     }
-    char* result = "";
-    asprintf(&result, "%c", str[index]);
-    return result;
+    return sliceString(vm, string, index, 1);
 }
 
 bool startsWith_(char* string, char* prefix) {
@@ -153,64 +166,79 @@ char* replace(char* string, char* old, char* new, bool multiple) {
     size_t len = strlen(string);
     size_t old_len = strlen(old);
     size_t new_len = strlen(new);
-    size_t end;
-    if (len <= old_len && strstr(old, string))
-        return new;
-    char* replaced = malloc(len - old_len + new_len + 1);
-    char* temp = strstr(string, old);
-    if (temp == NULL)
-        return string;
-    end = len - strlen(temp);
-    strncpy(replaced, string, end);
-    replaced[end] = '\0';
-    sprintf(&replaced[end], "%s%s", new, temp + old_len);
-    while (multiple && strstr(replaced, old)) {
-        replaced = replace(replaced, old, new, multiple);
-    }
+    if (old_len == 0) // an empty pattern would match at every position
+        multiple = false;
+    // count the non-overlapping occurrences first so the result is allocated once
+    size_t count = 0;
+    for (char* match = strstr(string, old); match != NULL; match = strstr(match + old_len, old)) {
+        count++;
+        if (!multiple)
+            break;
+    }
+    char* replaced = malloc(len - count * old_len + count * new_len + 1);
+    char* end = replaced;
+    char* rest = string;
+    char* match;
+    for (size_t i = 0; i < count; i++) {
+        match = strstr(rest, old);
+        memcpy(end, rest, match - rest);
+        end += match - rest;
+        memcpy(end, new, new_len);
+        end += new_len;
+        rest = match + old_len;
+    }
+    strcpy(end, rest);
     return replaced;
 }
 
-char* slice(char* string, int start, int end, ExitCode* vmState) {
-    if (start < 0 || start > end || start >= (int) strlen(string)) {
+DataConstant slice(DataConstant string, int start, int end, VM* vm) {
+    int length = (int) getLengthUpTo(string, end + 1L); // exact unless the string goes on past end
+    if (start < 0 || start > end || start >= length) {
         fprintf(stderr, "Invalid start value of slice %d\n", start);
-        *vmState = memory_err;
-        return "";
-    }
-    if (start == 0 && end == (int) strlen(string))
-        return string;
-    char sliced[end - start];
-    int index = 0;
-    for (int i = start; i < end; i++) {
-        sliced[index++] = string[i];
+        vm->state = memory_err;
+        return createString("");
     }
-    sliced[index] = '\0';
-    return strdup(sliced);
+    if (end > length)
+        end = length;
+    if (start == 0 && end == length)
+        return string; // strings are never written, so the whole string can be shared as it is
+    return sliceString(vm, string, start, end - start);
 }
 
-DataConstant splitString(char* string, char* delim, VM* vm, Frame* frame, bool* globalsExpanded, bool verbose) {
-    char** strings = malloc(sizeof(char*) * strlen(string));
-    int i = 0;
-    if (delim == NULL) { // create a charArray
-        for (int j = 0; j < (int) strlen(string); j++) {
-            strings[i++] = strdup((char[2]) {string[j], '\0'});
+// like strtok_r, every character of delim separates tokens and empty tokens are skipped
+DataConstant splitString(DataConstant string, char* delim, VM* vm) {
+    char* characters = getCharacters(string);
+    int length = (int) getStringLength(string);
+    bool separates[256] = {false};
+    for (char* c = delim; c != NULL && *c != '\0'; c++) {
+        separates[(unsigned char) *c] = true;
+    }
+    // count the tokens first since allocating the array may run the collector, which must not find views yet
+    int count = 0;
+    for (int i = 0; i < length; i++) {
+        if (delim == NULL || (!separates[(unsigned char) characters[i]] && (i == 0 || separates[(unsigned char) characters[i - 1]])))
+            count++;
+    }
+    DataConstant result = allocateArray(vm, count);
+    if (vm->state != success)
+        return result;
+    ArrayHeader* array = getArrayHeader(result);
+    int start;
+    for (int i = 0; i < length; i++) {
+        if (delim == NULL) { // create a charArray
+            setArrayElement(array, array->length, sliceString(vm, string, i, 1));
+            array->length++;
+            continue;
         }
-    }
-    else {
-        char* token;
-        char* str = strdup(string);
-        while ((token = strtok_r(str, delim, &str))) {
-            strings[i++] = token;
+        if (separates[(unsigned char) characters[i]])
+            continue;
+        start = i;
+        while (i < length && !separates[(unsigned char) characters[i]]) {
+            i++;
         }
+        setArrayElement(array, array->length, sliceString(vm, string, start, i - start));
+        array->length++;
     }
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, i, globalsExpanded, verbose);
-    if (vm->state != success)
-        return createNone();
-    *frame = *arrayTarget.frame;
-    DataConstant result = createAddr(arrayTarget.target, *arrayTarget.targetp + 1, i, i);
-    for (int j = 0; j < i; j++) {
-        arrayTarget.target[++(*arrayTarget.targetp)] = createString(strings[j]);
-    }
-    free(strings);
     return result;
 }
 
@@ -233,7 +261,7 @@ void createFile(char* filePath, ExitCode* vmState) {
     fclose(fp);
 }
 
-DataConstant readFile(char* filePath, VM* vm, Frame* frame, bool* globalsExpanded, bool verbose) {
+DataConstant readFile(char* filePath, VM* vm) {
     if (!fileExists(filePath)) {
         fprintf(stderr, "FileError: Cannot read file '%s' because it does not exist\n", filePath);
         vm->state = file_err;
@@ -246,34 +274,44 @@ DataConstant readFile(char* filePath, VM* vm, Frame* frame, bool* globalsExpande
         vm->state = file_err;
         return createNone();
     }
-    DataConstant lines;
-    lines.type = Addr;
-    lines.length = 0;
-    lines.size = 0;
-    int max_file_length = (1 << 20) - 1;
-    DataConstant* content = malloc(sizeof(DataConstant) * max_file_length);
-    char line[DEFAULT_LINES];
-    while (fgets(line, DEFAULT_LINES, fp)) {
-        content[lines.length] = createString(strdup(line));
-        if (lines.length > max_file_length) {
-            fprintf(stderr, "File is too large to read\n");
-            vm->state = file_err;
-            return createNone();
+    // the whole file is read into one string and every line is a view of it
+    size_t size = 0;
+    size_t capacity = DEFAULT_FILE_BYTES;
+    char* content = malloc(capacity);
+    size_t read;
+    while ((read = fread(content + size, 1, capacity - size - 1, fp)) > 0) {
+        size += read;
+        if (size + 1 == capacity) {
+            capacity *= 2;
+            content = realloc(content, capacity);
         }
-        lines.length++;
-        lines.size++;
     }
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, lines.size, globalsExpanded, verbose);
+    fclose(fp);
+    content[size] = '\0';
+    char* stop = content + size;
+    int length = size > 0 && content[size - 1] != '\n' ? 1 : 0; // the last line may not end with a newline
+    for (char* c = content; c != stop; c++) {
+        if (*c == '\n')
+            length++;
+    }
+    DataConstant lines = allocateArray(vm, length); // before adopting the content so a collection cannot free it
+    if (vm->state != success || length == 0) {
+        free(content);
+        return lines;
+    }
+    DataConstant file = adoptString(vm, content);
     if (vm->state != success)
-        return createNone();
-    *frame = *(arrayTarget.frame);
-    lines.value.address = arrayTarget.target;
-    lines.offset = *arrayTarget.targetp + 1;
-    for (int i = 0; i < lines.length; i++) {
-        arrayTarget.target[++(*arrayTarget.targetp)] = content[i];
+        return lines; // content was freed
+    ArrayHeader* array = getArrayHeader(lines);
+    char* line = content;
+    char* end;
+    for (int i = 0; i < length; i++) {
+        end = memchr(line, '\n', stop - line);
+        end = end == NULL ? stop : end + 1; // lines keep their newline
+        setArrayElement(array, array->length, sliceString(vm, file, line - content, end - line));
+        array->length++;
+        line = end;
     }
-    free(content);
-    fclose(fp);
     return lines;
 }
 
@@ -328,38 +366,35 @@ void deleteFile(char* filePath, ExitCode* vmState) {
 }
 
 void reverseArr(DataConstant array) {
-    if (array.length <= 1)
+    int length = getArrayHeader(array)->length;
+    if (length <= 1)
         return;
     DataConstant* start = getArrayStart(array);
     DataConstant temp;
-    int half = array.length / 2;
+    int half = length / 2;
     DataConstant* mid;
     for (int i = 0; i < half; i++) {
-        mid = start + (array.length - i - 1);
+        mid = start + (length - i - 1);
         temp = *(start + i);
         *(start + i) = *mid;
         *mid = temp;
     }
 }
 
-DataConstant sliceArr(DataConstant array, int start, int end, VM* vm, Frame* frame, bool* globalsExpanded, bool verbose) {
-    if (start < 0 || start > end || start >= array.length || end > array.length) {
+DataConstant sliceArr(DataConstant array, int start, int end, VM* vm) {
+    int length = getArrayHeader(array)->length;
+    if (start < 0 || start > end || start >= length || end > length) {
         fprintf(stderr, "Array index out of bounds in call to slice. start: %d, end: %d\n", start, end);
         vm->state = memory_err;
         return createNone();
     }
-    int len = end - start;
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, array.size, globalsExpanded, verbose);
-    *frame = *(arrayTarget.frame);
-    if (vm->state != success)
-        return createNone();
-    return partialCopyAddr(array, start, len, arrayTarget.targetp, &arrayTarget.target);
+    return copyArray(vm, array, start, end - start, getArrayHeader(array)->capacity);
 }
 
 bool arrayContains(DataConstant array, DataConstant element) {
-    if (array.length != 0) {
+    if (getArrayHeader(array)->length != 0) {
         DataConstant* start = getArrayStart(array);
-        DataConstant* stop = start + array.length;
+        DataConstant* stop = start + getArrayHeader(array)->length;
         for (DataConstant* curr = start; curr != stop; curr++) {
             if (isEqual(*curr, element))
                 return true;
@@ -369,9 +404,9 @@ bool arrayContains(DataConstant array, DataConstant element) {
 }
 
 int indexOf(DataConstant array, DataConstant element) {
-    if (array.length != 0) {
+    if (getArrayHeader(array)->length != 0) {
         DataConstant* start = getArrayStart(array);
-        DataConstant* stop = start + array.length;
+        DataConstant* stop = start + getArrayHeader(array)->length;
         int i = 0;
         for (DataConstant* curr = start; curr != stop; curr++) {
             if (isEqual(*curr, element))
@@ -383,87 +418,136 @@ int indexOf(DataConstant array, DataConstant element) {
 }
 
 char* join(DataConstant array, char* delim) {
-    if (array.length == 0)
-        return "";
+    int length = getArrayHeader(array)->length;
+    if (length == 0)
+        return strdup("");
     DataConstant* start = getArrayStart(array);
-    DataConstant* stop = start + array.length;
-    char* result = start->value.strVal;
-    for (DataConstant* curr = start + 1; curr != stop; curr++) {
-        asprintf(&result, "%s%s%s", result, delim, curr->value.strVal);
+    // size the result first so every character is copied once
+    size_t delimLength = strlen(delim);
+    size_t total = delimLength * (length - 1);
+    for (int i = 0; i < length; i++) {
+        total += getStringLength(start[i]); // elements may be views
+    }
+    char* result = malloc(total + 1);
+    char* end = result;
+    size_t elementLength;
+    for (int i = 0; i < length; i++) {
+        if (i > 0) {
+            memcpy(end, delim, delimLength);
+            end += delimLength;
+        }
+        elementLength = getStringLength(start[i]);
+        memcpy(end, getCharacters(start[i]), elementLength);
+        end += elementLength;
     }
+    *end = '\0';
     return result;
 }
 
 int comparator(const void* a, const void* b) {
     DataConstant lhs = *(DataConstant*)a;
     DataConstant rhs = *(DataConstant*)b;
-    if (lhs.type != rhs.type) {
-        if (lhs.type == Null || rhs.type == Null)
-            return lhs.type == Null ? -1 : 1; // null values come first
-    }
-    if (lhs.type == Str)
-        return strcmp(lhs.value.strVal, rhs.value.strVal);
-    else if (lhs.type == Bool)
-        return lhs.value.boolVal - rhs.value.boolVal;
-    else if (lhs.type == Int)
-        return lhs.value.intVal - rhs.value.intVal;
-    else if (lhs.type == Dbl) {
-        if (lhs.value.dblVal == rhs.value.dblVal)
+    if (valueType(lhs) != valueType(rhs)) {
+        if (valueType(lhs) == Null || valueType(rhs) == Null)
+            return valueType(lhs) == Null ? -1 : 1; // null values come first
+    }
+    if ((valueType(lhs) == Str || valueType(lhs) == View) && (valueType(rhs) == Str || valueType(rhs) == View))
+        return compareStrings(lhs, rhs);
+    else if (valueType(lhs) == Bool)
+        return asBool(lhs) - asBool(rhs);
+    else if (valueType(lhs) == Int)
+        return asInt(lhs) - asInt(rhs);
+    else if (valueType(lhs) == Dbl) {
+        if (asDouble(lhs) == asDouble(rhs))
             return 0;
-        return lhs.value.dblVal < rhs.value.dblVal ? -1 : 1;
+        return asDouble(lhs) < asDouble(rhs) ? -1 : 1;
     }
     // preserve order by default
     return 0;
 }
 
+int intComparator(const void* a, const void* b) {
+    int lhs = asInt(*(DataConstant*)a);
+    int rhs = asInt(*(DataConstant*)b);
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+int strComparator(const void* a, const void* b) {
+    return compareStrings(*(DataConstant*)a, *(DataConstant*)b); // string arrays may hold views
+}
+
 void sort(DataConstant array) {
-    DataConstant* start = getArrayStart(array);
-    qsort(start, array.length, sizeof(DataConstant), comparator);
+    ArrayHeader* header = getArrayHeader(array);
+    // arrays holding a single element type skip the type checks on every comparison
+    int (*compare)(const void*, const void*) = comparator;
+    if (header->elementType == Int)
+        compare = intComparator;
+    else if (header->elementType == Str)
+        compare = strComparator;
+    qsort(header->storage->values, header->length, sizeof(DataConstant), compare);
 }
 
 void removeByIndex(DataConstant* array, int index, ExitCode* vmState) {
-    if (index < 0 || index > array->size) {
+    ArrayHeader* header = getArrayHeader(*array);
+    if (index < 0 || index > header->capacity) {
         fprintf(stderr, "Array index out of bounds\n");
         *vmState = memory_err;
         return;
     }
     DataConstant* start = getArrayStart(*array);
-    memmove(start + index, start + index + 1, sizeof(DataConstant) * (array->length - index - 1));
-    array->length--;
-    *(start + array->length) = createNone();
+    memmove(start + index, start + index + 1, sizeof(DataConstant) * (header->length - index - 1));
+    header->length--;
+    *(start + header->length) = createNone();
+}
+
+void removeAllValues(DataConstant array, DataConstant elem) {
+    ArrayHeader* header = getArrayHeader(array);
+    DataConstant* start = getArrayStart(array);
+    // move the kept elements down over the removed ones in a single pass
+    int kept = 0;
+    for (int i = 0; i < header->length; i++) {
+        if (!isEqual(start[i], elem))
+            start[kept++] = start[i];
+    }
+    for (int i = kept; i < header->length; i++) {
+        start[i] = createNone();
+    }
+    header->length = kept;
 }
 
 void append(DataConstant* array, DataConstant elem, ExitCode* vmState) {
-    if (array->length == array->size) {
-        fprintf(stderr, "Array size limit %d reached. Cannot insert into array.\n" , array->size);
+    ArrayHeader* header = getArrayHeader(*array);
+    if (header->length == header->capacity) {
+        fprintf(stderr, "Array size limit %d reached. Cannot insert into array.\n" , header->capacity);
         *vmState = memory_err;
         return;
     }
-    DataConstant* start = getArrayStart(*array);
-    *(start + array->length) = elem;
-    array->length++; 
+    setArrayElement(header, header->length, elem);
+    header->length++; 
 }
 
 void prepend(DataConstant* array, DataConstant elem, ExitCode* vmState) {
-    if (array->length == array->size) {
-        fprintf(stderr, "Array size limit %d reached. Cannot insert into array.\n" , array->size);
+    ArrayHeader* header = getArrayHeader(*array);
+    if (header->length == header->capacity) {
+        fprintf(stderr, "Array size limit %d reached. Cannot insert into array.\n" , header->capacity);
         *vmState = memory_err;
         return;
     }
     DataConstant* start = getArrayStart(*array);
-    memmove(start+1, start, sizeof(DataConstant) * (array->length));
-    *start = elem;
-    array->length++; 
+    memmove(start+1, start, sizeof(DataConstant) * (header->length));
+    setArrayElement(header, 0, elem);
+    header->length++; 
 }
 
 void insert(DataConstant* array, DataConstant elem, int index, ExitCode* vmState) {
-    if (array->length == array->size) {
-        fprintf(stderr, "Array size limit %d reached. Cannot insert into array.\n" , array->size);
+    ArrayHeader* header = getArrayHeader(*array);
+    if (header->length == header->capacity) {
+        fprintf(stderr, "Array size limit %d reached. Cannot insert into array.\n" , header->capacity);
         *vmState = memory_err;
         return;
     }
-    if (index < 0 || index > array->length) {
-        fprintf(stderr, "Array index %d out of range %d\n", index, array->length);
+    if (index < 0 || index > header->length) {
+        fprintf(stderr, "Array index %d out of range %d\n", index, header->length);
         *vmState = memory_err;
         return;
     }
@@ -471,12 +555,12 @@ void insert(DataConstant* array, DataConstant elem, int index, ExitCode* vmState
         prepend(array, elem, vmState);
         return;
     }
-    if (index == array->length) {
+    if (index == header->length) {
         append(array, elem, vmState);
         return;
     }
     DataConstant* start = getArrayStart(*array) + index;
-    memmove(start+1, start, sizeof(DataConstant) * (array->length - index));
-    *start = elem;
-    array->length++; 
+    memmove(start+1, start, sizeof(DataConstant) * (header->length - index));
+    setArrayElement(header, index, elem);
+    header->length++; 
 }
\ No newline at end of file
@@ -11,29 +11,30 @@ void printerr(DataConstant data, bool terminates, int exitCode);
 void sleep_(DataConstant seconds);
 char* getType(DataConstant data);
 
-char* at(char* str, int index, ExitCode* vmState);
+DataConstant at(DataConstant string, int index, VM* vm);
 bool startsWith_(char* string, char* prefix);
 bool endsWith(char* string, char* suffix);
 char* reverse(char* string);
 bool contains(char* str, char* subStr);
 char* replace(char* string, char* old, char* new, bool multiple);
-char* slice(char* string, int start, int end, ExitCode* vmState);
-DataConstant splitString(char* string, char* delim, VM* vm, Frame* frame, bool* globalsExpanded, bool verbose);
+DataConstant slice(DataConstant string, int start, int end, VM* vm);
+DataConstant splitString(DataConstant string, char* delim, VM* vm);
 
 bool fileExists(char* filePath);
 void createFile(char* filePath, ExitCode* vmState);
-DataConstant readFile(char* filePath, VM* vm, Frame* frame, bool* globalsExpanded, bool verbose);
+DataConstant readFile(char* filePath, VM* vm);
 void writeToFile(char* filePath, char* content, char* mode, ExitCode* vmState);
 void renameFile(char* filePath, char* newFilePath, ExitCode* vmState);
 void deleteFile(char* filePath, ExitCode* vmState);
 
 void reverseArr(DataConstant array);
-DataConstant sliceArr(DataConstant array, int start, int end, VM* vm, Frame* frame, bool* globalsExpanded, bool verbose);
+DataConstant sliceArr(DataConstant array, int start, int end, VM* vm);
 bool arrayContains(DataConstant array, DataConstant element);
 int indexOf(DataConstant array, DataConstant element);
 char* join(DataConstant array, char* delim);
 void sort(DataConstant array);
 void removeByIndex(DataConstant* array, int index, ExitCode* vmState);
+void removeAllValues(DataConstant array, DataConstant elem);
 void append(DataConstant* array, DataConstant elem, ExitCode* vmState);
 void prepend(DataConstant* array, DataConstant elem, ExitCode* vmState);
 void insert(DataConstant* array, DataConstant elem, int index, ExitCode* vmState);
@@ -0,0 +1,359 @@
+#define _GNU_SOURCE // strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "loader.h"
+#include "builtin.h"
+
+bool isInt(char* constant) {
+    int len = (int) strlen(constant);
+    for (int i = 0; i < len; i++) {
+        if (i == 0 && constant[i] == '-')
+            continue;
+        if (!isdigit(constant[i]))
+            return false;
+    }
+    return true;
+}
+
+bool isDouble(char* constant) {
+    int dotCount = 0;
+    int len = (int) strlen(constant);
+    for (int i = 0; i < len; i++) {
+        if (i == 0 && constant[i] == '-')
+            continue;
+        if (constant[i] == '.')
+            dotCount++;
+        else if (!isdigit(constant[i]))
+            return false;
+    }
+    return dotCount == 1;
+}
+
+bool isBool(char* constant) {
+    return strcmp(constant, "true") == 0 || strcmp(constant, "false") == 0;
+}
+
+char* removeQuotes(char* in) {
+    int len = strlen(in);
+    char out[len - 1];
+    int index = 0;
+    for (int i = 1; i < len - 1; i++) {
+        out[index++] = in[i];
+    }
+    out[index] = '\0';
+    return strdup(out);
+}
+
+DataConstant parseConstant(char* literal) {
+    if (isInt(literal))
+        return readInt(literal);
+    if (isDouble(literal))
+        return readDouble(literal);
+    if (isBool(literal))
+        return readBoolean(literal);
+    if (startsWith(literal, '"'))
+        return createString(removeQuotes(literal));
+    if (strcmp(literal, "NULL") == 0)
+        return createNull();
+    return createNone();
+}
+
+char* tokenAt(StringVector* body, int index) {
+    if (index >= body->length)
+        return NULL;
+    return getFromSV(body, index);
+}
+
+int readIntOperand(StringVector* body, int index) {
+    char* token = tokenAt(body, index);
+    return token == NULL ? 0 : atoi(token);
+}
+
+bool hasIntOperand(StringVector* body, int index) {
+    char* token = tokenAt(body, index);
+    return token != NULL && isInt(token);
+}
+
+int findJumpPoint(JumpPoint* jumps, int jmpCnt, char* label) {
+    if (label == NULL)
+        return NO_OPERAND;
+    for (int i = 0; i < jmpCnt; i++) {
+        if (strcmp(jumps[i].label, label) == 0)
+            return i;
+    }
+    return NO_OPERAND;
+}
+
+/**
+ * Find where execution continues after leaving a jump block early: the instruction following the next EJMP
+*/
+int findBlockExit(StringVector* body, int pc) {
+    while (pc < body->length) {
+        if (strcmp(getFromSV(body, pc), "EJMP") == 0)
+            return pc + 1;
+        pc++;
+    }
+    return body->length;
+}
+
+/**
+ * Translate a function body into instructions once so the VM never has to compare or parse strings while running
+ * Every slot starts as UNKNOWN pointing at its own token so landing on an operand reports the token like before
+ * The extra slot past the end of the body catches functions that run off without a RET or HALT
+*/
+Instruction* decode(StringVector* body, JumpPoint* jumps, int jmpCnt) {
+    Instruction* bytecode = malloc(sizeof(Instruction) * (body->length + 1));
+    for (int i = 0; i <= body->length; i++) {
+        bytecode[i].opcode = UNKNOWN;
+        bytecode[i].width = 1;
+        bytecode[i].block = NO_OPERAND;
+        bytecode[i].operands[0] = i < body->length ? i : NO_OPERAND;
+        bytecode[i].operands[1] = NO_OPERAND;
+        bytecode[i].operands[2] = NO_OPERAND;
+    }
+    Instruction* instr;
+    int pc = 0;
+    while (pc < body->length) {
+        instr = &bytecode[pc];
+        instr->opcode = getOpcode(getFromSV(body, pc));
+        switch (instr->opcode) {
+            case LOAD_CONST:
+                instr->width = 2;
+                instr->operands[0] = pc + 1; // literal is parsed by the VM
+                break;
+            case LOAD:
+            case GLOAD:
+            case REPEATSTR:
+                instr->width = 2;
+                instr->operands[0] = readIntOperand(body, pc + 1);
+                break;
+            case STORE:
+            case GSTORE:
+                instr->operands[0] = NO_OPERAND; // append a new variable
+                if (hasIntOperand(body, pc + 1)) {
+                    instr->width = 2;
+                    instr->operands[0] = readIntOperand(body, pc + 1); // overwrite an existing variable
+                }
+                break;
+            case BUILDARR:
+                instr->width = 2;
+                instr->operands[0] = readIntOperand(body, pc + 1);
+                if (hasIntOperand(body, pc + 2)) {
+                    instr->width = 3;
+                    instr->operands[1] = readIntOperand(body, pc + 2);
+                }
+                break;
+            case JMP:
+            case JMPT:
+            case JMPF:
+            case SJMPT:
+            case SJMPF:
+                instr->width = 2;
+                instr->operands[2] = findJumpPoint(jumps, jmpCnt, tokenAt(body, pc + 1));
+                instr->operands[0] = instr->operands[2] == NO_OPERAND ? NO_OPERAND : jumps[instr->operands[2]].start;
+                instr->operands[1] = pc + 1; // label is only needed to report a missing jump point
+                break;
+            case EJMPT:
+            case EJMPF:
+                instr->operands[0] = findBlockExit(body, pc + 1);
+                break;
+            case CALL:
+                instr->width = 3;
+                instr->operands[0] = readIntOperand(body, pc + 2);
+                instr->operands[1] = pc + 1; // resolved to a function index or builtin id by linkSourceCode
+                break;
+            default:
+                break;
+        }
+        if (pc + instr->width > body->length)
+            instr->width = body->length - pc;
+        pc += instr->width;
+    }
+    for (int i = 0; i < jmpCnt; i++) {
+        if (jumps[i].start >= 0 && jumps[i].start <= body->length)
+            bytecode[jumps[i].start].block = i;
+    }
+    return bytecode;
+}
+
+/**
+ * Parse every LOAD_CONST literal of a function once and point the instruction at its slot in the pool
+*/
+DataConstant* buildConstantPool(StringVector* body, Instruction* bytecode, int* constCnt) {
+    int count = 0;
+    for (int pc = 0; pc < body->length; pc += bytecode[pc].width) {
+        if (bytecode[pc].opcode == LOAD_CONST)
+            count++;
+    }
+    DataConstant* constants = malloc(sizeof(DataConstant) * (count > 0 ? count : 1));
+    Instruction* instr;
+    char* literal;
+    count = 0;
+    for (int pc = 0; pc < body->length; pc += instr->width) {
+        instr = &bytecode[pc];
+        if (instr->opcode != LOAD_CONST)
+            continue;
+        literal = tokenAt(body, instr->operands[0]);
+        constants[count] = literal == NULL ? createNone() : parseConstant(literal);
+        instr->operands[0] = count++;
+    }
+    *constCnt = count;
+    return constants;
+}
+
+unsigned int hashLabel(char* label) {
+    unsigned int hash = 5381;
+    for (char* c = label; *c != '\0'; c++) {
+        hash = hash * 33 + (unsigned char) *c;
+    }
+    return hash;
+}
+
+SymbolTable* createSymbolTable(SourceCode* src) {
+    SymbolTable* table = malloc(sizeof(SymbolTable));
+    table->capacity = 16;
+    while (table->capacity < src->length * 2)
+        table->capacity *= 2;
+    table->slots = malloc(sizeof(int) * table->capacity);
+    for (int i = 0; i < table->capacity; i++) {
+        table->slots[i] = -1;
+    }
+    unsigned int slot;
+    for (int i = 0; i < src->length; i++) {
+        slot = hashLabel(src->code[i].label) & (table->capacity - 1);
+        while (table->slots[slot] != -1) {
+            if (strcmp(src->code[table->slots[slot]].label, src->code[i].label) == 0)
+                break; // keep the first definition like the linear search did
+            slot = (slot + 1) & (table->capacity - 1);
+        }
+        if (table->slots[slot] == -1)
+            table->slots[slot] = i;
+    }
+    return table;
+}
+
+int lookupFunction(SymbolTable* table, SourceCode* src, char* label) {
+    unsigned int slot = hashLabel(label) & (table->capacity - 1);
+    while (table->slots[slot] != -1) {
+        if (strcmp(src->code[table->slots[slot]].label, label) == 0)
+            return table->slots[slot];
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    return -1;
+}
+
+void deleteSymbolTable(SymbolTable* table) {
+    free(table->slots);
+    free(table);
+}
+
+/**
+ * Resolve the target of every CALL once so calls never compare function names while running
+ * Builtins take priority over user functions and have their argument count checked here
+ * Unknown functions are reported when the CALL executes
+*/
+bool linkSourceCode(SourceCode* src) {
+    SymbolTable* table = createSymbolTable(src);
+    bool linked = true;
+    Function* func;
+    Instruction* instr;
+    char* name;
+    int id;
+    for (int i = 0; i < src->length; i++) {
+        func = &src->code[i];
+        for (int pc = 0; pc < func->body->length; pc += instr->width) {
+            instr = &func->bytecode[pc];
+            if (instr->opcode != CALL)
+                continue;
+            name = tokenAt(func->body, instr->operands[1]);
+            if (name == NULL)
+                continue;
+            id = getBuiltinId(name);
+            if (id != -1) {
+                instr->opcode = CALL_BUILTIN;
+                instr->operands[2] = id;
+                if (!checkBuiltinArity(id, instr->operands[0]))
+                    linked = false;
+            }
+            else {
+                id = lookupFunction(table, src, name);
+                instr->operands[2] = id == -1 ? NO_OPERAND : id;
+            }
+        }
+    }
+    deleteSymbolTable(table);
+    return linked;
+}
+
+/**
+ * Collect the indices of the instructions following pc until count is reached, the body ends or a jump block starts
+ * Returns how many were found
+*/
+int followingInstructions(StringVector* body, Instruction* bytecode, int pc, int* window, int count) {
+    int found = 0;
+    pc += bytecode[pc].width;
+    while (found < count && pc < body->length && bytecode[pc].block == NO_OPERAND) {
+        window[found++] = pc;
+        pc += bytecode[pc].width;
+    }
+    return found;
+}
+
+/**
+ * Replace frequent instruction sequences with superinstructions so loops dispatch fewer times
+ * A sequence is never fused across the start of a jump block
+*/
+void fuseSuperinstructions(StringVector* body, Instruction* bytecode) {
+    Instruction* instr;
+    Instruction* next[3];
+    int window[3];
+    int found;
+    for (int pc = 0; pc < body->length; pc += instr->width) {
+        instr = &bytecode[pc];
+        if (instr->opcode != LOAD)
+            continue;
+        found = followingInstructions(body, bytecode, pc, window, 3);
+        for (int i = 0; i < found; i++) {
+            next[i] = &bytecode[window[i]];
+        }
+        if (found >= 3 && next[0]->opcode == LOAD_CONST && next[1]->opcode == ADD && next[2]->opcode == STORE && next[2]->operands[0] == instr->operands[0]) {
+            instr->opcode = INC_LOCAL;
+            instr->operands[1] = next[0]->operands[0];
+            instr->width = window[2] + next[2]->width - pc;
+        }
+        else if (found >= 3 && (next[0]->opcode == LOAD || next[0]->opcode == LOAD_CONST) && isComparison(next[1]->opcode) && next[2]->opcode == EJMPF) {
+            instr->opcode = next[0]->opcode == LOAD ? CMP_LOCALS_EJMPF : CMP_LOCAL_CONST_EJMPF;
+            instr->operands[1] = next[0]->operands[0];
+            instr->operands[2] = next[1]->opcode;
+            instr->width = window[2] + next[2]->width - pc;
+        }
+        else if (found >= 2 && next[0]->opcode == LOAD && next[1]->opcode == AGET) {
+            instr->opcode = LOAD_AGET;
+            instr->operands[1] = next[0]->operands[0];
+            instr->width = window[1] + next[1]->width - pc;
+        }
+    }
+}
+
+bool decodeSourceCode(SourceCode* src, bool fuse) {
+    if (src->loaded)
+        return true;
+    Function* func;
+    for (int i = 0; i < src->length; i++) {
+        func = &src->code[i];
+        func->bytecode = decode(func->body, func->jumpPoints, func->jmpCnt);
+        func->constants = buildConstantPool(func->body, func->bytecode, &func->constCnt);
+        if (fuse)
+            fuseSuperinstructions(func->body, func->bytecode);
+    }
+    src->loaded = linkSourceCode(src);
+    return src->loaded;
+}
+
+bool loadSourceCode(SourceCode* src) {
+    return decodeSourceCode(src, true);
+}
\ No newline at end of file
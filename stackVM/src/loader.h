@@ -0,0 +1,30 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <stdbool.h>
+
+#include "filereader.h"
+#include "bytecode.h"
+
+typedef struct {
+    int capacity;
+    int* slots; // index of the function in SourceCode, -1 for an empty slot
+} SymbolTable;
+
+bool isInt(char* constant);
+bool isDouble(char* constant);
+bool isBool(char* constant);
+char* removeQuotes(char* in);
+DataConstant parseConstant(char* literal);
+Instruction* decode(StringVector* body, JumpPoint* jumps, int jmpCnt);
+SymbolTable* createSymbolTable(SourceCode* src);
+int lookupFunction(SymbolTable* table, SourceCode* src, char* label);
+DataConstant* buildConstantPool(StringVector* body, Instruction* bytecode, int* constCnt);
+void deleteSymbolTable(SymbolTable* table);
+bool linkSourceCode(SourceCode* src);
+int followingInstructions(StringVector* body, Instruction* bytecode, int pc, int* window, int count);
+void fuseSuperinstructions(StringVector* body, Instruction* bytecode);
+bool decodeSourceCode(SourceCode* src, bool fuse);
+bool loadSourceCode(SourceCode* src);
+
+#endif
\ No newline at end of file
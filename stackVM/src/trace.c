@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "trace.h"
+
+TraceHooks verboseHooks = {
+    .onStart = traceStart,
+    .onCycle = display,
+    .onInstruction = NULL,
+    .onExpand = traceExpansion,
+    .onArrayAlloc = traceArrayAlloc,
+    .onCollect = traceCollection,
+    .onHalt = traceHalt
+};
+
+TraceHooks pairHistogramHooks = {
+    .onInstruction = countOpcodePair
+};
+
+void traceStart(UNUSED VM* vm) {
+    printf("Running program...\n");
+}
+
+void traceHalt(UNUSED VM* vm) {
+    printf("-----\nProgram execution complete\n");
+}
+
+void traceExpansion(UNUSED VM* vm, char* resource, long from, long to) {
+    printf("INFO: Expanding %s from %ld to %ld\n", resource, from, to);
+}
+
+void traceArrayAlloc(UNUSED VM* vm, ArrayHeader* array) {
+    printf("INFO: Allocated array %p with capacity %d\n", array, array->capacity);
+}
+
+void traceCollection(VM* vm, long freedBytes) {
+    printf("INFO: Collected %ld bytes of strings and arrays, %ld bytes still live\n", freedBytes, vm->stringBytes + vm->heapBytes);
+}
+
+void enablePairHistogram(VM* vm) {
+    vm->pairCounts = calloc(OPCODE_COUNT * OPCODE_COUNT, sizeof(long));
+    vm->lastOpcode = UNKNOWN;
+    vm->hooks = &pairHistogramHooks;
+    vm->adaptive = false; // count the generic opcodes the program was written with
+}
+
+void countOpcodePair(VM* vm, Instruction* instr) {
+    vm->pairCounts[vm->lastOpcode * OPCODE_COUNT + instr->opcode]++;
+    vm->lastOpcode = instr->opcode;
+}
+
+int comparePairCounts(const void* lhs, const void* rhs) {
+    long diff = ((long*) rhs)[0] - ((long*) lhs)[0];
+    return diff > 0 ? 1 : (diff < 0 ? -1 : 0);
+}
+
+void displayPairHistogram(VM* vm) {
+    long pairs[OPCODE_COUNT * OPCODE_COUNT][2]; // count, pair index
+    int length = 0;
+    for (int i = 0; i < OPCODE_COUNT * OPCODE_COUNT; i++) {
+        if (vm->pairCounts[i] == 0 || i / OPCODE_COUNT == UNKNOWN)
+            continue;
+        pairs[length][0] = vm->pairCounts[i];
+        pairs[length++][1] = i;
+    }
+    qsort(pairs, length, sizeof(pairs[0]), comparePairCounts);
+    printf("-----\nOpcode pair histogram:\n");
+    for (int i = 0; i < length; i++) {
+        printf("%12ld  %s -> %s\n", pairs[i][0], getOpcodeName(pairs[i][1] / OPCODE_COUNT), getOpcodeName(pairs[i][1] % OPCODE_COUNT));
+    }
+}
\ No newline at end of file
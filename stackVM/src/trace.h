@@ -0,0 +1,18 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "vm.h"
+
+extern TraceHooks verboseHooks;
+extern TraceHooks pairHistogramHooks;
+
+void traceStart(VM* vm);
+void traceHalt(VM* vm);
+void traceExpansion(VM* vm, char* resource, long from, long to);
+void traceArrayAlloc(VM* vm, ArrayHeader* array);
+void traceCollection(VM* vm, long freedBytes);
+void enablePairHistogram(VM* vm);
+void countOpcodePair(VM* vm, Instruction* instr);
+void displayPairHistogram(VM* vm);
+
+#endif
\ No newline at end of file
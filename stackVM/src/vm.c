@@ -1,16 +1,29 @@
+#define _GNU_SOURCE // MAP_ANONYMOUS and MAP_NORESERVE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <ctype.h>
 #include <math.h>
 #include <limits.h>
+#include <sys/mman.h>
 
 #include "vm.h"
 #include "builtin.h"
+#include "loader.h"
+#include "trace.h"
+#include "collector.h"
 
 #define ENTRYPOINT "_entry"
 
+// globals reservations at least this large ask for transparent huge pages
+#define HUGE_PAGE_THRESHOLD (1L << 30)
+
+// GNU C labels as values let every handler jump straight to the next one; other compilers loop back to the switch
+#if defined(__GNUC__) && !defined(NO_COMPUTED_GOTO)
+#define USE_COMPUTED_GOTO
+#endif
+
 int findLabelIndex(SourceCode* src, char* label) {
     for (int i = 0; i < src->length; i++) {
         if (strcmp(src->code[i].label, label) == 0)
@@ -22,7 +35,7 @@ int findLabelIndex(SourceCode* src, char* label) {
 VM* init(SourceCode* src, VMConfig conf) {
     VM* vm = malloc(sizeof(VM));
     vm->src = src;
-    vm->fp = 0;
+    vm->fp = -1;
     vm->gp = -1;
     vm->state = success;
 
@@ -38,33 +51,254 @@ VM* init(SourceCode* src, VMConfig conf) {
     vm->stackHardMax = conf.stackSizeHardMax / sizeof(DataConstant);
     vm->stackSoftMax = conf.dynamicResourceExpansionEnabled ? (long) (conf.stackSizeSoftMax / sizeof(DataConstant)) : vm->stackHardMax;
 
-    vm->globals = malloc(conf.dynamicResourceExpansionEnabled || conf.globalsSoftMax == conf.globalsHardMax ? conf.globalsSoftMax : conf.globalsHardMax);
-    vm->callStack = malloc(conf.dynamicResourceExpansionEnabled || conf.framesSoftMax == conf.framesHardMax ? conf.framesSoftMax : conf.framesHardMax);
-    vm->useHeapStorageBackup = conf.useHeapStorageBackup;
+    vm->globalsCapacity = vm->globalsSoftMax > 0 ? vm->globalsSoftMax : 1;
+    if (!reserveGlobals(vm))
+        return NULL;
+    vm->framesCapacity = vm->framesSoftMax;
+    vm->callStack = malloc(sizeof(Frame*) * vm->framesCapacity);
+    vm->arrays = NULL;
+    vm->heapBytes = 0;
+    vm->strings = NULL;
+    vm->stringCount = 0;
+    vm->stringCapacity = 0;
+    vm->ropes = NULL;
+    vm->views = NULL;
+    vm->stringBytes = 0;
+    vm->collectionThreshold = MIN_COLLECTION_THRESHOLD;
+    vm->pins = NULL;
+    vm->hooks = NULL;
+    vm->pairCounts = NULL;
+    vm->lastOpcode = UNKNOWN;
+    vm->adaptive = conf.adaptiveSpecializationEnabled;
+    if (!loadSourceCode(src))
+        return NULL;
     int index = findLabelIndex(src, ENTRYPOINT);
     if (index == -1) {
         fprintf(stderr, "Error: Could not find entry point function label: '%s'\n", ENTRYPOINT);
         return NULL;
     }
-    vm->callStack[0] = loadFrame(src->code[index].body, src->code[index].jumpPoints, src->code[index].jmpCnt, vm->stackSoftMax, vm->localsSoftMax, 0, 0, NULL);
+    vm->frameCount = 0;
+    vm->valuesCapacity = vm->localsSoftMax + vm->stackSoftMax + 1;
+    vm->valuesMinimum = vm->valuesCapacity;
+    vm->values = malloc(sizeof(DataConstant) * vm->valuesCapacity);
+    vm->localsHints = calloc(src->length, sizeof(int));
+    if (vm->values == NULL || vm->localsHints == NULL || vm->callStack == NULL) {
+        fprintf(stderr, "Error: Could not allocate a data stack of %ld values\n", vm->valuesCapacity);
+        return NULL;
+    }
+    enterFrame(vm, index, 0, 0, 0);
     return vm;
 }
 
+/**
+ * Report that a resource moved from its soft maximum to its hard maximum
+ * Only reached on the rare expansion paths, so checking for hooks here costs production runs nothing
+*/
+void traceExpand(VM* vm, char* resource, long from, long to) {
+    if (vm->hooks != NULL && vm->hooks->onExpand != NULL)
+        vm->hooks->onExpand(vm, resource, from, to);
+}
+
 void destroy(VM* vm) {
-    free(vm->globals);
+    ArrayHeader* next;
+    for (ArrayHeader* array = vm->arrays; array != NULL; array = next) {
+        next = array->next;
+        if (--array->storage->refs == 0)
+            free(array->storage);
+        free(array);
+    }
+    for (int i = 0; i < vm->stringCount; i++) {
+        free(vm->strings[i]);
+    }
+    free(vm->strings);
+    RopeNode* nextRope;
+    for (RopeNode* rope = vm->ropes; rope != NULL; rope = nextRope) {
+        nextRope = rope->next;
+        free(rope);
+    }
+    ViewNode* nextView;
+    for (ViewNode* view = vm->views; view != NULL; view = nextView) {
+        nextView = view->next;
+        free(view);
+    }
+    free(vm->pairCounts);
+    if (vm->globalsReserved != 0)
+        munmap(vm->globals, vm->globalsReserved);
+    else
+        free(vm->globals);
+    for (int i = 0; i < vm->frameCount; i++) {
+        deleteFrame(vm->callStack[i]);
+    }
     free(vm->callStack);
+    free(vm->values);
+    free(vm->localsHints);
     free(vm);
 }
 
-void push(VM* vm, DataConstant value, bool verbose) {
+/**
+ * Make sure the data stack holds at least count values
+ * Growing it may move it, in which case the windows of the active frames move with it
+ * Returns false and sets memory_err when the data stack could not be grown
+*/
+bool reserveValues(VM* vm, long count) {
+    if (count <= vm->valuesCapacity)
+        return true;
+    long capacity = vm->valuesCapacity;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    DataConstant* values = realloc(vm->values, sizeof(DataConstant) * capacity);
+    if (values == NULL) {
+        fprintf(stderr, "Error: Could not grow the data stack to %ld values\n", capacity);
+        vm->state = memory_err;
+        return false;
+    }
+    for (int i = 0; i <= vm->fp; i++) {
+        rebaseFrame(vm->callStack[i], vm->values, values);
+    }
+    vm->values = values;
+    vm->valuesCapacity = capacity;
+    return true;
+}
+
+/**
+ * Halve the data stack once the active frames use less than a quarter of it
+ * Growing doubles it, so a program that keeps calling just below a size never has it reallocated back and forth
+*/
+void releaseValues(VM* vm) {
+    if (vm->valuesCapacity <= vm->valuesMinimum)
+        return;
     Frame* frame = vm->callStack[vm->fp];
-    int end = frame->sp + 1;
-    if (!frame->expandedStack && vm->stackSoftMax != vm->stackHardMax && end >= vm->stackSoftMax - 1 && end < vm->stackHardMax) {
-        frame->expandedStack = true;
-        if (verbose)
-            printf("INFO: Expanding current frame stack from %ld to %ld\n", vm->stackSoftMax, vm->stackHardMax);
-        frame = expandStack(frame, vm->stackHardMax);
+    if (frame->stack - vm->values + frame->stackCapacity + 1 >= vm->valuesCapacity / 4)
+        return;
+    long capacity = vm->valuesCapacity / 2;
+    if (capacity < vm->valuesMinimum)
+        capacity = vm->valuesMinimum;
+    DataConstant* values = realloc(vm->values, sizeof(DataConstant) * capacity);
+    if (values == NULL) {
+        fprintf(stderr, "Error: Could not shrink the data stack to %ld values\n", capacity);
+        vm->state = memory_err;
+        return;
+    }
+    for (int i = 0; i <= vm->fp; i++) {
+        rebaseFrame(vm->callStack[i], vm->values, values);
+    }
+    vm->values = values;
+    vm->valuesCapacity = capacity;
+}
+
+/**
+ * Reserve address space for the hard maximum of globals up front
+ * The kernel only commits the pages the program touches, so growing never copies and vm->globals never moves
+ * Falls back to a heap allocation of the soft maximum when the reservation is refused, such as under strict overcommit
+ * Returns false when neither could be allocated
+*/
+bool reserveGlobals(VM* vm) {
+    size_t bytes = sizeof(DataConstant) * (vm->globalsHardMax > 0 ? vm->globalsHardMax : 1);
+    void* globals = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (globals == MAP_FAILED) {
+        vm->globalsReserved = 0;
+        vm->globals = malloc(sizeof(DataConstant) * vm->globalsCapacity);
+        if (vm->globals == NULL) {
+            fprintf(stderr, "Error: Could not allocate %ld globals\n", vm->globalsCapacity);
+            return false;
+        }
+        return true;
+    }
+#ifdef MADV_HUGEPAGE
+    if (bytes >= HUGE_PAGE_THRESHOLD)
+        madvise(globals, bytes, MADV_HUGEPAGE); // only a hint, large heaps still work without huge pages
+#endif
+    vm->globalsReserved = bytes;
+    vm->globals = globals;
+    return true;
+}
+
+/**
+ * Make room for count global variables, doubling the current size but never going past the hard maximum
+ * Reserved globals already have the address space, so only unreserved ones are reallocated
+ * Globals are never removed, so they do not shrink; arrays, the bulk of the heap, are freed by the collector instead
+ * Returns false and sets memory_err when unreserved globals could not be reallocated
+*/
+bool growGlobals(VM* vm, long count) {
+    long capacity = vm->globalsCapacity;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    if (capacity > vm->globalsHardMax)
+        capacity = vm->globalsHardMax;
+    traceExpand(vm, "size of globals", vm->globalsCapacity, capacity);
+    if (vm->globalsReserved == 0) {
+        DataConstant* globals = realloc(vm->globals, sizeof(DataConstant) * capacity);
+        if (globals == NULL) {
+            fprintf(stderr, "Error: Could not grow the globals to %ld values\n", capacity);
+            vm->state = memory_err;
+            return false;
+        }
+        vm->globals = globals;
+    }
+    vm->globalsCapacity = capacity;
+    return true;
+}
+
+// make room for one more frame than the call stack holds, returns false and sets memory_err when the call stack could not be grown
+bool growCallStack(VM* vm) {
+    int capacity = vm->framesCapacity * 2 < vm->framesHardMax ? vm->framesCapacity * 2 : vm->framesHardMax;
+    traceExpand(vm, "number of frames", vm->framesCapacity, capacity);
+    Frame** callStack = realloc(vm->callStack, sizeof(Frame*) * capacity);
+    if (callStack == NULL) {
+        fprintf(stderr, "Error: Could not grow the call stack to %d frames\n", capacity);
+        vm->state = memory_err;
+        return false;
+    }
+    vm->callStack = callStack;
+    vm->framesCapacity = capacity;
+    return true;
+}
+
+/**
+ * Double the operand stack window of the frame on top of the call stack, up to the stack hard maximum
+*/
+bool growStack(VM* vm, Frame* frame) {
+    int capacity = frame->stackCapacity * 2 < vm->stackHardMax ? frame->stackCapacity * 2 : vm->stackHardMax;
+    traceExpand(vm, "current frame stack", frame->stackCapacity, capacity);
+    if (!reserveValues(vm, frame->stack - vm->values + capacity + 1))
+        return false;
+    frame->stackCapacity = capacity;
+    return true;
+}
+
+/**
+ * Push a frame for the function at addr whose locals start base values into the data stack
+ * The argc arguments must already be there, so the caller's stack becomes the callee's first locals
+ * Returned frames are kept in the call stack and reused, so calls do not allocate once the call stack is warm
+ * Returns NULL when the data stack could not be grown for the new frame
+*/
+Frame* enterFrame(VM* vm, int addr, long base, int argc, int returnAddr) {
+    Function* func = &vm->src->code[addr];
+    int localsCapacity = vm->localsHints[addr] > argc ? vm->localsHints[addr] : argc;
+    if (!reserveValues(vm, base + localsCapacity + vm->stackSoftMax + 1)) // push only reports an overflow once sp passes the stack size
+        return NULL;
+    DataConstant* locals = vm->values + base;
+    Frame* frame;
+    if (vm->fp + 1 < vm->frameCount) // a returned call left its frame behind
+        frame = resetFrame(vm->callStack[vm->fp + 1], func->body, func->bytecode, func->jumpPoints, func->jmpCnt, returnAddr, locals, argc, localsCapacity);
+    else {
+        frame = loadFrame(func->body, func->bytecode, func->jumpPoints, func->jmpCnt, returnAddr, locals, argc, localsCapacity);
+        vm->callStack[vm->frameCount++] = frame;
     }
+    frame->constants = func->constants;
+    frame->function = addr;
+    frame->stackCapacity = vm->stackSoftMax;
+    vm->fp++;
+    return frame;
+}
+
+void push(VM* vm, DataConstant value) {
+    Frame* frame = vm->callStack[vm->fp];
+    int end = frame->sp + 1;
+    if (end > frame->stackCapacity && frame->stackCapacity < vm->stackHardMax && !growStack(vm, frame))
+        return;
     if (end > vm->stackHardMax) {
         fprintf(stderr, "StackOverflow: Exceeded stack space of %ld\n", vm->stackHardMax);
         vm->state = memory_err;
@@ -81,14 +315,6 @@ DataConstant top(VM* vm) {
     return frameTop(vm->callStack[vm->fp]);
 }
 
-char* getNext(VM* vm) {
-    return getNextInstruction(vm->callStack[vm->fp]);
-}
-
-char* peekNext(VM* vm) {
-    return peekNextInstruction(vm->callStack[vm->fp]);
-}
-
 void display(VM* vm) {
     printf("---\nfp: %d, gp: %d\n", vm->fp, vm->gp);
     print_array("Globals", vm->globals, vm->gp);
@@ -103,651 +329,350 @@ void display(VM* vm) {
     }
 }
 
-bool isInt(char* constant) {
-    int len = (int) strlen(constant);
-    for (int i = 0; i < len; i++) {
-        if (i == 0 && constant[i] == '-')
-            continue;
-        if (!isdigit(constant[i]))
-            return false;
+void jump(VM* vm, Instruction* instr, int* enterJump, int* jumpedFrom) {
+    Frame* frame = vm->callStack[vm->fp];
+    if (instr->operands[0] == NO_OPERAND) {
+        fprintf(stderr, "Error: Could not find jump point '%s'\n", getFromSV(frame->instructions, instr->operands[1]));
+        vm->state = unknown_bytecode;
+        return;
     }
-    return true;
+    if (*enterJump != instr->operands[2]) // only change jumpedFrom if enterJump changes
+        *jumpedFrom = frame->pc + 1;
+    *enterJump = instr->operands[2];
+    setPC(frame, instr->operands[0]);
 }
 
-bool isDouble(char* constant) {
-    int dotCount = 0;
-    int len = (int) strlen(constant);
-    for (int i = 0; i < len; i++) {
-        if (i == 0 && constant[i] == '-')
-            continue;
-        if (constant[i] == '.')
-            dotCount++;
-        else if (!isdigit(constant[i]))
-            return false;
+void exitJump(VM* vm, Instruction* instr, int* jumpedFrom) {
+    Frame* frame = vm->callStack[vm->fp];
+    setPC(frame, instr->operands[0]);
+    if (*jumpedFrom != 0) {
+        setPC(frame, *jumpedFrom - 1);
+        *jumpedFrom = 0;
     }
-    return dotCount == 1;
 }
 
-bool isBool(char* constant) {
-    return strcmp(constant, "true") == 0 || strcmp(constant, "false") == 0;
+/**
+ * Double the locals window of the frame on top of the call stack by moving its operand stack up
+ * Later calls of the same function start with the larger window
+*/
+bool growLocals(VM* vm, Frame* frame) {
+    int capacity = frame->localsCapacity < 4 ? 8 : frame->localsCapacity * 2;
+    if (capacity > vm->localsHardMax)
+        capacity = vm->localsHardMax;
+    if (capacity > vm->localsSoftMax)
+        traceExpand(vm, "local storage", frame->localsCapacity, capacity);
+    if (!reserveValues(vm, frame->locals - vm->values + capacity + frame->stackCapacity + 1))
+        return false;
+    moveStack(frame, capacity);
+    if (capacity > vm->localsHints[frame->function])
+        vm->localsHints[frame->function] = capacity;
+    return true;
+}
+
+/**
+ * Halve the locals hint of a returning call's function when the call used less than a quarter of it
+ * One deep call then sizes the next calls at its peak only until shallower calls wear the hint back down
+*/
+void releaseLocalsHint(VM* vm, Frame* frame) {
+    int* hint = &vm->localsHints[frame->function];
+    if (*hint > 8 && frame->lp + 1 < *hint / 4)
+        *hint /= 2;
 }
 
-char* removeQuotes(char* in) {
-    int len = strlen(in);
-    char out[len - 2];
-    int index = 0;
-    for (int i = 1; i < len - 1; i++) {
-        out[index++] = in[i];
+void storeValue(VM* vm, int addr) {
+    DataConstant value = pop(vm);
+    Frame* frame = vm->callStack[vm->fp];
+    if (addr != NO_OPERAND) {
+        storeLocalAtAddr(frame, value, addr);
+    }
+    else {
+        int total = frame->lp + 2;
+        if (total > vm->localsHardMax) {
+            fprintf(stderr, "StackOverflow: Exceeded local storage maximum of %ld\n", vm->localsHardMax);
+            vm->state = memory_err;
+            return;
+        }
+        if (frame->lp + 1 == frame->localsCapacity && !growLocals(vm, frame))
+            return;
+        storeLocal(frame, value);
     }
-    out[index] = '\0';
-    return strdup(out);
 }
 
-void stepOver(VM* vm) {
-    incrementPC(vm->callStack[vm->fp]);
+bool exceedsGlobals(VM* vm, long bytes) {
+    return (vm->gp + 1) * sizeof(DataConstant) + vm->heapBytes + bytes > vm->globalsHardMax * sizeof(DataConstant);
 }
 
-void jump(VM* vm, char* label, char** enterJump, int* jumpedFrom) {
-    int addr = getJumpStart(vm->callStack[vm->fp], label);
-    if (addr == -1) {
-        fprintf(stderr, "Error: Could not find jump point '%s'\n", label);
-        vm->state = unknown_bytecode;
+/**
+ * Check that bytes more array storage fit the globals budget, collecting unreachable arrays first when they do not
+*/
+bool reserveHeap(VM* vm, long bytes) {
+    if (exceedsGlobals(vm, bytes))
+        collectGarbage(vm);
+    if (exceedsGlobals(vm, bytes)) {
+        fprintf(stderr, "HeapOverflow: Exceeded global storage maximum of %ld\n", vm->globalsHardMax);
+        vm->state = memory_err;
+        return false;
     }
-    if (strcmp(*enterJump, label) != 0) // only change jumpedFrom if enterJump changes
-        *jumpedFrom = vm->callStack[vm->fp]->pc + 1;
-    *enterJump = label;
-    setPC(vm->callStack[vm->fp], addr);
+    return true;
 }
 
-void skipJump(VM* vm, char* label) {
-    int addr = getJumpEnd(vm->callStack[vm->fp], label);
-    if (addr == -1) {
-        fprintf(stderr, "Error: Could not find jump point '%s'\n", label);
-        vm->state = unknown_bytecode;
+/**
+ * Create an array object for storage and hand it to the collector
+ * Sets memory_err and returns None when the object could not be allocated, the caller still owns storage then
+*/
+DataConstant linkArray(VM* vm, ArrayStorage* storage, int capacity) {
+    ArrayHeader* array = malloc(sizeof(ArrayHeader));
+    if (array == NULL) {
+        fprintf(stderr, "Error: Could not allocate an array\n");
+        vm->state = memory_err;
+        return createNone();
     }
-    setPC(vm->callStack[vm->fp], addr);
+    array->capacity = capacity;
+    array->length = 0;
+    array->elementType = None;
+    array->holdsArrays = false;
+    array->marked = false;
+    array->storage = storage;
+    array->next = vm->arrays;
+    vm->arrays = array;
+    vm->heapBytes += sizeof(ArrayHeader);
+    if (vm->hooks != NULL && vm->hooks->onArrayAlloc != NULL)
+        vm->hooks->onArrayAlloc(vm, array);
+    return createAddr(array);
 }
 
-DataConstant load(VM* vm) {
-    int addr = atoi(getNext(vm));
-    return loadLocal(vm->callStack[vm->fp], addr);
+/**
+ * Allocate an empty array object with room for capacity elements
+ * Arrays share the globals budget with the global variables; when it runs out the collector frees unreachable arrays first
+ * Callers must keep every value they still need on the stack or pinned; still running out sets memory_err and returns None
+*/
+DataConstant allocateArray(VM* vm, int capacity) {
+    long bytes = sizeof(ArrayStorage) + sizeof(DataConstant) * capacity;
+    if (!reserveHeap(vm, sizeof(ArrayHeader) + bytes))
+        return createNone();
+    ArrayStorage* storage = malloc(bytes);
+    if (storage == NULL) {
+        fprintf(stderr, "Error: Could not allocate an array of %d elements\n", capacity);
+        vm->state = memory_err;
+        return createNone();
+    }
+    storage->refs = 1;
+    for (int i = 0; i < capacity; i++) {
+        storage->values[i] = createNone();
+    }
+    DataConstant array = linkArray(vm, storage, capacity);
+    if (valueType(array) == None)
+        free(storage);
+    else
+        vm->heapBytes += bytes;
+    return array;
 }
 
-void storeValue(VM* vm, bool verbose) {
-    DataConstant value = pop(vm);
-    Frame* frame = vm->callStack[vm->fp];
-    char* next = peekNext(vm);
-    if (isInt(next)) {
-        storeLocalAtAddr(frame, value, atoi(next));
-        stepOver(vm);
+/**
+ * Copy length elements of src starting at begin into a new array of the given capacity
+ * A whole array without nested arrays shares src's storage until one of them is written
+ * Nested arrays are copied as well so writing through the copy never changes src
+*/
+DataConstant copyArray(VM* vm, DataConstant src, int begin, int length, int capacity) {
+    ArrayHeader* source = getArrayHeader(src);
+    if (begin == 0 && length == source->length && capacity == source->capacity && !source->holdsArrays) {
+        if (!reserveHeap(vm, sizeof(ArrayHeader)))
+            return createNone();
+        DataConstant copy = linkArray(vm, source->storage, capacity);
+        if (valueType(copy) == None)
+            return copy;
+        source->storage->refs++;
+        getArrayHeader(copy)->length = length;
+        getArrayHeader(copy)->elementType = source->elementType;
+        return copy;
     }
-    else {
-        int total = frame->lp + value.size + 1;
-        if (!frame->expandedLocals && vm->localsSoftMax != vm->localsHardMax && total >= vm->localsSoftMax - 1 && total < vm->localsHardMax) {
-            if (verbose)
-                printf("INFO: Expanding local storage from %ld to %ld\n", vm->localsSoftMax, vm->localsHardMax);
-            *frame = *(expandLocals(frame, vm->localsHardMax));
-            frame->expandedLocals = true;
-        }
-        if (total > vm->localsHardMax) {
-            fprintf(stderr, "StackOverflow: Exceeded local storage maximum of %ld\n", vm->localsHardMax);
-            vm->state = memory_err;
-            return;
+    DataConstant copy = allocateArray(vm, capacity);
+    if (valueType(copy) == None)
+        return copy;
+    Pin pin = {copy, vm->pins}; // copying nested arrays allocates while the copy is not reachable yet
+    vm->pins = &pin;
+    ArrayHeader* array = getArrayHeader(copy);
+    DataConstant* start = getArrayStart(src) + begin;
+    DataConstant element;
+    for (int i = 0; i < length; i++) {
+        element = start[i];
+        if (valueType(element) == Addr) {
+            element = copyArray(vm, element, 0, getArrayHeader(element)->length, getArrayHeader(element)->capacity);
+            if (valueType(element) == None) {
+                copy = element;
+                break;
+            }
         }
-        storeLocal(frame, value);
+        setArrayElement(array, i, element);
+        array->length++;
     }
+    vm->pins = pin.next;
+    return copy;
 }
 
-ArrayTarget checkAndRetrieveArrayValuesTarget(VM* vm, Frame* frame, int arraySize, bool* globalsExpanded, bool verbose) {
-    ArrayTarget arrayTarget;
-    arrayTarget.target = frame->locals;
-    arrayTarget.targetp = &frame->lp;
-    arrayTarget.frame = frame;
-    int total = frame->lp + arraySize + 1;
-    if (!frame->expandedLocals && vm->localsSoftMax != vm->localsHardMax && total >= vm->localsSoftMax - 1 && total < vm->localsHardMax) {
-        if (verbose)
-            printf("INFO: Expanding local storage from %ld to %ld\n", vm->localsSoftMax, vm->localsHardMax);
-        arrayTarget.frame = expandLocals(frame, vm->localsHardMax);
-        arrayTarget.frame->expandedLocals = true;
-        arrayTarget.target = frame->locals;
-        arrayTarget.targetp = &frame->lp;
-    }
-    if (total > vm->localsHardMax) {
-        if (vm->useHeapStorageBackup) {
-            arrayTarget.target = vm->globals;
-            arrayTarget.targetp = &vm->gp;
-            total = vm->gp + arraySize + 1;
-            if (!(*globalsExpanded) && vm->globalsSoftMax != vm->globalsHardMax && total >= vm->globalsSoftMax - 1 && total < vm->globalsHardMax) {
-                if (verbose)
-                    printf("INFO: Expanding size of globals from %ld to %ld\n", vm->globalsSoftMax, vm->globalsHardMax);
-                *globalsExpanded = true;
-                vm->globals = realloc(vm->globals, sizeof(DataConstant) * vm->globalsHardMax);
-                arrayTarget.target = vm->globals;
-            }
-            if (total > vm->globalsHardMax) {
-                fprintf(stderr, "HeapOverflow: Exceeded local storage maximum of %ld and global storage maximum of %ld\n", vm->localsHardMax, vm->globalsHardMax);
-                vm->state = memory_err;
-                return arrayTarget;
-            }
-            if (verbose)
-                printf("INFO: Using heap storage for array %p\n", vm->globals + vm->gp + 1);
-        }
-        else {
-            fprintf(stderr, "StackOverflow: Exceeded local storage maximum of %ld\n", vm->localsHardMax);
+/**
+ * Give an array its own storage before it is written if copies still share it
+ * Does not collect since the array may only be held by a builtin's parameters; running out of budget sets memory_err and returns false
+*/
+bool unshareArray(VM* vm, DataConstant array) {
+    ArrayHeader* header = getArrayHeader(array);
+    if (header->storage->refs == 1)
+        return true;
+    long bytes = sizeof(ArrayStorage) + sizeof(DataConstant) * header->capacity;
+    if (exceedsGlobals(vm, bytes)) {
+        fprintf(stderr, "HeapOverflow: Exceeded global storage maximum of %ld\n", vm->globalsHardMax);
+        vm->state = memory_err;
+        return false;
+    }
+    ArrayStorage* storage = malloc(bytes);
+    if (storage == NULL) {
+        fprintf(stderr, "Error: Could not allocate an array of %d elements\n", header->capacity);
+        vm->state = memory_err;
+        return false;
+    }
+    storage->refs = 1;
+    memcpy(storage->values, header->storage->values, sizeof(DataConstant) * header->capacity);
+    header->storage->refs--;
+    header->storage = storage;
+    vm->heapBytes += bytes;
+    return true;
+}
+
+/**
+ * Hand a string allocated with malloc to the VM
+ * The VM owns it from then on and the collector frees it once no frame, global or array refers to it
+ * When the string table cannot grow the string is freed, memory_err is set and an empty literal is returned instead
+*/
+DataConstant adoptString(VM* vm, char* value) {
+    if (vm->stringCount == vm->stringCapacity) {
+        int capacity = vm->stringCapacity == 0 ? 64 : vm->stringCapacity * 2;
+        char** strings = realloc(vm->strings, sizeof(char*) * capacity);
+        if (strings == NULL) {
+            fprintf(stderr, "Error: Could not grow the string table to %d strings\n", capacity);
+            free(value);
             vm->state = memory_err;
-            return arrayTarget;
+            return createString("");
         }
+        vm->strings = strings;
+        vm->stringCapacity = capacity;
     }
-    return arrayTarget;
+    vm->strings[vm->stringCount++] = value;
+    vm->stringBytes += strlen(value) + 1;
+    return createString(value);
 }
 
-ExitCode run(VM* vm, bool verbose) {
-    if (verbose)
-        printf("Running program...\n");
-    char* opcode;
-    DataConstant value, lhs, rhs, rval;
-    Frame* currentFrame;
-    char* next;
-    int addr, argc, offset, total;
-    char* enterJump = "";
-    int jumpedFrom = 0;
-    JumpPoint jumpPoint;
-    bool skipped = false;
-    bool framesExpanded = false;
-    bool globalsExpanded = false;
-    ArrayTarget arrayTarget;
-    while (1) {
-        if (vm->state != success)
-            return vm->state;
-        if (verbose)
-            display(vm);
-        opcode = getNext(vm);
-        currentFrame = vm->callStack[vm->fp];
-        for (int i = 0; i < currentFrame->jc; i++) {
-            jumpPoint = currentFrame->jumps[i];
-            if (currentFrame->pc - 1 == jumpPoint.start) {
-                if (strlen(enterJump) == 0) {
-                    skipJump(vm, jumpPoint.label);
-                    skipped = true;
-                }
-                else {
-                    if (strcmp(jumpPoint.label, enterJump) == 0) {
-                        enterJump = "";
-                        break;
-                    }
-                    skipJump(vm, jumpPoint.label);
-                    skipped = true;
-                }
-            }
-        }
-        if (skipped) {
-            skipped = false;
-            continue;
-        }
-        if (strcmp(opcode, "EJMP") == 0) {
-            if (jumpedFrom != 0) {
-                setPC(vm->callStack[vm->fp], jumpedFrom - 1);
-                jumpedFrom = 0;
-            }
-            continue;
-        }
-        if (strcmp(opcode, "HALT") == 0) {
-            if (verbose)
-                printf("-----\nProgram execution complete\n");
-            return success; // stop program with a successful exit code
-        }
-        else if (strcmp(opcode, "LOAD_CONST") == 0) {
-            next = getNext(vm);
-            if (isInt(next))
-                value = readInt(next);
-            else if (isDouble(next))
-                value = readDouble(next);
-            else if (isBool(next))
-                value = readBoolean(next);
-            else if (startsWith(next, '"')) {
-                value = createString(removeQuotes(next));
-            }
-            else if (strcmp(next, "NULL") == 0)
-                value = createNull();
-            else if (strcmp(next, "NONE") == 0)
-                value = createNone();
-            push(vm, value, verbose);
-        }
-        else if (strcmp(opcode, "DUP") == 0) {
-            if (stackIsEmpty(currentFrame)) {
-                fprintf(stderr, "Error: No value to duplicate\n");
-                return operation_err;
-            }
-            value = top(vm);
-            push(vm, value, verbose);
-        }
-        else if (strcmp(opcode, "POP") == 0) {
-            if (stackIsEmpty(currentFrame)) {
-                fprintf(stderr, "Error: Attempted to POP empty stack\n");
-                return operation_err;
-            }
-            pop(vm);
-        }
-        else if (strcmp(opcode, "CONCAT") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            if (lhs.type == Str) {
-                size_t size = strlen(lhs.value.strVal) + strlen(rhs.value.strVal) + 1;
-                char* concat = strncat(strdup(lhs.value.strVal), rhs.value.strVal, size); // using strdup here prevents the LHS value from being overwritten in the heap
-                rval = createString(concat);
-            }
-            else if (lhs.type == Addr) {
-                arrayTarget = checkAndRetrieveArrayValuesTarget(vm, currentFrame, lhs.size + rhs.size, &globalsExpanded, verbose);
-                if (vm->state != success)
-                    return vm->state;
-                *currentFrame = *arrayTarget.frame;
-                if (lhs.value.address != vm->globals)
-                    lhs.value.address = currentFrame->locals;
-                if (rhs.value.address != vm->globals)
-                    rhs.value.address = currentFrame->locals;
-                rval = createAddr(arrayTarget.target, *(arrayTarget.targetp) + 1, lhs.size + rhs.size, lhs.length + rhs.length);
-                DataConstant* start = getArrayStart(lhs);
-                DataConstant* stop = start + lhs.length;
-                for (DataConstant* curr = start; curr != stop; curr++) {
-                    arrayTarget.target[++(*arrayTarget.targetp)] = *curr;
-                }
-                start = getArrayStart(rhs);
-                stop = start + rhs.length;
-                for (DataConstant* curr = start; curr != stop; curr++) {
-                    arrayTarget.target[++(*arrayTarget.targetp)] = *curr;
-                }
-                if (rval.length < rval.size) {
-                    for (int i = rval.length; i < rval.size; i++) {
-                        arrayTarget.target[++(*arrayTarget.targetp)] = createNone();
-                    }
-                }
-            }
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "REPEATSTR") == 0) {
-            rhs = pop(vm);
-            argc = atoi(getNext(vm));
-            if (argc <= 0)
-                push(vm, createString(""), verbose);
-            else if (argc == 1)
-                push(vm, rhs, verbose);
-            else {
-                strcpy(next, rhs.value.strVal);
-                for (int i = 1; i < argc; i++) {
-                    next = strncat(next, rhs.value.strVal, strlen(rhs.value.strVal));
-                }
-                push(vm, createString(next), verbose);
-            }
-        }
-        else if (strcmp(opcode, "ADD") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = binaryArithmeticOperation(lhs, rhs, "+");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "SUB") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = binaryArithmeticOperation(lhs, rhs, "-");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "MUL") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = binaryArithmeticOperation(lhs, rhs, "*");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "DIV") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = binaryArithmeticOperation(lhs, rhs, "/");
-            if (rval.type == None)
-                return operation_err;
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "REM") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = binaryArithmeticOperation(lhs, rhs, "mod");
-            if (rval.type == None)
-                return operation_err;
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "POW") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = binaryArithmeticOperation(lhs, rhs, "exp");
-            if (rval.type == None)
-                return operation_err;
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "EQ") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = compareData(lhs, rhs, "==");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "NE") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = compareData(lhs, rhs, "!=");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "LT") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = compareData(lhs, rhs, "<");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "LE") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = compareData(lhs, rhs, "<=");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "GT") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = compareData(lhs, rhs, ">");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "GE") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval = compareData(lhs, rhs, ">=");
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "NOT") == 0) {
-            rhs = pop(vm);
-            rval.type = Bool;
-            rval.size = 1;
-            rval.value.boolVal = !rhs.value.boolVal;
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "OR") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval.type = Bool;
-            rval.size = 1;
-            rval.value.boolVal = lhs.value.boolVal || rhs.value.boolVal;
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "AND") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval.type = Bool;
-            rval.size = 1;
-            rval.value.boolVal = lhs.value.boolVal && rhs.value.boolVal;
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "XOR") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval.type = Int;
-            rval.size = 1;
-            if (lhs.type == Int)
-                rval.value.intVal = rhs.type == Int ? lhs.value.intVal ^ rhs.value.intVal : lhs.value.intVal ^ rhs.value.boolVal;
-            if (lhs.type == Bool)
-                rval.value.intVal = rhs.type == Bool ? lhs.value.boolVal ^ rhs.value.boolVal : lhs.value.boolVal ^ rhs.value.intVal;
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "B_AND") == 0) {
-            rhs = pop(vm);
-            lhs = pop(vm);
-            rval.type = Int;
-            rval.size = 1;
-            if (lhs.type == Int)
-                rval.value.intVal = rhs.type == Int ? lhs.value.intVal & rhs.value.intVal : lhs.value.intVal & rhs.value.boolVal;
-            if (lhs.type == Bool)
-                rval.value.intVal = rhs.type == Bool ? lhs.value.boolVal & rhs.value.boolVal : lhs.value.boolVal & rhs.value.intVal;
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "STORE") == 0) {
-            if (stackIsEmpty(currentFrame)) {
-                fprintf(stderr, "Error: no value to store\n");
-                return operation_err;
-            }
-            storeValue(vm, verbose);
-        }
-        else if (strcmp(opcode, "LOAD") == 0) {
-            value = load(vm);
-            push(vm, value, verbose);
-        }
-        else if (strcmp(opcode, "GSTORE") == 0) {
-            if (stackIsEmpty(currentFrame)) {
-                fprintf(stderr, "Error: no value to store\n");
-                return operation_err;
-            }
-            value = pop(vm);
-            total = vm->gp + value.size + 1;
-            if (value.type == Addr) {
-                //printf("%ld\n", vm->globalsHardMax);
-                if (!globalsExpanded && vm->globalsSoftMax != vm->globalsHardMax && total >= vm->globalsSoftMax - 1 && total < vm->globalsHardMax) {
-                    if (verbose)
-                        printf("INFO: Expanding size of globals from %ld to %ld\n", vm->globalsSoftMax, vm->globalsHardMax);
-                    globalsExpanded = true;
-                    vm->globals = realloc(vm->globals, sizeof(DataConstant) * vm->globalsHardMax);
-                }
-                if (total > vm->globalsHardMax) {
-                    fprintf(stderr, "HeapOverflow: Global storage hard maximum of %ld reached\n", vm->globalsHardMax);
-                    return memory_err;
-                }
-                value = copyAddr(value, &vm->gp, &vm->globals);
-            }
-            next = peekNext(vm);
-            if (isInt(next)) { // overwrite the value of an existing variable
-                vm->globals[atoi(next)] = value;
-                stepOver(vm);
-            }
-            else {
-                if (!globalsExpanded && vm->globalsSoftMax != vm->globalsHardMax && total >= vm->globalsSoftMax - 1 && total < vm->globalsHardMax) {
-                    if (verbose)
-                        printf("INFO: Expanding size of globals from %ld to %ld\n", vm->globalsSoftMax, vm->globalsHardMax);
-                    globalsExpanded = true;
-                    vm->globals = realloc(vm->globals, sizeof(DataConstant) * vm->globalsHardMax);
-                }
-                if (total > vm->globalsHardMax) {
-                    fprintf(stderr, "HeapOverflow: Global storage hard maximum of %ld reached\n", vm->globalsHardMax);
-                    return memory_err;
-                }
-                vm->globals[++vm->gp] = value;
-            }
-        }
-        else if (strcmp(opcode, "GLOAD") == 0) {
-            addr = atoi(getNext(vm));
-            value = vm->globals[addr];
-            push(vm, value, verbose);
-        }
-        else if (strcmp(opcode, "JMP") == 0) {
-            next = getNext(vm);
-            jump(vm, next, &enterJump, &jumpedFrom);
-        }
-        else if (strcmp(opcode, "JMPT") == 0) {
-            next = getNext(vm);
-            if (pop(vm).value.boolVal) {
-                jumpedFrom = currentFrame->pc + 1;
-                jump(vm, next, &enterJump, &jumpedFrom);
-            }
-        }
-        else if (strcmp(opcode, "JMPF") == 0) {
-            next = getNext(vm);
-            if (!pop(vm).value.boolVal)
-                jump(vm, next, &enterJump, &jumpedFrom);
-        }
-        else if (strcmp(opcode, "SJMPT") == 0) {
-            // short circuit for and/or statements
-            next = getNext(vm);
-            if (top(vm).value.boolVal)
-                jump(vm, next, &enterJump, &jumpedFrom);
-        }
-        else if (strcmp(opcode, "SJMPF") == 0) {
-            // short circuit for and/or statements
-            next = getNext(vm);
-            if (!top(vm).value.boolVal)
-                jump(vm, next, &enterJump, &jumpedFrom);
-        }
-        else if (strcmp(opcode, "EJMPT") == 0) {
-            // skip the rest of the jump block
-            if (pop(vm).value.boolVal) {
-                next = getNext(vm);
-                while (strcmp(next, "EJMP") != 0) {
-                    next = getNext(vm);
-                }
-                if (jumpedFrom != 0) {
-                    setPC(vm->callStack[vm->fp], jumpedFrom - 1);
-                    jumpedFrom = 0;
-                }
-                continue;
-            }
-        }
-        else if (strcmp(opcode, "EJMPF") == 0) {
-            // skip the rest of the jump block
-            if (!pop(vm).value.boolVal) {
-                next = getNext(vm);
-                while (strcmp(next, "EJMP") != 0) {
-                    next = getNext(vm);
-                }
-                if (jumpedFrom != 0) {
-                    setPC(vm->callStack[vm->fp], jumpedFrom - 1);
-                    jumpedFrom = 0;
-                }
-                continue;
-            }
-        }
-        else if (strcmp(opcode, "SELECT") == 0) {
-            if (pop(vm).value.boolVal) {
-                value = pop(vm); // save the first value to push it back onto the stack
-                pop(vm); // pop the second value off the stack
-                push(vm, value, verbose);
-            }
-            else {
-                pop(vm); // use the second value on the stack as the "return" value
-            }
-        }
-        else if (strcmp(opcode, "CALL") == 0) {
-            next = getNext(vm);
-            argc = atoi(getNext(vm));
-            DataConstant params[argc];
-            for (int i = 0; i < argc; i++) {
-                params[i] = pop(vm);
-            }
-            if (isBuiltinFunction(next)) {
-                rval = callBuiltinFunction(next, argc, params, vm, currentFrame, &globalsExpanded, verbose);
-                if (vm->state != success)
-                    return vm->state;
-                if (rval.type != None) {
-                    push(vm, rval, verbose);
-                }
-            }
-            else {
-                addr = findLabelIndex(vm->src, next);
-                if (addr == -1) {
-                    fprintf(stderr, "Error: could not find function '%s'\n", next);
-                    return unknown_bytecode;
-                }
-                if (!framesExpanded && vm->framesSoftMax != vm->framesHardMax && vm->fp + 1 >= vm->framesSoftMax - 2 && vm->fp + 1 < vm->framesHardMax - 1) {
-                    if (verbose)
-                        printf("INFO: Expanding number of frames from %hd to %hd\n", vm->framesSoftMax, vm->framesHardMax);
-                    framesExpanded = true;
-                    vm->callStack = realloc(vm->callStack, sizeof(Frame) * vm->framesHardMax);
-                }
-                if (vm->fp + 1 > vm->framesHardMax - 1) {
-                    fprintf(stderr, "StackOverflow: Number of frames exceeded frame hard maximum of %hd\n", vm->framesHardMax);
-                    return  memory_err;
-                }
-                Frame* frame = loadFrame(vm->src->code[addr].body, vm->src->code[addr].jumpPoints, vm->src->code[addr].jmpCnt, vm->stackSoftMax, vm->localsSoftMax, currentFrame->pc, argc, params);
-                vm->callStack[++vm->fp] = frame;
-            }
-            
-        }
-        else if (strcmp(opcode, "RET") == 0) {
-            rval = pop(vm);
-            addr = currentFrame->returnAddr;
-            Frame* caller = vm->callStack[--vm->fp];
-            setPC(caller, addr);
-            if (rval.type != None) {
-                if (rval.type == Addr && rval.value.address != vm->globals) {
-                    arrayTarget = checkAndRetrieveArrayValuesTarget(vm, caller, rval.size, &globalsExpanded, verbose);
-                    if (vm->state != success)
-                        return vm->state;
-                    caller = arrayTarget.frame;
-                    rval = copyAddr(rval, arrayTarget.targetp, &arrayTarget.target);
-                }
-                push(vm, rval, verbose);
-            }
-            deleteFrame(currentFrame);
-        }
-        else if (strcmp(opcode, "BUILDARR") == 0) {
-            int capacity = atoi(getNext(vm));
-            if (isInt(peekNext(vm)))
-                argc = atoi(getNext(vm));
-            else {
-                argc = capacity;
-                capacity = top(vm).value.intVal;
-            }
-            if (argc > capacity) {
-                fprintf(stderr, "Error: Attempted to build array of length %d which exceeds capacity %d\n", argc, capacity);
-                return memory_err;
-            }
-            arrayTarget = checkAndRetrieveArrayValuesTarget(vm, currentFrame, capacity, &globalsExpanded, verbose);
-            if (vm->state != success)
-                return vm->state;
-            currentFrame = arrayTarget.frame;
-            rval = createAddr(arrayTarget.target, (*arrayTarget.targetp) + 1, capacity, argc);
-            for (int i = 0; i < argc; i++) {
-                arrayTarget.target[++(*arrayTarget.targetp)] = pop(vm);
-            }
-            if (capacity > argc) {
-                for (int i = argc; i < capacity; i++) {
-                    arrayTarget.target[++(*arrayTarget.targetp)] = createNone();
-                }
-            }
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "COPYARR") == 0) {
-            rhs = pop(vm);
-            arrayTarget = checkAndRetrieveArrayValuesTarget(vm, currentFrame, rhs.size, &globalsExpanded, verbose);
+/**
+ * Concatenate two strings, either of which may be a rope or a view
+ * Long results only record their two parts, so building a string in a loop copies each character once when it is read
+*/
+DataConstant concatStrings(VM* vm, DataConstant lhs, DataConstant rhs) {
+    long lhsLength = getStringLength(lhs);
+    long rhsLength = getStringLength(rhs);
+    if (lhsLength + rhsLength < MIN_ROPE_LENGTH) { // neither part can be a rope
+        char* string = malloc(lhsLength + rhsLength + 1);
+        memcpy(string, getCharacters(lhs), lhsLength);
+        memcpy(string + lhsLength, getCharacters(rhs), rhsLength);
+        string[lhsLength + rhsLength] = '\0';
+        return adoptString(vm, string);
+    }
+    RopeNode* rope = malloc(sizeof(RopeNode));
+    rope->length = lhsLength + rhsLength;
+    rope->marked = false;
+    rope->left = lhs;
+    rope->right = rhs;
+    rope->flat = NULL;
+    rope->next = vm->ropes;
+    vm->ropes = rope;
+    vm->stringBytes += sizeof(RopeNode);
+    return createRope(rope);
+}
+
+/**
+ * Take length characters of a string or view starting at start without copying them
+ * Views of a view borrow from the string that owns the characters, so no view ever keeps another one alive
+ * Callers check the range
+*/
+DataConstant sliceString(VM* vm, DataConstant string, long start, long length) {
+    if (valueType(string) == Rope)
+        string = flattenString(vm, string);
+    ViewNode* view = malloc(sizeof(ViewNode));
+    view->length = length;
+    view->marked = false;
+    view->parent = asString(string);
+    if (valueType(string) == View) {
+        ViewNode* source = getView(string);
+        view->parent = source->parent != NULL ? source->parent : source->flat;
+    }
+    view->start = getCharacters(string) + start;
+    view->flat = NULL;
+    view->next = vm->views;
+    vm->views = view;
+    vm->stringBytes += sizeof(ViewNode);
+    return createView(view);
+}
+
+/**
+ * Get the characters of a string as a NUL terminated string
+ * A rope or view is copied into a string of its own the first time and keeps it for later reads
+ * Values of any other type are returned unchanged
+*/
+DataConstant flattenString(VM* vm, DataConstant value) {
+    if (valueType(value) == View) {
+        ViewNode* view = getView(value);
+        if (view->flat == NULL) {
+            char* flat = malloc(view->length + 1);
+            memcpy(flat, view->start, view->length);
+            flat[view->length] = '\0';
+            DataConstant adopted = adoptString(vm, flat);
             if (vm->state != success)
-                return vm->state;
-            currentFrame = arrayTarget.frame;
-            rval = copyAddr(rhs, arrayTarget.targetp, &arrayTarget.target);
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "AGET") == 0) {
-            offset = pop(vm).value.intVal;
-            lhs = pop(vm);
-            DataConstant* start = getArrayStart(lhs);
-            if (offset > lhs.size || offset < 0) {
-                fprintf(stderr, "Error: Array index %d out of range %d\n", offset, lhs.size);
-                return memory_err;
-            }
-            rval = *(start + offset);
-            push(vm, rval, verbose);
-        }
-        else if (strcmp(opcode, "ASTORE") == 0) {
-            offset = pop(vm).value.intVal;
-            lhs = pop(vm);
-            DataConstant* start = getArrayStart(lhs);
-            if (offset >= lhs.size || offset < 0) {
-                fprintf(stderr, "Error: Array index %d out of range %d\n", offset, lhs.size);
-                return memory_err;
-            }
-            rhs = pop(vm);
-            rval = *(start + offset);
-            if (rval.type == None) {
-                if (offset > lhs.length + 1) {
-                    fprintf(stderr, "Error: Cannot write to index %d since previous index values are not initialized\n", offset);
-                    return memory_err;
-                }
-                lhs.length++;
-            }
-            *(start + offset) = rhs;
-            push(vm, lhs, verbose);
-        }
-        else {
-            fprintf(stderr, "Unknown bytecode: '%s'\n", opcode);
-            return unknown_bytecode;
+                return adopted;
+            view->flat = asString(adopted);
+            view->start = view->flat;
+            view->parent = NULL; // the parent can be collected now
         }
+        return createString(view->flat);
     }
-    return success;
+    if (valueType(value) != Rope)
+        return value;
+    RopeNode* rope = getRope(value);
+    if (rope->flat == NULL) {
+        DataConstant adopted = adoptString(vm, writeRope(rope));
+        if (vm->state != success)
+            return adopted;
+        rope->flat = asString(adopted);
+        rope->left = createNone(); // the parts can be collected now
+        rope->right = createNone();
+    }
+    return createString(rope->flat);
+}
+
+/**
+ * Decide whether the jump block starting at instr runs
+ * Blocks only run when they were jumped into, otherwise execution moves to the block's EJMP
+*/
+bool enterBlock(Frame* frame, Instruction* instr, int* enterJump) {
+    if (*enterJump == instr->block) {
+        *enterJump = NO_OPERAND;
+        return true;
+    }
+    setPC(frame, frame->jumps[instr->block].end);
+    return false;
+}
+
+#define INTERPRETER runProduction
+#define TRACING 0
+#include "interpreter.inc"
+#undef INTERPRETER
+#undef TRACING
+
+#define INTERPRETER runTracing
+#define TRACING 1
+#include "interpreter.inc"
+#undef INTERPRETER
+#undef TRACING
+
+ExitCode run(VM* vm, bool verbose) {
+    if (verbose && vm->hooks == NULL)
+        vm->hooks = &verboseHooks;
+    return vm->hooks != NULL ? runTracing(vm) : runProduction(vm);
 }
\ No newline at end of file
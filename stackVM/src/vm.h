@@ -6,14 +6,34 @@
 #include "exitcode.h"
 #include "config.h"
 
+#define UNUSED __attribute__((unused)) // for parameters every builtin handler or trace hook takes but not all of them read
+
+typedef struct TraceHooks TraceHooks;
+
+/**
+ * A value only C code holds while it allocates; the collector treats it as a root until it is unpinned
+ * Pins live on the C stack and are chained newest first
+*/
+typedef struct Pin {
+    DataConstant value;
+    struct Pin* next;
+} Pin;
+
 typedef struct {
     DataConstant* globals;
+    long globalsCapacity;
+    size_t globalsReserved; // bytes of address space mapped for the globals, 0 when they live on the C heap
     SourceCode* src;
     Frame** callStack;
+    int framesCapacity;
+    int frameCount; // frames allocated in callStack; the ones above fp are kept for reuse by later calls
+    DataConstant* values; // data stack shared by the frames, each one's locals start where its caller's arguments were
+    long valuesCapacity;
+    long valuesMinimum; // the data stack never shrinks below its initial capacity
+    int* localsHints; // per function, the locals window its calls have needed so far
     int fp;
     int gp;
     ExitCode state;
-    bool useHeapStorageBackup;
     short framesSoftMax;
     short framesHardMax;
     long globalsSoftMax;
@@ -22,16 +42,53 @@ typedef struct {
     long localsHardMax;
     long stackSoftMax;
     long stackHardMax;
+    ArrayHeader* arrays; // every array allocated by the program, newest first
+    long heapBytes; // bytes held by the arrays
+    char** strings; // strings created while running, owned by the VM until the collector finds them unreachable
+    int stringCount;
+    int stringCapacity;
+    RopeNode* ropes; // every rope created by CONCAT, newest first
+    ViewNode* views; // every view taken by the string builtins, newest first
+    long stringBytes; // bytes held by those strings, ropes and views, exactly the live bytes right after a collection
+    long collectionThreshold; // stringBytes + heapBytes that triggers the next collection
+    Pin* pins;
+    TraceHooks* hooks; // NULL runs the production interpreter loop
+    long* pairCounts; // opcode pair histogram, NULL unless enabled
+    Opcode lastOpcode;
+    bool adaptive; // rewrite generic instructions into the variant for the operand types they see
 } VM;
 
-typedef struct {
-    DataConstant* target;
-    int* targetp;
-    Frame* frame;
-} ArrayTarget;
+/**
+ * Callbacks made by the tracing interpreter loop; any of them may be NULL
+ * onCycle runs before each fetch and onInstruction after it
+*/
+struct TraceHooks {
+    void (*onStart)(VM* vm);
+    void (*onCycle)(VM* vm);
+    void (*onInstruction)(VM* vm, Instruction* instr);
+    void (*onExpand)(VM* vm, char* resource, long from, long to);
+    void (*onArrayAlloc)(VM* vm, ArrayHeader* array);
+    void (*onCollect)(VM* vm, long freedBytes);
+    void (*onHalt)(VM* vm);
+};
 
 VM* init(SourceCode* src, VMConfig conf);
-ArrayTarget checkAndRetrieveArrayValuesTarget(VM* vm, Frame* frame, int arraySize, bool* globalsExpanded, bool verbose);
+bool reserveGlobals(VM* vm);
+bool reserveValues(VM* vm, long count);
+void releaseValues(VM* vm);
+void releaseLocalsHint(VM* vm, Frame* frame);
+bool growGlobals(VM* vm, long count);
+bool growCallStack(VM* vm);
+Frame* enterFrame(VM* vm, int addr, long base, int argc, int returnAddr);
+bool exceedsGlobals(VM* vm, long bytes);
+DataConstant allocateArray(VM* vm, int capacity);
+DataConstant copyArray(VM* vm, DataConstant src, int begin, int length, int capacity);
+bool unshareArray(VM* vm, DataConstant array);
+DataConstant adoptString(VM* vm, char* value);
+DataConstant concatStrings(VM* vm, DataConstant lhs, DataConstant rhs);
+DataConstant sliceString(VM* vm, DataConstant string, long start, long length);
+DataConstant flattenString(VM* vm, DataConstant value);
+void display(VM* vm);
 ExitCode run(VM* vm, bool verbose);
 void destroy(VM* vm);
 
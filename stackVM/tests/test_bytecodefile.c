@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <criterion/criterion.h>
+#include <criterion/redirect.h>
+
+#include "utils.h"
+#include "../src/bytecodefile.h"
+#include "../src/loader.h"
+
+#define BYTECODE_TEST_FILE "./tests/sample_source_file.bbc"
+
+TestSuite(BytecodeFile);
+
+Test(BytecodeFile, isBytecodeFile_text) {
+    cr_expect_not(isBytecodeFile("./tests/sample_source_file.txt"));
+    cr_expect_not(isBytecodeFile("./tests/notFoundFile"));
+}
+
+Test(BytecodeFile, roundTrip) {
+    SourceCode* src = read_file("./tests/sample_source_file.txt");
+    cr_assert(loadSourceCode(src));
+    cr_assert(writeBytecodeFile(src, BYTECODE_TEST_FILE, 0));
+    cr_expect(isBytecodeFile(BYTECODE_TEST_FILE));
+
+    SourceCode* mapped = readBytecodeFile(BYTECODE_TEST_FILE);
+    cr_assert_not_null(mapped);
+    cr_expect_not_null(mapped->mapping);
+    cr_expect_eq(mapped->length, src->length);
+    for (int i = 0; i < src->length; i++) {
+        Function expected = src->code[i];
+        Function actual = mapped->code[i];
+        cr_expect_str_eq(actual.label, expected.label);
+        cr_expect_eq(actual.body->length, expected.body->length);
+        for (int j = 0; j < expected.body->length; j++) {
+            cr_expect_str_eq(getFromSV(actual.body, j), getFromSV(expected.body, j));
+        }
+        cr_expect_arr_eq(actual.bytecode, expected.bytecode, sizeof(Instruction) * (expected.body->length + 1));
+        cr_expect_eq(actual.constCnt, expected.constCnt);
+        for (int j = 0; j < expected.constCnt; j++) {
+            cr_expect(isEqual(actual.constants[j], expected.constants[j]));
+        }
+        cr_expect_eq(actual.jmpCnt, expected.jmpCnt);
+        for (int j = 0; j < expected.jmpCnt; j++) {
+            cr_expect_str_eq(actual.jumpPoints[j].label, expected.jumpPoints[j].label);
+            cr_expect_eq(actual.jumpPoints[j].start, expected.jumpPoints[j].start);
+            cr_expect_eq(actual.jumpPoints[j].end, expected.jumpPoints[j].end);
+        }
+    }
+
+    deleteSourceCode(mapped);
+    deleteSourceCode(src);
+    remove(BYTECODE_TEST_FILE);
+}
+
+Test(BytecodeFile, readBytecodeFile_wrongVersion, .init = cr_redirect_stderr) {
+    char* filename = "./tests/wrong_version.bbc";
+    SourceCode* src = read_file("./tests/sample_source_file.txt");
+    cr_assert(loadSourceCode(src));
+    cr_assert(writeBytecodeFile(src, filename, 0));
+    FILE* fp = fopen(filename, "r+b");
+    uint32_t version = BYTECODE_VERSION + 1;
+    fseek(fp, offsetof(BytecodeHeader, version), SEEK_SET);
+    fwrite(&version, sizeof(uint32_t), 1, fp);
+    fclose(fp);
+
+    cr_expect_null(readBytecodeFile(filename));
+    char message[256];
+    sprintf(message, "Error: '%s' was built for bytecode version %d but this VM runs version %d\n", filename, BYTECODE_VERSION + 1, BYTECODE_VERSION);
+    cr_expect_stderr_eq_str(message);
+
+    deleteSourceCode(src);
+    remove(filename);
+}
+
+FunctionEntry writeCorruptTestFile(char* filename, int function) {
+    SourceCode* src = read_file("./tests/sample_source_file.txt");
+    cr_assert(loadSourceCode(src));
+    cr_assert(writeBytecodeFile(src, filename, 0));
+    deleteSourceCode(src);
+    BytecodeHeader header;
+    FunctionEntry entry;
+    FILE* fp = fopen(filename, "rb");
+    cr_assert_eq(fread(&header, sizeof(BytecodeHeader), 1, fp), 1);
+    fseek(fp, header.functionTableOffset + sizeof(FunctionEntry) * function, SEEK_SET);
+    cr_assert_eq(fread(&entry, sizeof(FunctionEntry), 1, fp), 1);
+    fclose(fp);
+    return entry;
+}
+
+void patchTestFile(char* filename, long offset, void* bytes, size_t size) {
+    FILE* fp = fopen(filename, "r+b");
+    fseek(fp, offset, SEEK_SET);
+    fwrite(bytes, size, 1, fp);
+    fclose(fp);
+}
+
+void expectInvalidTestFile(char* filename) {
+    cr_expect_null(readBytecodeFile(filename));
+    char message[256];
+    sprintf(message, "Error: '%s' is not a valid bytecode file\n", filename);
+    cr_expect_stderr_eq_str(message);
+    remove(filename);
+}
+
+Test(BytecodeFile, readBytecodeFile_badOpcode, .init = cr_redirect_stderr) {
+    char* filename = "./tests/bad_opcode.bbc";
+    FunctionEntry entry = writeCorruptTestFile(filename, 1);
+    Opcode opcode = OPCODE_COUNT;
+    patchTestFile(filename, entry.bytecodeOffset + offsetof(Instruction, opcode), &opcode, sizeof(Opcode));
+    expectInvalidTestFile(filename);
+}
+
+Test(BytecodeFile, readBytecodeFile_badConstantIndex, .init = cr_redirect_stderr) {
+    char* filename = "./tests/bad_constant_index.bbc";
+    FunctionEntry entry = writeCorruptTestFile(filename, 1);
+    int index = entry.constCnt; // the first instruction of _entry is a LOAD_CONST
+    patchTestFile(filename, entry.bytecodeOffset + offsetof(Instruction, operands), &index, sizeof(int));
+    expectInvalidTestFile(filename);
+}
+
+Test(BytecodeFile, readBytecodeFile_badCallTarget, .init = cr_redirect_stderr) {
+    char* filename = "./tests/bad_call_target.bbc";
+    FunctionEntry entry = writeCorruptTestFile(filename, 1);
+    int function = 2; // CALL mult starts at token 4
+    patchTestFile(filename, entry.bytecodeOffset + sizeof(Instruction) * 4 + offsetof(Instruction, operands) + sizeof(int) * 2, &function, sizeof(int));
+    expectInvalidTestFile(filename);
+}
+
+Test(BytecodeFile, readBytecodeFile_badStringOffset, .init = cr_redirect_stderr) {
+    char* filename = "./tests/bad_string_offset.bbc";
+    FunctionEntry entry = writeCorruptTestFile(filename, 0);
+    uint32_t offset = UINT32_MAX;
+    patchTestFile(filename, entry.tokensOffset, &offset, sizeof(uint32_t));
+    expectInvalidTestFile(filename);
+}
+
+Test(BytecodeFile, readBytecodeFile_tooManyJumps, .init = cr_redirect_stderr) {
+    char* filename = "./tests/too_many_jumps.bbc";
+    writeCorruptTestFile(filename, 1);
+    BytecodeHeader header;
+    FILE* fp = fopen(filename, "rb");
+    cr_assert_eq(fread(&header, sizeof(BytecodeHeader), 1, fp), 1);
+    fclose(fp);
+    uint32_t jmpCnt = 17;
+    patchTestFile(filename, header.functionTableOffset + sizeof(FunctionEntry) + offsetof(FunctionEntry, jmpCnt), &jmpCnt, sizeof(uint32_t));
+    expectInvalidTestFile(filename);
+}
+
+Test(BytecodeFile, readBytecodeFile_sectionOutOfFile, .init = cr_redirect_stderr) {
+    char* filename = "./tests/section_out_of_file.bbc";
+    writeCorruptTestFile(filename, 0);
+    BytecodeHeader header;
+    FILE* fp = fopen(filename, "rb");
+    cr_assert_eq(fread(&header, sizeof(BytecodeHeader), 1, fp), 1);
+    fclose(fp);
+    uint32_t offset = header.fileSize;
+    patchTestFile(filename, header.functionTableOffset + offsetof(FunctionEntry, bytecodeOffset), &offset, sizeof(uint32_t));
+    expectInvalidTestFile(filename);
+}
+
+Test(BytecodeFile, readBytecodeFile_otherBuild, .init = cr_redirect_stderr) {
+    char* filename = "./tests/other_build.bbc";
+    writeCorruptTestFile(filename, 0);
+    uint64_t buildHash = getBuildHash() + 1;
+    patchTestFile(filename, offsetof(BytecodeHeader, buildHash), &buildHash, sizeof(uint64_t));
+    cr_expect_null(readBytecodeFile(filename));
+    char message[256];
+    sprintf(message, "Error: '%s' was written by a build of the VM with different opcodes or builtins\n", filename);
+    cr_expect_stderr_eq_str(message);
+    remove(filename);
+}
+
+void writeCacheTestSource(char* filename, char* text) {
+    FILE* fp = fopen(filename, "w");
+    fputs(text, fp);
+    fclose(fp);
+}
+
+Test(BytecodeFile, readSourceWithCache) {
+    char* filename = "./tests/cache_source.txt";
+    char* cachePath = getCachePath(filename);
+    remove(cachePath);
+    writeCacheTestSource(filename, "_entry:\n    LOAD_CONST 1\n    HALT\n");
+
+    SourceCode* src = readSourceWithCache(filename, false);
+    cr_assert_not_null(src);
+    cr_expect_null(src->mapping);
+    cr_expect(src->loaded);
+    cr_expect(isBytecodeFile(cachePath));
+    deleteSourceCode(src);
+
+    src = readSourceWithCache(filename, false);
+    cr_assert_not_null(src);
+    cr_expect_not_null(src->mapping);
+    cr_expect_eq(src->code[0].body->length, 3);
+    deleteSourceCode(src);
+
+    writeCacheTestSource(filename, "_entry:\n    LOAD_CONST 2\n    POP\n    HALT\n");
+    src = readSourceWithCache(filename, false);
+    cr_assert_not_null(src);
+    cr_expect_null(src->mapping);
+    cr_expect_eq(src->code[0].body->length, 4);
+    deleteSourceCode(src);
+
+    remove(cachePath);
+    remove(filename);
+    free(cachePath);
+}
+
+Test(BytecodeFile, readSourceWithCache_corrupt, .init = cr_redirect_stderr) {
+    char* filename = "./tests/corrupt_cache_source.txt";
+    char* cachePath = getCachePath(filename);
+    writeCacheTestSource(filename, "_entry:\n    LOAD_CONST 1\n    HALT\n");
+    SourceCode* src = readSourceWithCache(filename, false);
+    cr_assert_not_null(src);
+    deleteSourceCode(src);
+
+    BytecodeHeader header;
+    FILE* fp = fopen(cachePath, "r+b");
+    cr_assert_eq(fread(&header, sizeof(BytecodeHeader), 1, fp), 1);
+    uint32_t tokenCount = 1000;
+    fseek(fp, header.functionTableOffset + offsetof(FunctionEntry, tokenCount), SEEK_SET);
+    fwrite(&tokenCount, sizeof(uint32_t), 1, fp);
+    fclose(fp);
+
+    src = readSourceWithCache(filename, false);
+    cr_assert_not_null(src);
+    cr_expect_null(src->mapping);
+    cr_expect_eq(src->code[0].body->length, 3);
+    deleteSourceCode(src);
+    src = readSourceWithCache(filename, false);
+    cr_assert_not_null(src);
+    cr_expect_not_null(src->mapping);
+    deleteSourceCode(src);
+
+    remove(cachePath);
+    remove(filename);
+    free(cachePath);
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include <criterion/criterion.h>
+#include <criterion/redirect.h>
+
+#include "utils.h"
+#include "../src/collector.h"
+
+TestSuite(Collector);
+
+VM* setupCollectorTest(char* body) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {body};
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+    return init(src, getDefaultConfig());
+}
+
+Test(Collector, adoptString) {
+    VM* vm = setupCollectorTest("HALT");
+    DataConstant string = adoptString(vm, strdup("Hello"));
+
+    cr_expect_eq(valueType(string), Str);
+    cr_expect_str_eq(asString(string), "Hello");
+    cr_expect_eq(vm->stringCount, 1);
+    cr_expect_eq(vm->strings[0], asString(string));
+    cr_expect_eq(vm->stringBytes, 6);
+
+    destroy(vm);
+}
+
+Test(Collector, collectGarbage_keepsReachableStrings) {
+    VM* vm = setupCollectorTest("HALT");
+    Frame* frame = vm->callStack[0];
+    DataConstant onStack = adoptString(vm, strdup("stack"));
+    DataConstant inLocals = adoptString(vm, strdup("locals"));
+    DataConstant inNestedArray = adoptString(vm, strdup("nested"));
+    adoptString(vm, strdup("garbage"));
+    DataConstant constant = createString("constant");
+
+    moveStack(frame, 1); // room for one local in front of the operand stack
+    framePush(frame, onStack);
+    framePush(frame, constant);
+    storeLocal(frame, inLocals);
+    DataConstant inner = allocateArray(vm, 1);
+    setArrayElement(getArrayHeader(inner), 0, inNestedArray);
+    getArrayHeader(inner)->length++;
+    DataConstant outer = allocateArray(vm, 2);
+    setArrayElement(getArrayHeader(outer), 0, inner);
+    setArrayElement(getArrayHeader(outer), 1, outer); // arrays may refer to themselves
+    getArrayHeader(outer)->length += 2;
+    vm->globals[++vm->gp] = outer;
+
+    collectGarbage(vm);
+
+    cr_expect_eq(vm->stringCount, 3);
+    cr_expect_eq(vm->stringBytes, 6 + 7 + 7);
+    cr_expect_eq(vm->strings[0], asString(onStack));
+    cr_expect_eq(vm->strings[1], asString(inLocals));
+    cr_expect_eq(vm->strings[2], asString(inNestedArray));
+    cr_expect_eq(vm->collectionThreshold, MIN_COLLECTION_THRESHOLD);
+
+    destroy(vm);
+}
+
+Test(Collector, collectGarbage_sweepsArrays) {
+    VM* vm = setupCollectorTest("HALT");
+    DataConstant garbage = allocateArray(vm, 4);
+    setArrayElement(getArrayHeader(garbage), 0, adoptString(vm, strdup("garbage")));
+    getArrayHeader(garbage)->length++;
+    DataConstant pinned = allocateArray(vm, 2);
+    Pin pin = {pinned, vm->pins};
+    vm->pins = &pin;
+
+    collectGarbage(vm);
+
+    cr_expect_eq(vm->arrays, getArrayHeader(pinned));
+    cr_expect_null(vm->arrays->next);
+    cr_expect_eq(vm->heapBytes, sizeof(ArrayHeader) + sizeof(ArrayStorage) + 2 * sizeof(DataConstant));
+    cr_expect_eq(vm->stringCount, 0);
+
+    vm->pins = pin.next;
+    collectGarbage(vm);
+
+    cr_expect_null(vm->arrays);
+    cr_expect_eq(vm->heapBytes, 0);
+
+    destroy(vm);
+}
+
+Test(Collector, collectGarbage_sweepsRopes) {
+    VM* vm = setupCollectorTest("HALT");
+    DataConstant part = adoptString(vm, strdup("0123456789"));
+    DataConstant garbage = concatStrings(vm, createString("a constant that is long enough to make the concatenation a rope"), part);
+    cr_expect_eq(valueType(garbage), Rope);
+    DataConstant rope = part;
+    for (int i = 0; i < 10000; i++) { // as deep as a string built in a loop
+        rope = concatStrings(vm, rope, part);
+    }
+    Pin pin = {rope, vm->pins};
+    vm->pins = &pin;
+
+    collectGarbage(vm);
+
+    cr_expect_eq(vm->ropes, getRope(rope));
+    int count = 0;
+    for (RopeNode* node = vm->ropes; node != NULL; node = node->next) {
+        count++;
+    }
+    cr_expect_eq(count, 10000 - 5); // the first few concatenations were copied
+    cr_expect_eq(vm->stringCount, 2); // the part and the last copied concatenation
+    cr_expect_eq(getRope(rope)->length, 100010);
+
+    vm->pins = pin.next;
+    collectGarbage(vm);
+
+    cr_expect_null(vm->ropes);
+    cr_expect_eq(vm->stringCount, 0);
+    cr_expect_eq(vm->stringBytes, 0);
+
+    destroy(vm);
+}
+
+Test(Collector, collectGarbage_viewsKeepParentAlive) {
+    VM* vm = setupCollectorTest("HALT");
+    DataConstant parent = adoptString(vm, strdup("key=value"));
+    DataConstant view = sliceString(vm, parent, 4, 5);
+    DataConstant garbage = sliceString(vm, view, 0, 3);
+    cr_expect_eq(getView(garbage)->parent, asString(parent));
+    Pin pin = {view, vm->pins};
+    vm->pins = &pin;
+
+    collectGarbage(vm);
+
+    cr_expect_eq(vm->views, getView(view));
+    cr_expect_null(vm->views->next);
+    cr_expect_eq(vm->stringCount, 1);
+    cr_expect_eq(vm->stringBytes, sizeof(ViewNode) + 10);
+
+    // once copied the view lets go of its parent
+    flattenString(vm, view);
+    collectGarbage(vm);
+
+    cr_expect_eq(vm->stringCount, 1);
+    cr_expect_str_eq(vm->strings[0], "value");
+    cr_expect_eq(vm->stringBytes, sizeof(ViewNode) + 6);
+
+    vm->pins = pin.next;
+    collectGarbage(vm);
+
+    cr_expect_null(vm->views);
+    cr_expect_eq(vm->stringCount, 0);
+    cr_expect_eq(vm->stringBytes, 0);
+
+    destroy(vm);
+}
+
+Test(Collector, runCollectsDeadStrings) {
+    VM* vm = setupCollectorTest("LOAD_CONST \"ab\" LOAD_CONST \"cd\" CONCAT POP LOAD_CONST \"ef\" LOAD_CONST \"gh\" CONCAT STORE LOAD_CONST \"x\" LOAD_CONST \"y\" CONCAT HALT");
+    vm->collectionThreshold = 6; // reached by the second CONCAT, after "abcd" was popped
+
+    ExitCode status = run(vm, false);
+
+    cr_expect_eq(status, success);
+    Frame* frame = vm->callStack[0];
+    cr_expect_str_eq(asString(frame->locals[0]), "efgh");
+    cr_expect_str_eq(asString(frame->stack[0]), "xy");
+    cr_expect_eq(vm->stringCount, 2);
+    cr_expect_eq(vm->stringBytes, 5 + 3);
+
+    destroy(vm);
+}
\ No newline at end of file
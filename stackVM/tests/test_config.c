@@ -60,6 +60,7 @@ Test(Config, readConfigFile_valid) {
     //displayVMConfig(conf);
     cr_expect(conf.dynamicResourceExpansionEnabled);
     cr_expect_not(conf.useHeapStorageBackup);
+    cr_expect_not(conf.adaptiveSpecializationEnabled);
     cr_expect_eq(conf.framesSoftMax, 512);
     cr_expect_eq(conf.framesHardMax, 1024);
     cr_expect_eq(conf.stackSizeSoftMax, 2048);
@@ -77,6 +78,7 @@ Test(Config, readConfigFile_notFound, .init = cr_redirect_stderr) {
     VMConfig defaultConf = getDefaultConfig();
     cr_expect_eq(conf.dynamicResourceExpansionEnabled, defaultConf.dynamicResourceExpansionEnabled);
     cr_expect_eq(conf.useHeapStorageBackup, defaultConf.useHeapStorageBackup);
+    cr_expect_eq(conf.adaptiveSpecializationEnabled, defaultConf.adaptiveSpecializationEnabled);
     cr_expect_eq(conf.framesSoftMax, defaultConf.framesSoftMax);
     cr_expect_eq(conf.framesHardMax, defaultConf.framesHardMax);
     cr_expect_eq(conf.stackSizeSoftMax, defaultConf.stackSizeSoftMax);
@@ -92,15 +94,15 @@ Test(Config, displayVMConfig_default, .init = cr_redirect_stdout) {
     displayVMConfig(conf);
     fflush(stdout);
     //logStdout(cr_get_redirected_stdout());
-    char* displayValues = "DynamicResourceExpansion: enabled\nHeapStorageBackup: enabled\n";
+    char* displayValues = "DynamicResourceExpansion: enabled\nHeapStorageBackup: enabled\nAdaptiveSpecialization: enabled\n";
     cr_asprintf(&displayValues, "%sframes_soft_max: 512 frames\n", displayValues);
     cr_asprintf(&displayValues, "%sframes_hard_max: 1024 frames\n", displayValues);
-    cr_asprintf(&displayValues, "%sstack_size_soft_max: 1024 B (32 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%sstack_size_hard_max: 8192 B (256 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%slocals_soft_max: 65536 B (2048 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%slocals_hard_max: 131072 B (4096 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%sglobals_soft_max: 1048576 B (32768 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%sglobals_hard_max: 536870912 B (16777216 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%sstack_size_soft_max: 1024 B (128 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%sstack_size_hard_max: 8192 B (1024 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%slocals_soft_max: 65536 B (8192 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%slocals_hard_max: 131072 B (16384 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%sglobals_soft_max: 1048576 B (131072 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%sglobals_hard_max: 536870912 B (67108864 values)\n", displayValues);
     cr_asprintf(&displayValues, "%sEstimated VM memory usage: 33.50 MB (soft limits) - 648.00 MB (hard limits)\n", displayValues);
     cr_expect_stdout_eq_str(displayValues);
 }
@@ -111,15 +113,15 @@ Test(Config, displayVMConfig_noDRE, .init = cr_redirect_stdout) {
     displayVMConfig(conf);
     fflush(stdout);
     //logStdout(cr_get_redirected_stdout());
-    char* displayValues = "DynamicResourceExpansion: disabled\nHeapStorageBackup: enabled\n";
+    char* displayValues = "DynamicResourceExpansion: disabled\nHeapStorageBackup: enabled\nAdaptiveSpecialization: enabled\n";
     cr_asprintf(&displayValues, "%sframes_soft_max: 512 frames\n", displayValues);
     cr_asprintf(&displayValues, "%sframes_hard_max: 1024 frames\n", displayValues);
-    cr_asprintf(&displayValues, "%sstack_size_soft_max: 1024 B (32 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%sstack_size_hard_max: 8192 B (256 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%slocals_soft_max: 65536 B (2048 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%slocals_hard_max: 131072 B (4096 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%sglobals_soft_max: 1048576 B (32768 values)\n", displayValues);
-    cr_asprintf(&displayValues, "%sglobals_hard_max: 536870912 B (16777216 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%sstack_size_soft_max: 1024 B (128 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%sstack_size_hard_max: 8192 B (1024 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%slocals_soft_max: 65536 B (8192 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%slocals_hard_max: 131072 B (16384 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%sglobals_soft_max: 1048576 B (131072 values)\n", displayValues);
+    cr_asprintf(&displayValues, "%sglobals_hard_max: 536870912 B (67108864 values)\n", displayValues);
     cr_asprintf(&displayValues, "%sEstimated VM memory usage: 648.00 MB\n", displayValues);
     cr_expect_stdout_eq_str(displayValues);
 }
@@ -134,10 +136,10 @@ Test(Config, validateVMConfig_invalid, .init = cr_redirect_stderr) {
     char* filePath = "tests/invalid-config.yml";
     VMConfig conf = readConfigFile(filePath);
     cr_expect_not(validateVMConfig(conf, filePath));
-    char* error = "ConfigError: 'locals_soft_max' must be between 32 and 1048576 in config file: 'tests/invalid-config.yml'\n";
+    char* error = "ConfigError: 'locals_soft_max' must be between 8 and 1048576 in config file: 'tests/invalid-config.yml'\n";
     cr_asprintf(&error, "%sConfigError: 'stack_size_soft_max' must be less than or equal to 'stack_size_hard_max' in config file: 'tests/invalid-config.yml'\n", error);
     cr_asprintf(&error, "%sConfigError: 'globals_soft_max' must be less than or equal to 'globals_hard_max' in config file: 'tests/invalid-config.yml'\n", error);
     cr_asprintf(&error, "%sConfigError: 'frames_hard_max' must be between 1 and 16384 in config file: 'tests/invalid-config.yml'\n", error);
-    cr_asprintf(&error, "%sConfigError: 'locals_hard_max' must be between 32 and 1048576 in config file: 'tests/invalid-config.yml'\n", error);
+    cr_asprintf(&error, "%sConfigError: 'locals_hard_max' must be between 8 and 1048576 in config file: 'tests/invalid-config.yml'\n", error);
     cr_expect_stderr_eq_str(error);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include <criterion/criterion.h>
 #include <criterion/parameterized.h>
 #include <criterion/redirect.h>
+#include <math.h>
 
 #include "utils.h"
 #include "../src/dataconstant.h"
@@ -9,20 +10,26 @@ TestSuite(DataConstant);
 
 Test(DataConstant, readInt) {
     DataConstant data = readInt("4");
-    cr_expect(data.type == Int);
-    cr_expect(data.value.intVal == 4);
+    cr_expect(valueType(data) == Int);
+    cr_expect(asInt(data) == 4);
 }
 
 Test(DataConstant, createInt) {
     DataConstant data = createInt(4);
-    cr_expect(data.type == Int);
-    cr_expect(data.value.intVal == 4);
+    cr_expect(valueType(data) == Int);
+    cr_expect(asInt(data) == 4);
+}
+
+Test(DataConstant, createInt_negative) {
+    DataConstant data = createInt(-2147483647 - 1);
+    cr_expect(valueType(data) == Int);
+    cr_expect(asInt(data) == -2147483647 - 1);
 }
 
 Test(DataConstant, readDouble) {
     DataConstant data = readDouble("4.5");
-    cr_expect(data.type == Dbl);
-    cr_expect(data.value.dblVal == 4.5);
+    cr_expect(valueType(data) == Dbl);
+    cr_expect(asDouble(data) == 4.5);
 }
 
 ParameterizedTestParameters(DataConstant, createDouble) {
@@ -34,8 +41,21 @@ ParameterizedTestParameters(DataConstant, createDouble) {
 
 ParameterizedTest(double* dbl, DataConstant, createDouble) {
     DataConstant data = createDouble(*dbl);
-    cr_expect(data.type == Dbl);
-    cr_expect(data.value.dblVal == *dbl);
+    cr_expect(valueType(data) == Dbl);
+    cr_expect(asDouble(data) == *dbl);
+}
+
+Test(DataConstant, createDouble_nan) {
+    DataConstant data = createDouble(-NAN); // the sign and exponent bits of a negative NaN would read as a boxed value
+    cr_expect(valueType(data) == Dbl);
+    cr_expect(isnan(asDouble(data)));
+    cr_expect_eq(data.bits, CANONICAL_NAN);
+}
+
+Test(DataConstant, createDouble_infinity) {
+    cr_expect(valueType(createDouble(-INFINITY)) == Dbl);
+    cr_expect(asDouble(createDouble(-INFINITY)) == -INFINITY);
+    cr_expect(valueType(createDouble(INFINITY)) == Dbl);
 }
 
 typedef struct {
@@ -64,40 +84,61 @@ ParameterizedTestParameters(DataConstant, readBoolean) {
 
 ParameterizedTest(readBooleanInput* bools, DataConstant, readBoolean) {
     DataConstant data = readBoolean(bools->str);
-    cr_expect(data.type == Bool);
-    cr_expect(data.value.boolVal == bools->value);
+    cr_expect(valueType(data) == Bool);
+    cr_expect(asBool(data) == bools->value);
 }
 
 Test(DataConstant, createBoolean) {
     DataConstant data = createBoolean(true);
-    cr_expect(data.type == Bool);
-    cr_expect(data.value.boolVal);
+    cr_expect(valueType(data) == Bool);
+    cr_expect(asBool(data));
 }
 
 Test(DataConstant, createString) {
     DataConstant data = createString("Hello, world!");
-    cr_expect(data.type == Str);
-    cr_expect_str_eq(data.value.strVal, "Hello, world!");
+    cr_expect(valueType(data) == Str);
+    cr_expect_str_eq(asString(data), "Hello, world!");
 }
 
 Test(DataConstant, createNull) {
     DataConstant data = createNull();
-    cr_expect(data.type == Null);
+    cr_expect(valueType(data) == Null);
 }
 
 Test(DataConstant, createNone) {
     DataConstant data = createNone();
-    cr_expect(data.type == None);
+    cr_expect(valueType(data) == None);
 }
 
 Test(DataConstant, createAddr) {
-    DataConstant* locals = (DataConstant[]) {createBoolean(true)};
-    DataConstant data = createAddr(locals, 1, 12, 10);
-    cr_expect_eq(data.type, Addr);
-    cr_expect_eq((DataConstant *) data.value.address, locals);
-    cr_expect_eq(data.offset, 1);
-    cr_expect_eq(data.size, 12);
-    cr_expect_eq(data.length, 10);
+    ArrayHeader* array = cr_malloc(sizeof(ArrayHeader));
+    array->storage = cr_malloc(sizeof(ArrayStorage) + sizeof(DataConstant) * 12);
+    array->capacity = 12;
+    array->length = 10;
+    DataConstant data = createAddr(array);
+    cr_expect_eq(valueType(data), Addr);
+    cr_expect_eq((ArrayHeader *) asAddress(data), array);
+    cr_expect_eq(getArrayHeader(data), array);
+    cr_expect_eq(getArrayStart(data), array->storage->values);
+    cr_expect_eq(getArrayHeader(data)->capacity, 12);
+    cr_expect_eq(getArrayHeader(data)->length, 10);
+}
+
+Test(DataConstant, setArrayElement_sameType) {
+    DataConstant data = createTestArray(3, 2, (DataConstant[2]) {createInt(1), createInt(2)});
+    ArrayHeader* array = getArrayHeader(data);
+    cr_expect_eq(array->elementType, Int);
+    setArrayElement(array, 2, createInt(3));
+    cr_expect_eq(array->elementType, Int);
+    cr_expect(isEqual(array->storage->values[2], createInt(3)));
+}
+
+Test(DataConstant, setArrayElement_mixedTypes) {
+    DataConstant data = createTestArray(3, 1, (DataConstant[1]) {createInt(1)});
+    ArrayHeader* array = getArrayHeader(data);
+    setArrayElement(array, 1, createString("a"));
+    cr_expect_eq(array->elementType, None);
+    cr_expect_str_eq(asString(array->storage->values[1]), "a");
 }
 
 typedef struct {
@@ -117,9 +158,9 @@ void free_toString_input(struct criterion_test_params* inputs) {
 }
 
 ParameterizedTestParameters(DataConstant, toString) {
-    DataConstant* locals = (DataConstant[]) {};
+    DataConstant array = createTestArray(10, 0, NULL);
     char* arrayToString;
-    cr_asprintf(&arrayToString, "%p (10)", locals + 15);
+    cr_asprintf(&arrayToString, "%p (10)", getArrayStart(array));
     size_t count = 8;
     toStringInput* values = cr_malloc(sizeof(toStringInput) * count);
 
@@ -130,7 +171,7 @@ ParameterizedTestParameters(DataConstant, toString) {
     values[4] = (toStringInput) {createString(cr_strdup("Hello")), cr_strdup("\"Hello\"")};
     values[5] = (toStringInput) {createNull(), cr_strdup("null")};
     values[6] = (toStringInput) {createNone(), cr_strdup("None")};
-    values[7] = (toStringInput) {createAddr(locals, 15, 10, 1), cr_strdup(arrayToString)};
+    values[7] = (toStringInput) {array, cr_strdup(arrayToString)};
     cr_free(arrayToString);
     return cr_make_param_array(toStringInput, values, count, free_toString_input);
 }
@@ -195,160 +236,129 @@ ParameterizedTest(EqualityComparison* compare, DataConstant, isEqual) {
 typedef struct {
     DataConstant lhs;
     DataConstant rhs;
-    char* operator;
+    ComparisonOperator operator;
     bool result;
 } Comparison;
 
 ParameterizedTestParameters(DataConstant, compareData) {
     size_t count = 10;
     Comparison* values = cr_malloc(sizeof(Comparison) * count);
-    values[0] = (Comparison) {createInt(0), createInt(0), cr_strdup("=="), true};
-    values[1] = (Comparison) {createInt(1), createInt(-1), cr_strdup("=="), false};
-    values[2] = (Comparison) {createInt(1), createInt(-1), cr_strdup("!="), true};
-    values[3] = (Comparison) {createInt(0), createInt(0), cr_strdup("!="), false};
-    values[4] = (Comparison) {createInt(10), createDouble(10.000), cr_strdup("<="), true};
-    values[5] = (Comparison) {createDouble(5.0), createInt(5), cr_strdup(">="), true};
-    values[6] = (Comparison) {createDouble(5.01), createInt(5), cr_strdup(">"), true};
-    values[7] = (Comparison) {createDouble(5.01), createDouble(5.02), cr_strdup(">"), false};
-    values[8] = (Comparison) {createInt(10), createInt(11), cr_strdup("<"), true};
-    values[9] = (Comparison) {createInt(12), createInt(11), cr_strdup("<"), false};
+    values[0] = (Comparison) {createInt(0), createInt(0), CmpEq, true};
+    values[1] = (Comparison) {createInt(1), createInt(-1), CmpEq, false};
+    values[2] = (Comparison) {createInt(1), createInt(-1), CmpNe, true};
+    values[3] = (Comparison) {createInt(0), createInt(0), CmpNe, false};
+    values[4] = (Comparison) {createInt(10), createDouble(10.000), CmpLe, true};
+    values[5] = (Comparison) {createDouble(5.0), createInt(5), CmpGe, true};
+    values[6] = (Comparison) {createDouble(5.01), createInt(5), CmpGt, true};
+    values[7] = (Comparison) {createDouble(5.01), createDouble(5.02), CmpGt, false};
+    values[8] = (Comparison) {createInt(10), createInt(11), CmpLt, true};
+    values[9] = (Comparison) {createInt(12), createInt(11), CmpLt, false};
     return cr_make_param_array(Comparison, values, count);
 }
 
 ParameterizedTest(Comparison* compare, DataConstant, compareData) {
     DataConstant result = compareData(compare->lhs, compare->rhs, compare->operator);
-    char* logMessage = "compareData(%s, %s, \"%s\") Result: %s; Expected result: %s\n";
+    char* logMessage = "compareData(%s, %s, %d) Result: %s; Expected result: %s\n";
     char* expectedResult = compare->result ? "true" : "false";
     cr_log_info(logMessage, toString(compare->lhs),toString(compare->rhs), compare->operator, toString(result), expectedResult);
-    cr_expect_eq(result.value.boolVal, compare->result);
+    cr_expect_eq(asBool(result), compare->result);
 }
 
 Test(DataConstant, getMax_LHS) {
     DataConstant lhs = createInt(4);
     DataConstant rhs = createDouble(3.99);
     DataConstant result = getMax(lhs, rhs);
-    cr_expect_eq(lhs.type, result.type);
-    cr_expect_eq(lhs.value.intVal, result.value.intVal);
+    cr_expect_eq(valueType(lhs), valueType(result));
+    cr_expect_eq(asInt(lhs), asInt(result));
 }
 
 Test(DataConstant, getMax_RHS) {
     DataConstant lhs = createDouble(3.98);
     DataConstant rhs = createDouble(3.99);
     DataConstant result = getMax(lhs, rhs);
-    cr_expect_eq(rhs.type, result.type);
-    cr_expect_eq(rhs.value.dblVal, result.value.dblVal);
+    cr_expect_eq(valueType(rhs), valueType(result));
+    cr_expect_eq(asDouble(rhs), asDouble(result));
 }
 
 Test(DataConstant, getMin_LHS) {
     DataConstant lhs = createInt(4);
     DataConstant rhs = createInt(4);
     DataConstant result = getMin(lhs, rhs);
-    cr_expect_eq(lhs.type, result.type);
-    cr_expect_eq(lhs.value.intVal, result.value.intVal);
+    cr_expect_eq(valueType(lhs), valueType(result));
+    cr_expect_eq(asInt(lhs), asInt(result));
 }
 
 Test(DataConstant, getMin_RHS) {
     DataConstant lhs = createDouble(3.98);
     DataConstant rhs = createDouble(3.97);
     DataConstant result = getMin(lhs, rhs);
-    cr_expect_eq(rhs.type, result.type);
-    cr_expect_eq(rhs.value.dblVal, result.value.dblVal);
+    cr_expect_eq(valueType(rhs), valueType(result));
+    cr_expect_eq(asDouble(rhs), asDouble(result));
 }
 
 typedef struct {
     DataConstant lhs;
     DataConstant rhs;
-    char* operator;
+    ArithmeticOperator operator;
     DataConstant result;
 } Operation;
 
 ParameterizedTestParameters(DataConstant, binaryArithmeticOperation) {
     size_t count = 12;
     Operation* values = cr_malloc(sizeof(Operation) * count);
-    values[0] = (Operation) {createInt(0), createInt(0), cr_strdup("+"), createInt(0)};
-    values[1] = (Operation) {createInt(1), createDouble(-1.0), cr_strdup("+"), createDouble(0)};
-    values[2] = (Operation) {createInt(1), createInt(-1.0), cr_strdup("-"), createInt(2)};
-    values[3] = (Operation) {createInt(0), createInt(5), cr_strdup("-"), createInt(-5)};
-    values[4] = (Operation) {createInt(10), createDouble(10.000), cr_strdup("*"), createDouble(100.0)};
-    values[5] = (Operation) {createDouble(5.0), createInt(3), cr_strdup("*"), createDouble(15.0)};
-    values[6] = (Operation) {createInt(6), createInt(5), cr_strdup("/"), createInt(1)};
-    values[7] = (Operation) {createDouble(6.0), createDouble(5), cr_strdup("/"), createDouble(1.2)};
-    values[8] = (Operation) {createInt(6), createInt(5), cr_strdup("mod"), createInt(1)};
-    values[9] = (Operation) {createInt(6), createDouble(11.0), cr_strdup("mod"), createDouble(6.0)};
-    values[10] = (Operation) {createInt(3), createInt(-1), cr_strdup("exp"), createInt(0)};
-    values[11] = (Operation) {createDouble(3.0), createInt(-2), cr_strdup("exp"), createDouble(1.0 / 9.0)};
+    values[0] = (Operation) {createInt(0), createInt(0), OpAdd, createInt(0)};
+    values[1] = (Operation) {createInt(1), createDouble(-1.0), OpAdd, createDouble(0)};
+    values[2] = (Operation) {createInt(1), createInt(-1.0), OpSub, createInt(2)};
+    values[3] = (Operation) {createInt(0), createInt(5), OpSub, createInt(-5)};
+    values[4] = (Operation) {createInt(10), createDouble(10.000), OpMul, createDouble(100.0)};
+    values[5] = (Operation) {createDouble(5.0), createInt(3), OpMul, createDouble(15.0)};
+    values[6] = (Operation) {createInt(6), createInt(5), OpDiv, createInt(1)};
+    values[7] = (Operation) {createDouble(6.0), createDouble(5), OpDiv, createDouble(1.2)};
+    values[8] = (Operation) {createInt(6), createInt(5), OpRem, createInt(1)};
+    values[9] = (Operation) {createInt(6), createDouble(11.0), OpRem, createDouble(6.0)};
+    values[10] = (Operation) {createInt(3), createInt(-1), OpPow, createInt(0)};
+    values[11] = (Operation) {createDouble(3.0), createInt(-2), OpPow, createDouble(1.0 / 9.0)};
     return cr_make_param_array(Operation, values, count);
 }
 
 ParameterizedTest(Operation* operation, DataConstant, binaryArithmeticOperation) {
     DataConstant result = binaryArithmeticOperation(operation->lhs, operation->rhs, operation->operator);
-    char* logMessage = "binaryArithmeticOperation(%s, %s, \"%s\") Result: %s; Expected result: %s\n";
+    char* logMessage = "binaryArithmeticOperation(%s, %s, %d) Result: %s; Expected result: %s\n";
     cr_log_info(logMessage, toString(operation->lhs),toString(operation->rhs), operation->operator, toString(result), toString(operation->result));
-    cr_expect_eq(result.type, operation->result.type);
+    cr_expect_eq(valueType(result), valueType(operation->result));
     cr_expect(isEqual(result, operation->result));
 }
 
 Test(DataConstant, binaryArithmeticOperation_divByZero, .init = cr_redirect_stderr) {
-    DataConstant result = binaryArithmeticOperation(createInt(1), createInt(0), "/");
+    DataConstant result = binaryArithmeticOperation(createInt(1), createInt(0), OpDiv);
     cr_expect_stderr_eq_str("Error: Division by zero\n");
-    cr_expect_eq(result.type, None);
+    cr_expect_eq(valueType(result), None);
 }
 
 Test(DataConstant, binaryArithmeticOperation_modByZero, .init = cr_redirect_stderr) {
-    DataConstant result = binaryArithmeticOperation(createInt(1), createInt(0), "mod");
+    DataConstant result = binaryArithmeticOperation(createInt(1), createInt(0), OpRem);
     cr_expect_stderr_eq_str("Error: Division by zero\n");
-    cr_expect_eq(result.type, None);
+    cr_expect_eq(valueType(result), None);
 }
 
 Test(DataConstant, binaryArithmeticOperation_expZeroByNegative, .init = cr_redirect_stderr) {
-    DataConstant result = binaryArithmeticOperation(createInt(0), createInt(-1), "exp");
+    DataConstant result = binaryArithmeticOperation(createInt(0), createInt(-1), OpPow);
     cr_expect_stderr_eq_str("Error: Zero cannot be raised to a negative power\n");
-    cr_expect_eq(result.type, None);
-}
-
-Test(DataConstant, copyAddr) {
-    DataConstant* globals = (DataConstant[4]){createInt(1), createInt(5)};
-    int globIndex = 1;
-    DataConstant addr = createAddr(globals, 0, 2, 2);
-    DataConstant copy = copyAddr(addr, &globIndex, &globals);
-    cr_expect_eq(copy.type, Addr);
-    cr_expect_eq(copy.size, 2);
-    cr_expect_eq(copy.length, 2);
-    cr_expect_eq((DataConstant *) copy.value.address, globals);
-    cr_expect_eq(copy.offset, 2);
-    cr_expect(isEqual(globals[2], globals[0]));
-    cr_expect(isEqual(globals[3], globals[1]));
-    cr_expect_eq(globIndex, 3);
-}
-
-Test(DataConstant, partialCopyAddr) {
-    DataConstant* globals = (DataConstant[4]){createInt(1), createInt(5)};
-    int globIndex = 1;
-    DataConstant addr = createAddr(globals, 0, 2, 2);
-    DataConstant copy = partialCopyAddr(addr, 0, 1, &globIndex, &globals);
-    cr_expect_eq(copy.type, Addr);
-    cr_expect_eq(copy.size, 2);
-    cr_expect_eq(copy.length, 1);
-    cr_expect_eq((DataConstant *) copy.value.address, globals);
-    cr_expect_eq(copy.offset, 2);
-    cr_expect(isEqual(globals[2], globals[0]));
-    cr_expect_eq(globals[3].type, None);
-    cr_expect_eq(globIndex, 3);
-}
-
-Test(DataConstant, expandExistingAddr) {
-    DataConstant* globals = (DataConstant[6]){createInt(1), createInt(5)};
-    int globIndex = 1;
-    DataConstant addr = createAddr(globals, 0, 2, 2);
-    DataConstant copy = expandExistingAddr(addr, 4, &globIndex, &globals);
-    cr_expect_eq(copy.type, Addr);
-    cr_expect_eq(copy.size, 4);
-    cr_expect_eq(copy.length, 2);
-    cr_expect_eq((DataConstant *) copy.value.address, globals);
-    cr_expect_eq(copy.offset, 2);
-    cr_expect(isEqual(globals[2], globals[0]));
-    cr_expect(isEqual(globals[3], globals[1]));
-    cr_expect_eq(globals[4].type, None);
-    cr_expect_eq(globals[5].type, None);
-    cr_expect_eq(globIndex, 5);
+    cr_expect_eq(valueType(result), None);
+}
+
+Test(DataConstant, binaryArithmeticOperation_unsupportedTypes, .init = cr_redirect_stderr) {
+    DataConstant result = binaryArithmeticOperation(createString("a"), createInt(1), OpAdd);
+    cr_expect_stderr_eq_str("Error: Unsupported operand types for arithmetic\n");
+    cr_expect_eq(valueType(result), None);
+}
+
+Test(DataConstant, powInt) {
+    cr_expect_eq(powInt(2, 10), 1024);
+    cr_expect_eq(powInt(3, 0), 1);
+    cr_expect_eq(powInt(-2, 3), -8);
+    cr_expect_eq(powInt(-3, 4), 81);
+    cr_expect_eq(powInt(1, -5), 1);
+    cr_expect_eq(powInt(-1, -3), -1);
+    cr_expect_eq(powInt(2, -1), 0);
 }
\ No newline at end of file
@@ -46,6 +46,7 @@ Test(FileReader, read_file) {
     cr_expect_eq(src->code[1].jmpCnt, 1);
     cr_expect_str_eq(src->code[1].jumpPoints[0].label, ".stop");
     cr_expect_eq(src->code[1].jumpPoints[0].start, 17);
+    cr_expect_eq(src->code[1].jumpPoints[0].end, 19); // the block has no EJMP so it runs to the end of _entry
     
     StringVector* multBody = src->code[0].body;
     StringVector* mainBody = src->code[1].body;
@@ -10,6 +10,7 @@ TestSuite(Frame);
 StringVector* srcCode;
 JumpPoint* jumpPoints;
 Frame* test_frame;
+DataConstant values[64];
 
 void setup() {
     srcCode = createStringVector();
@@ -19,7 +20,7 @@ void setup() {
         {"add", 0, 3},
         {"_entry", 5, 9}
     };
-    test_frame = loadFrame(srcCode, jumpPoints, 2, 320, 640, 3, 0, NULL);
+    test_frame = loadFrame(srcCode, NULL, jumpPoints, 2, 3, values, 0, 16);
 }
 
 void teardown() {
@@ -39,7 +40,12 @@ Test(Frame, loadFrame_noParams, .init = setup, .fini = teardown) {
 
 Test(Frame, loadFrame_withParams, .init = setup, .fini = teardown) {
     DataConstant params[2] = {createInt(5), createBoolean(false)};
-    test_frame = loadFrame(srcCode, jumpPoints, 2, 640, 640, 3, 2, params);
+    values[0] = params[0];
+    values[1] = params[1];
+    deleteFrame(test_frame);
+    test_frame = loadFrame(srcCode, NULL, jumpPoints, 2, 3, values, 2, 16);
+    cr_expect_eq(test_frame->locals, values); // the arguments are not copied
+    cr_expect_eq(test_frame->stack, values + 16);
     cr_expect_eq(test_frame->instructions, srcCode);
     cr_expect_eq(test_frame->returnAddr, 3);
     cr_expect_arr_eq(test_frame->jumps, jumpPoints, 2);
@@ -51,12 +57,44 @@ Test(Frame, loadFrame_withParams, .init = setup, .fini = teardown) {
     cr_expect_eq(test_frame->sp, -1);
 }
 
+Test(Frame, resetFrame, .init = setup, .fini = teardown) {
+    framePush(test_frame, createInt(1));
+    storeLocal(test_frame, createInt(2));
+    setPC(test_frame, 5);
+
+    values[20] = createBoolean(true);
+    resetFrame(test_frame, srcCode, NULL, NULL, 0, 7, values + 20, 1, 4);
+
+    cr_expect_eq(test_frame->locals, values + 20);
+    cr_expect_eq(test_frame->stack, values + 24);
+    cr_expect_eq(test_frame->returnAddr, 7);
+    cr_expect_eq(test_frame->jc, 0);
+    cr_expect_eq(test_frame->pc, 0);
+    cr_expect_eq(test_frame->sp, -1);
+    cr_expect_eq(test_frame->lp, 0);
+    cr_expect(asBool(test_frame->locals[0]));
+}
+
+Test(Frame, moveStack, .init = setup, .fini = teardown) {
+    framePush(test_frame, createInt(1));
+    framePush(test_frame, createInt(2));
+    moveStack(test_frame, 32);
+    cr_expect_eq(test_frame->localsCapacity, 32);
+    cr_expect_eq(test_frame->stack, values + 32);
+    cr_expect_eq(test_frame->sp, 1);
+    cr_expect_eq(asInt(test_frame->stack[0]), 1);
+    cr_expect_eq(asInt(test_frame->stack[1]), 2);
+
+    DataConstant moved[64];
+    rebaseFrame(test_frame, values, moved);
+    cr_expect_eq(test_frame->locals, moved);
+    cr_expect_eq(test_frame->stack, moved + 32);
+}
+
 Test(Frame, test_frameBasicOperations, .init = setup, .fini = teardown) {
     cr_expect_eq(test_frame->pc, 0);
     setPC(test_frame, 5);
     cr_expect_eq(test_frame->pc, 5);
-    incrementPC(test_frame);
-    cr_expect_eq(test_frame->pc, 6);
 
     cr_expect_eq(test_frame->lp, -1);
     cr_expect_eq(test_frame->sp, -1);
@@ -78,32 +116,28 @@ Test(Frame, test_frameBasicOperations, .init = setup, .fini = teardown) {
     cr_expect(isEqual(test_frame->locals[0], localVal));
     DataConstant newLocalVal = createBoolean(false);
     storeLocalAtAddr(test_frame, newLocalVal, 0);
-    cr_expect_eq(test_frame->locals[0].value.boolVal, false);
-}
-
-Test(Frame, test_frameWithInstructions, .init = setup, .fini = teardown) {
-    cr_expect_eq(test_frame->pc, 0);
-    cr_expect_str_eq(peekNextInstruction(test_frame), "_entry:");
-    cr_expect_eq(test_frame->pc, 0);
-    cr_expect_str_eq(getNextInstruction(test_frame), "_entry:");
-    cr_expect_eq(test_frame->pc, 1);
+    cr_expect_eq(asBool(test_frame->locals[0]), false);
 }
 
-Test(Frame, test_frameWithJumps, .init = setup, .fini = teardown) {
-    int start = getJumpStart(test_frame, "_entry");
-    cr_expect_eq(start, 5);
-    int end = getJumpEnd(test_frame, "_entry");
-    cr_expect_eq(end, 9);
-    start = getJumpStart(test_frame, "notFound");
-    cr_expect_eq(start, -1);
-    end = getJumpEnd(test_frame, "notFound");
-    cr_expect_eq(end, -1);
+Test(Frame, reverseArguments, .init = setup, .fini = teardown) {
+    framePush(test_frame, createInt(1));
+    framePush(test_frame, createInt(2));
+    framePush(test_frame, createInt(3));
+    framePush(test_frame, createInt(4));
+    DataConstant* args = reverseArguments(test_frame, 3);
+    cr_expect_eq(test_frame->sp, 3);
+    cr_expect_eq(asInt(args[0]), 4);
+    cr_expect_eq(asInt(args[1]), 3);
+    cr_expect_eq(asInt(args[2]), 2);
+    cr_expect_eq(asInt(framePeek(test_frame, 3)), 1);
+    frameDrop(test_frame, 3);
+    cr_expect_eq(asInt(frameTop(test_frame)), 1);
 }
 
 Test(Frame, test_framePrintArray_empty, .init = cr_redirect_stdout) {
     srcCode = createStringVector();
     jumpPoints = NULL;
-    test_frame = loadFrame(srcCode, jumpPoints, 0, 32, 32, 0, 0, NULL);
+    test_frame = loadFrame(srcCode, NULL, jumpPoints, 0, 0, values, 0, 0);
 
     print_array("stack", test_frame->stack, -1);
     fflush(stdout);
@@ -116,7 +150,7 @@ Test(Frame, test_framePrintArray_empty, .init = cr_redirect_stdout) {
 Test(Frame, test_framePrintArray_nonEmpty, .init = cr_redirect_stdout) {
     srcCode = createStringVector();
     jumpPoints = NULL;
-    test_frame = loadFrame(srcCode, jumpPoints, 0, 64, 64, 0, 0, NULL);
+    test_frame = loadFrame(srcCode, NULL, jumpPoints, 0, 0, values, 0, 0);
 
     framePush(test_frame, createInt(5));
     framePush(test_frame, createInt(21));
@@ -10,20 +10,10 @@
 
 TestSuite(impl_builtin);
 
-typedef struct {
-    VM* vm;
-    Frame* frame;
-    bool globalsExpanded;
-} TestArraySetup;
-
-TestArraySetup setupArrayTest(VMConfig conf) { // reduce repetition in test setup
-    TestArraySetup setup;
+VM* setupArrayTest(VMConfig conf) { // reduce repetition in test setup
     JumpPoint** jumps = {(JumpPoint* [1]) {}};
     SourceCode* src = createSource((char* [1]) {"_entry"}, (char* [1]) {"HALT"}, (int[1]) {0}, jumps, 1);
-    setup.vm = init(src, conf);
-    setup.frame = loadFrame(createStringVector(), *jumps, 0, conf.dynamicResourceExpansionEnabled ? conf.stackSizeSoftMax : conf.stackSizeHardMax, conf.dynamicResourceExpansionEnabled ? conf.localsHardMax : conf.localsHardMax, 0, 0, NULL);
-    setup.globalsExpanded = false;
-    return setup;
+    return init(src, conf);
 }
 
 typedef struct {
@@ -62,8 +52,7 @@ ParameterizedTest(getTypeInput* input, impl_builtin, print_non_array, .init = cr
 
 
 Test(impl_builtin, print_empty_array, .init = cr_redirect_stdout) {
-        DataConstant* fakeLocals = (DataConstant [1]) {createNone()};
-        DataConstant addr = createAddr(fakeLocals, 0, 1, 0);
+        DataConstant addr = createTestArray(1, 0, NULL);
 
         setbuf(stdout, NULL);
         print(addr, true);
@@ -72,8 +61,7 @@ Test(impl_builtin, print_empty_array, .init = cr_redirect_stdout) {
 
 Test(impl_builtin, print_array, .init = cr_redirect_stdout, .disabled = true) {
         // NOTE: this test fails due to a bug with cr_assert_stdout_eq_str so skipping it
-        DataConstant* fakeLocals = (DataConstant [1]) {createInt(5)};
-        DataConstant addr = createAddr(fakeLocals, 0, 1, 1);
+        DataConstant addr = createTestArray(1, 1, (DataConstant[1]) {createInt(5)});
 
         setbuf(stdout, NULL);
         print(addr, true);
@@ -94,9 +82,7 @@ Test(impl_builtin, printerr_terminating, .init = cr_redirect_stderr, .exit_code
 }
 
 ParameterizedTestParameters(impl_builtin, getType) {
-    DataConstant* fakeLocals = cr_malloc(sizeof(DataConstant) * 2);
-    fakeLocals[0] = createInt(4);
-    fakeLocals[1] = createInt(2);
+    DataConstant array = createTestArray(2, 2, (DataConstant[2]) {createInt(4), createInt(2)});
     size_t count = 8;
     getTypeInput* values = cr_malloc(sizeof(getTypeInput) * count);
     
@@ -106,8 +92,8 @@ ParameterizedTestParameters(impl_builtin, getType) {
     values[3] = (getTypeInput) {createString("whoami"), cr_strdup("string")};
     values[4] = (getTypeInput) {createNull(), cr_strdup("null")};
     values[5] = (getTypeInput) {createNone(), cr_strdup("None")};
-    values[6] = (getTypeInput) {createAddr(fakeLocals, 0, 2, 2), cr_strdup("Array<int>")};
-    values[7] = (getTypeInput) {(DataConstant) {8, (DataValue){}, 0, 0, 0}, cr_strdup("Unknown")};
+    values[6] = (getTypeInput) {array, cr_strdup("Array<int>")};
+    values[7] = (getTypeInput) {createRope(NULL), cr_strdup("Unknown")}; // every boxed tag is a valid type, ropes are flattened before builtins see them
     return cr_make_param_array(getTypeInput, values, count, free_getTypeInput);
 
 }
@@ -119,12 +105,11 @@ ParameterizedTest(getTypeInput* input, impl_builtin, getType) {
 }
 
 Test(impl_builtin, at_invalid, .init = cr_redirect_stderr) {
-    ExitCode vmState = success;
-    char* string = "language";
-    char* result = at(string, 10, &vmState);
+    VM* vm = setupArrayTest(getDefaultConfig());
+    DataConstant result = at(createString("language"), 10, vm);
     cr_assert_stderr_eq_str("IndexError: String index out of range in function call 'at(\"language\", 10)'\n");
-    cr_expect_str_empty(result);
-    cr_expect_eq(vmState, memory_err);
+    cr_expect_str_empty(asString(result));
+    cr_expect_eq(vm->state, memory_err);
 }
 
 typedef struct {
@@ -154,12 +139,13 @@ ParameterizedTestParameters(impl_builtin, at_valid) {
 }
 
 ParameterizedTest(atInput* input, impl_builtin, at_valid) {
-    ExitCode vmState = success;
+    VM* vm = setupArrayTest(getDefaultConfig());
     char* string = "language";
-    char* result = at(string, input->index, &vmState);
-    // cr_log_info("Result: %s\n", result);
-    cr_expect_str_eq(result, input->result);
-    cr_expect_eq(vmState, success);
+    DataConstant result = at(createString(string), input->index, vm);
+    cr_expect_eq(valueType(result), View);
+    cr_expect_eq(getView(result)->start, string + input->index);
+    cr_expect_str_eq(asString(flattenString(vm, result)), input->result);
+    cr_expect_eq(vm->state, success);
 }
 
 Test(impl_builtin, startsWith_true) {
@@ -224,193 +210,138 @@ Test(impl_builtin, replace_single_not_found) {
     cr_expect_str_eq(replaced, "Kotlin");
 }
 
+Test(impl_builtin, replace_stringInsidePattern) {
+    char* replaced = replace("Java", "Javascript", "TS", false);
+    cr_expect_str_eq(replaced, "Java");
+}
+
 Test(impl_builtin, replace_multiple_not_found) {
     char* replaced = replace("Kotlin", "ll", "-", true);
     cr_expect_str_eq(replaced, "Kotlin");
 }
 
+Test(impl_builtin, replace_multiple_replacementContainsPattern) {
+    char* replaced = replace("a-a", "a", "aa", true);
+    cr_expect_str_eq(replaced, "aa-aa");
+}
+
+Test(impl_builtin, replace_multiple_createdOccurrencesKept) {
+    char* replaced = replace("aabb", "ab", "", true);
+    cr_expect_str_eq(replaced, "ab");
+}
+
 Test(impl_builtin, slice_str_error, .init = cr_redirect_stderr) {
-    ExitCode vmState = success;
-    char* result = slice("Ten", 4, 3, &vmState);
+    VM* vm = setupArrayTest(getDefaultConfig());
+    DataConstant result = slice(createString("Ten"), 4, 3, vm);
     cr_assert_stderr_eq_str("Invalid start value of slice 4\n");
-    cr_expect_str_empty(result);
-    cr_expect_eq(vmState, memory_err);
+    cr_expect_str_empty(asString(result));
+    cr_expect_eq(vm->state, memory_err);
 }
 
 Test(impl_builtin, slice_str_valid_full) {
-    ExitCode vmState = success;
-    char* sliced = slice("Ten", 0, 3, &vmState);
-    // cr_log_info("%s", sliced);
-    cr_expect_str_eq(sliced, "Ten");
+    VM* vm = setupArrayTest(getDefaultConfig());
+    char* string = "Ten";
+    DataConstant sliced = slice(createString(string), 0, 3, vm);
+    cr_expect_eq(valueType(sliced), Str);
+    cr_expect_eq(asString(sliced), string);
+    cr_expect_null(vm->views);
 }
 
 Test(impl_builtin, slice_str_valid) {
-    ExitCode vmState = success;
-    char* sliced = slice("What time is it?", 5, 9, &vmState);
-    // cr_log_info("%s", sliced);
-    cr_expect_str_eq(sliced, "time");
+    VM* vm = setupArrayTest(getDefaultConfig());
+    char* string = "What time is it?";
+    DataConstant sliced = slice(createString(string), 5, 9, vm);
+    cr_expect_eq(valueType(sliced), View);
+    cr_expect_eq(getView(sliced)->start, string + 5);
+    cr_expect_eq(getView(sliced)->length, 4);
+    cr_expect(isEqual(sliced, createString("time")));
+    cr_expect_eq(vm->stringCount, 0);
 }
 
-Test(impl_builtin, splitString_NullDelim) {
-    TestArraySetup setup = setupArrayTest(getDefaultConfig());
+Test(impl_builtin, slice_str_ofView) {
+    VM* vm = setupArrayTest(getDefaultConfig());
+    DataConstant string = adoptString(vm, strdup("What time is it?"));
+    DataConstant sliced = slice(slice(string, 5, 16, vm), 5, 7, vm);
+    cr_expect_eq(getView(sliced)->parent, asString(string)); // borrows from the string, not the first view
+    cr_expect_eq(getView(sliced)->start, asString(string) + 10);
+    cr_expect_str_eq(asString(flattenString(vm, sliced)), "is");
+}
 
-    DataConstant result = splitString("a,b,c", NULL, setup.vm, setup.frame, &setup.globalsExpanded, false);
+Test(impl_builtin, splitString_NullDelim) {
+    VM* vm = setupArrayTest(getDefaultConfig());
 
-    cr_expect_eq(result.type, Addr);
-    cr_expect_eq(result.length, 5);
-    cr_expect_eq(result.size, 5);
-    cr_expect_eq(result.offset, 0);
-    cr_expect_eq(result.value.address, setup.frame->locals);
+    DataConstant result = splitString(createString("a,b,c"), NULL, vm);
 
-    cr_expect(isEqual(setup.frame->locals[0], createString("a")));
-    cr_expect(isEqual(setup.frame->locals[1], createString(",")));
-    cr_expect(isEqual(setup.frame->locals[2], createString("b")));
-    cr_expect(isEqual(setup.frame->locals[3], createString(",")));
-    cr_expect(isEqual(setup.frame->locals[4], createString("c")));
+    cr_expect_eq(valueType(result), Addr);
+    cr_expect_eq(getArrayHeader(result)->length, 5);
+    cr_expect_eq(getArrayHeader(result)->capacity, 5);
+    cr_expect_eq(vm->arrays, getArrayHeader(result));
 
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect_not(setup.frame->expandedLocals);
+    cr_expect(isEqual(getArrayStart(result)[0], createString("a")));
+    cr_expect(isEqual(getArrayStart(result)[1], createString(",")));
+    cr_expect(isEqual(getArrayStart(result)[2], createString("b")));
+    cr_expect(isEqual(getArrayStart(result)[3], createString(",")));
+    cr_expect(isEqual(getArrayStart(result)[4], createString("c")));
 }
 
 Test(impl_builtin, splitString_doesNotContainDelim) {
-    TestArraySetup setup = setupArrayTest(getDefaultConfig());
-
-    DataConstant result = splitString("a,b,c", ".", setup.vm, setup.frame, &setup.globalsExpanded, false);
+    VM* vm = setupArrayTest(getDefaultConfig());
 
-    cr_expect_eq(result.type, Addr);
-    cr_expect_eq(result.length, 1);
-    cr_expect_eq(result.size, 1);
-    cr_expect_eq(result.offset, 0);
-    cr_expect_eq(result.value.address, setup.frame->locals);
+    DataConstant result = splitString(createString("a,b,c"), ".", vm);
 
-    cr_expect(isEqual(setup.frame->locals[0], createString("a,b,c")));
+    cr_expect_eq(valueType(result), Addr);
+    cr_expect_eq(getArrayHeader(result)->length, 1);
+    cr_expect_eq(getArrayHeader(result)->capacity, 1);
+    cr_expect_eq(vm->arrays, getArrayHeader(result));
 
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect_not(setup.frame->expandedLocals);
+    cr_expect(isEqual(getArrayStart(result)[0], createString("a,b,c")));
 }
 
 Test(impl_builtin, splitString_containsDelim) {
-    TestArraySetup setup = setupArrayTest(getDefaultConfig());
-
-    DataConstant result = splitString("a,b,c", ",", setup.vm, setup.frame, &setup.globalsExpanded, false);
-
-    cr_expect_eq(result.type, Addr);
-    cr_expect_eq(result.length, 3);
-    cr_expect_eq(result.size, 3);
-    cr_expect_eq(result.offset, 0);
-    cr_expect_eq(result.value.address, setup.frame->locals);
-
-    cr_expect(isEqual(setup.frame->locals[0], createString("a")));
-    cr_expect(isEqual(setup.frame->locals[1], createString("b")));
-    cr_expect(isEqual(setup.frame->locals[2], createString("c")));
-
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect_not(setup.frame->expandedLocals);
-}
-
-Test(impl_builtin, splitString_containsDelim_expandLocals) {
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 2;
-
-    TestArraySetup setup = setupArrayTest(conf);
-
-    DataConstant result = splitString("a,b,c", ",", setup.vm, setup.frame, &setup.globalsExpanded, false);
-
-    cr_expect_eq(result.type, Addr);
-    cr_expect_eq(result.length, 3);
-    cr_expect_eq(result.size, 3);
-    cr_expect_eq(result.offset, 0);
-    cr_expect_eq(result.value.address, setup.frame->locals);
-
-    cr_expect(isEqual(setup.frame->locals[0], createString("a")));
-    cr_expect(isEqual(setup.frame->locals[1], createString("b")));
-    cr_expect(isEqual(setup.frame->locals[2], createString("c")));
-
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect(setup.frame->expandedLocals);
-}
-
-Test(impl_builtin, splitString_containsDelim_useGlobals) {
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 2;
-
-    TestArraySetup setup = setupArrayTest(conf);
-
-    DataConstant result = splitString("a,b,c", ",", setup.vm, setup.frame, &setup.globalsExpanded, false);
-
-    cr_expect_eq(result.type, Addr);
-    cr_expect_eq(result.length, 3);
-    cr_expect_eq(result.size, 3);
-    cr_expect_eq(result.offset, 0);
-    cr_expect_eq(result.value.address, setup.vm->globals);
-
-    cr_expect(isEqual(setup.vm->globals[0], createString("a")));
-    cr_expect(isEqual(setup.vm->globals[1], createString("b")));
-    cr_expect(isEqual(setup.vm->globals[2], createString("c")));
-
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect_not(setup.frame->expandedLocals);
-}
-
-Test(impl_builtin, splitString_containsDelim_expandGlobals) {
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 2;
-    conf.localsHardMax = BASE_BYTES * 2;
-    conf.globalsSoftMax = BASE_BYTES * 2;
+    VM* vm = setupArrayTest(getDefaultConfig());
 
-    TestArraySetup setup = setupArrayTest(conf);
+    DataConstant result = splitString(createString("a,b,c"), ",", vm);
 
-    DataConstant result = splitString("a,b,c", ",", setup.vm, setup.frame, &setup.globalsExpanded, false);
+    cr_expect_eq(valueType(result), Addr);
+    cr_expect_eq(getArrayHeader(result)->length, 3);
+    cr_expect_eq(getArrayHeader(result)->capacity, 3);
+    cr_expect_eq(getArrayHeader(result)->elementType, Str);
+    cr_expect_eq(vm->arrays, getArrayHeader(result));
 
-    cr_expect_eq(result.type, Addr);
-    cr_expect_eq(result.length, 3);
-    cr_expect_eq(result.size, 3);
-    cr_expect_eq(result.offset, 0);
-    cr_expect_eq(result.value.address, setup.vm->globals);
-
-    cr_expect(isEqual(setup.vm->globals[0], createString("a")));
-    cr_expect(isEqual(setup.vm->globals[1], createString("b")));
-    cr_expect(isEqual(setup.vm->globals[2], createString("c")));
-
-    cr_expect(setup.globalsExpanded);
-    cr_expect_not(setup.frame->expandedLocals);
+    cr_expect(isEqual(getArrayStart(result)[0], createString("a")));
+    cr_expect(isEqual(getArrayStart(result)[1], createString("b")));
+    cr_expect(isEqual(getArrayStart(result)[2], createString("c")));
 }
 
-Test(impl_builtin, splitString_containsDelim_localsError, .init = cr_redirect_stderr) {
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.useHeapStorageBackup = false;
-    conf.localsHardMax = BASE_BYTES;
-    
-    TestArraySetup setup = setupArrayTest(conf);
-
-    DataConstant result = splitString("a,b,c", ",", setup.vm, setup.frame, &setup.globalsExpanded, false);
+Test(impl_builtin, splitString_skipsEmptyTokens) {
+    VM* vm = setupArrayTest(getDefaultConfig());
+    char* string = ",,ab;c,,d;";
 
-    cr_expect_eq(result.type, None);
+    DataConstant result = splitString(createString(string), ",;", vm);
 
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect_not(setup.frame->expandedLocals);
-
-    cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 1\n");
+    cr_expect_eq(getArrayHeader(result)->length, 3);
+    cr_expect(isEqual(getArrayStart(result)[0], createString("ab")));
+    cr_expect(isEqual(getArrayStart(result)[1], createString("c")));
+    cr_expect(isEqual(getArrayStart(result)[2], createString("d")));
+    cr_expect_eq(getView(getArrayStart(result)[0])->start, string + 2);
+    cr_expect_eq(vm->stringCount, 0); // no token was copied
 }
 
-Test(impl_builtin, splitString_containsDelim_globalsError, .init = cr_redirect_stderr) {
+Test(impl_builtin, splitString_containsDelim_heapError, .init = cr_redirect_stderr) {
     VMConfig conf = getDefaultConfig();
     conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES;
     conf.globalsHardMax = BASE_BYTES * 2;
 
-    TestArraySetup setup = setupArrayTest(conf);
-
-    DataConstant result = splitString("a,b,c", ",", setup.vm, setup.frame, &setup.globalsExpanded, false);
+    VM* vm = setupArrayTest(conf);
 
-    cr_expect_eq(result.type, None);
+    DataConstant result = splitString(createString("a,b,c"), ",", vm);
 
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect_not(setup.frame->expandedLocals);
+    cr_expect_eq(valueType(result), None);
+    cr_expect_null(vm->views);
+    cr_expect_eq(vm->state, memory_err);
+    cr_expect_null(vm->arrays);
 
-    cr_expect_stderr_eq_str("HeapOverflow: Exceeded local storage maximum of 1 and global storage maximum of 2\n");
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 2\n");
 }
 
 // File System functions
@@ -449,21 +380,17 @@ Test(impl_builtin, renameFile_nonExistant, .init = cr_redirect_stderr) {
 }
 
 Test(impl_builtin, readFile_nonExistant, .init = cr_redirect_stderr) {
-    TestArraySetup setup = setupArrayTest(getDefaultConfig());
+    VM* vm = setupArrayTest(getDefaultConfig());
 
     cr_expect_not(fileExists(NON_EXISTANT_TEST_FILE));
-    DataConstant read = readFile(NON_EXISTANT_TEST_FILE, setup.vm, setup.frame, &setup.globalsExpanded, false);
-    cr_expect_eq(read.type, None);
+    DataConstant read = readFile(NON_EXISTANT_TEST_FILE, vm);
+    cr_expect_eq(valueType(read), None);
     cr_expect_stderr_eq_str("FileError: Cannot read file '.tempfile_fake.txt' because it does not exist\n");
-    cr_expect_eq(setup.vm->state, file_err);
+    cr_expect_eq(vm->state, file_err);
 }
 
 Test(impl_builtin, writeAppendReadDeleteFile) {
-    TestArraySetup setup = setupArrayTest(getDefaultConfig());
-
-    VM* vm = setup.vm;
-    Frame* frame = setup.frame;
-    bool globalsExpanded = setup.globalsExpanded;
+    VM* vm = setupArrayTest(getDefaultConfig());
 
     char* filename = ".tempfile.txt";
 
@@ -474,239 +401,42 @@ Test(impl_builtin, writeAppendReadDeleteFile) {
     cr_expect_eq(vmState, success);
     cr_expect(fileExists(filename));
     
-    DataConstant read1 = readFile(filename, vm, frame, &globalsExpanded, true);
+    DataConstant read1 = readFile(filename, vm);
     cr_expect_eq(vm->state, success);
-    cr_expect_eq(read1.length, 1);
-    cr_expect_eq(read1.value.address, frame->locals);
-    cr_expect_eq(read1.offset, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_str_eq(frame->locals[0].value.strVal, "hello\n");
+    cr_expect_eq(getArrayHeader(read1)->length, 1);
+    cr_expect(isEqual(getArrayStart(read1)[0], createString("hello\n")));
 
     writeToFile(filename, "hello", "w", &vmState); // should overwrite file contents
     cr_expect_eq(vmState, success);
-    DataConstant read2 = readFile(filename, vm, frame, &globalsExpanded, false);
-    cr_expect_eq(vm->state, success);
-    cr_expect_eq(read2.length, 1);
-    cr_expect_eq(read2.value.address, frame->locals);
-    cr_expect_eq(read2.offset, 1);
-    cr_expect_eq(frame->lp, 1);
-    cr_expect_str_eq(frame->locals[1].value.strVal, "hello\n");
-    
-    writeToFile(filename, "world", "a", &vmState); // should not overwrite file contents
-    cr_expect_eq(vmState, success);
-    DataConstant read3 = readFile(filename, vm, frame, &globalsExpanded, false);
+    DataConstant read2 = readFile(filename, vm);
     cr_expect_eq(vm->state, success);
-    cr_expect_eq(read3.length, 2);
-    cr_expect_eq(read3.value.address, frame->locals);
-    cr_expect_eq(read3.offset, 2);
-    cr_expect_eq(frame->lp, 3);
-    cr_expect_str_eq(frame->locals[2].value.strVal, "hello\n");
-    cr_expect_str_eq(frame->locals[3].value.strVal, "world\n");
-
-    deleteFile(filename, &vmState);
-    cr_expect_eq(vmState, success);
-    cr_expect_not(fileExists(filename));
-}
-
-Test(impl_builtin, writeAppendReadDeleteFile_expandLocals) {
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 3;
+    cr_expect_eq(getArrayHeader(read2)->length, 1);
+    cr_expect_neq(asAddress(read2), asAddress(read1));
+    cr_expect(isEqual(getArrayStart(read2)[0], createString("hello\n")));
     
-    TestArraySetup setup = setupArrayTest(conf);
-    VM* vm = setup.vm;
-    Frame* frame = setup.frame;
-    bool globalsExpanded = setup.globalsExpanded;
-
-    char* filename = ".tempfile_le.txt";
-
-    ExitCode vmState = success;
-    cr_expect_not(fileExists(filename));
-
-    writeToFile(filename, "hello", "w", &vmState);
-    cr_expect_eq(vmState, success);
-    cr_expect(fileExists(filename));
-    DataConstant read1 = readFile(filename, vm, frame, &globalsExpanded, false);
-    cr_expect_eq(vm->state, success);
-    cr_expect_eq(read1.length, 1);
-    cr_expect_eq(read1.value.address, frame->locals);
-    cr_expect_eq(read1.offset, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_str_eq(frame->locals[0].value.strVal, "hello\n");
-    cr_expect_not(frame->expandedLocals);
-
-    writeToFile(filename, "world", "a", &vmState); // should not overwrite file contents
-    cr_expect_eq(vmState, success);
-    DataConstant read2 = readFile(filename, vm, frame, &globalsExpanded, false);
-    cr_expect_eq(vm->state, success);
-    cr_expect_eq(read2.length, 2);
-    cr_expect_eq(read2.value.address, frame->locals);
-    cr_expect_eq(read2.offset, 1);
-    cr_expect_eq(frame->lp, 2);
-    cr_expect_str_eq(frame->locals[1].value.strVal, "hello\n");
-    cr_expect_str_eq(frame->locals[2].value.strVal, "world\n");
-    cr_expect(frame->expandedLocals);
-
-    deleteFile(filename, &vmState);
-    cr_expect_eq(vmState, success);
-    cr_expect_not(fileExists(filename));
-}
-
-Test(impl_builtin, writeAppendReadDeleteFile_useGlobals) {
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES;
-
-    TestArraySetup setup = setupArrayTest(conf);
-
-    VM* vm = setup.vm;
-    Frame* frame = setup.frame;
-    bool globalsExpanded = setup.globalsExpanded;
-
-    char* filename = ".tempfile_g.txt";
-
-    ExitCode vmState = success;
-    cr_expect_not(fileExists(filename));
-
-    writeToFile(filename, "hello", "w", &vmState);
-    cr_expect_eq(vmState, success);
-    cr_expect(fileExists(filename));
-    DataConstant read1 = readFile(filename, vm, frame, &globalsExpanded, false);
-    cr_expect_eq(vm->state, success);
-    cr_expect_eq(read1.length, 1);
-    cr_expect_eq(read1.value.address, frame->locals);
-    cr_expect_eq(read1.offset, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_str_eq(frame->locals[0].value.strVal, "hello\n");
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_not(globalsExpanded);
-
     writeToFile(filename, "world", "a", &vmState); // should not overwrite file contents
     cr_expect_eq(vmState, success);
-    DataConstant read2 = readFile(filename, vm, frame, &globalsExpanded, false);
-    cr_expect_eq(vm->state, success);
-    cr_expect_eq(read2.length, 2);
-    cr_expect_eq(read2.value.address, vm->globals);
-    cr_expect_eq(read2.offset, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_eq(vm->gp, 1);
-    cr_expect_str_eq(vm->globals[0].value.strVal, "hello\n");
-    cr_expect_str_eq(vm->globals[1].value.strVal, "world\n");
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_not(globalsExpanded);
-
-    deleteFile(filename, &vmState);
-    cr_expect_eq(vmState, success);
-    cr_expect_not(fileExists(filename));
-}
-
-Test(impl_builtin, writeAppendReadDeleteFile_expandGlobals) {
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES;
-    conf.localsHardMax = BASE_BYTES;
-    conf.globalsSoftMax = BASE_BYTES;
-
-    TestArraySetup setup = setupArrayTest(conf);
-
-    VM* vm = setup.vm;
-    Frame* frame = setup.frame;
-    bool globalsExpanded = setup.globalsExpanded;
-
-    char* filename = ".tempfile_ge.txt";
-
-    ExitCode vmState = success;
-    cr_expect_not(fileExists(filename));
-
-    writeToFile(filename, "hello", "w", &vmState);
-    cr_expect_eq(vmState, success);
-    cr_expect(fileExists(filename));
-    DataConstant read1 = readFile(filename, vm, frame, &globalsExpanded, false);
-    cr_expect_eq(vm->state, success);
-    cr_expect_eq(read1.length, 1);
-    cr_expect_eq(read1.value.address, frame->locals);
-    cr_expect_eq(read1.offset, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_str_eq(frame->locals[0].value.strVal, "hello\n");
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_not(globalsExpanded);
-
-    writeToFile(filename, "world", "a", &vmState); // should not overwrite file contents
-    writeToFile(filename, "from file", "a", &vmState); // should not overwrite file contents
-    cr_expect_eq(vmState, success);
-    DataConstant read2 = readFile(filename, vm, frame, &globalsExpanded, false);
-    cr_expect_eq(vm->state, success);
-    cr_expect_eq(read2.length, 3);
-    cr_expect_eq(read2.value.address, vm->globals);
-    cr_expect_eq(read2.offset, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_eq(vm->gp, 2);
-    cr_expect_str_eq(vm->globals[0].value.strVal, "hello\n");
-    cr_expect_str_eq(vm->globals[1].value.strVal, "world\n");
-    cr_expect_str_eq(vm->globals[2].value.strVal, "from file\n");
-    cr_expect_not(frame->expandedLocals);
-    cr_expect(globalsExpanded);
-
-    deleteFile(filename, &vmState);
-    cr_expect_eq(vmState, success);
-    cr_expect_not(fileExists(filename));
-}
-
-Test(impl_builtin, writeAppendReadDeleteFile_localsError, .init = cr_redirect_stderr) {
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.useHeapStorageBackup = false;
-    conf.localsHardMax = BASE_BYTES;
-    
-    TestArraySetup setup = setupArrayTest(conf);
-
-    VM* vm = setup.vm;
-    Frame* frame = setup.frame;
-    bool globalsExpanded = setup.globalsExpanded;
-
-    char* filename = ".tempfile_error_l.txt";
-
-    ExitCode vmState = success;
-    cr_expect_not(fileExists(filename));
-
-    writeToFile(filename, "hello", "w", &vmState);
-    cr_expect_eq(vmState, success);
-    cr_expect(fileExists(filename));
-    DataConstant read1 = readFile(filename, vm, frame, &globalsExpanded, false);
+    DataConstant read3 = readFile(filename, vm);
     cr_expect_eq(vm->state, success);
-    cr_expect_eq(read1.length, 1);
-    cr_expect_eq(read1.value.address, frame->locals);
-    cr_expect_eq(read1.offset, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_str_eq(frame->locals[0].value.strVal, "hello\n");
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_not(globalsExpanded);
-
-    writeToFile(filename, "world", "a", &vmState); // should not overwrite file contents
-    cr_expect_eq(vmState, success);
-    DataConstant read2 = readFile(filename, vm, frame, &globalsExpanded, false);
-    cr_expect_eq(vm->state, memory_err);
-    cr_expect_eq(read2.type, None);
-    cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 1\n");
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_not(globalsExpanded);
+    cr_expect_eq(getArrayHeader(read3)->length, 2);
+    cr_expect_eq(vm->arrays, getArrayHeader(read3));
+    cr_expect(isEqual(getArrayStart(read3)[0], createString("hello\n")));
+    cr_expect(isEqual(getArrayStart(read3)[1], createString("world\n")));
+    cr_expect_eq(getView(getArrayStart(read3)[1])->parent, getView(getArrayStart(read3)[0])->parent); // the lines share the file's contents
 
     deleteFile(filename, &vmState);
     cr_expect_eq(vmState, success);
     cr_expect_not(fileExists(filename));
 }
 
-Test(impl_builtin, writeAppendReadDeleteFile_globalsError, .init = cr_redirect_stderr) {
+Test(impl_builtin, writeAppendReadDeleteFile_heapError, .init = cr_redirect_stderr) {
     VMConfig conf = getDefaultConfig();
     conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES;
-    conf.globalsHardMax = BASE_BYTES;
-
-   TestArraySetup setup = setupArrayTest(conf);
+    conf.globalsHardMax = BASE_BYTES * 8;
 
-    VM* vm = setup.vm;
-    Frame* frame = setup.frame;
-    bool globalsExpanded = setup.globalsExpanded;
+    VM* vm = setupArrayTest(conf);
 
-    char* filename = ".tempfile_error_g.txt";
+    char* filename = ".tempfile_error_h.txt";
 
     ExitCode vmState = success;
     cr_expect_not(fileExists(filename));
@@ -714,24 +444,18 @@ Test(impl_builtin, writeAppendReadDeleteFile_globalsError, .init = cr_redirect_s
     writeToFile(filename, "hello", "w", &vmState);
     cr_expect_eq(vmState, success);
     cr_expect(fileExists(filename));
-    DataConstant read1 = readFile(filename, vm, frame, &globalsExpanded, false);
+    DataConstant read1 = readFile(filename, vm);
     cr_expect_eq(vm->state, success);
-    cr_expect_eq(read1.length, 1);
-    cr_expect_eq(read1.value.address, frame->locals);
-    cr_expect_eq(read1.offset, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_str_eq(frame->locals[0].value.strVal, "hello\n");
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_not(globalsExpanded);
+    cr_expect_eq(getArrayHeader(read1)->length, 1);
+    cr_expect(isEqual(getArrayStart(read1)[0], createString("hello\n")));
+    framePush(vm->callStack[0], read1); // keep the first read reachable so the collector cannot free it
 
     writeToFile(filename, "world", "a", &vmState); // should not overwrite file contents
     cr_expect_eq(vmState, success);
-    DataConstant read2 = readFile(filename, vm, frame, &globalsExpanded, false);
+    DataConstant read2 = readFile(filename, vm);
     cr_expect_eq(vm->state, memory_err);
-    cr_expect_eq(read2.type, None);
-    cr_expect_stderr_eq_str("HeapOverflow: Exceeded local storage maximum of 1 and global storage maximum of 1\n");
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_not(globalsExpanded);
+    cr_expect_eq(valueType(read2), None);
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 8\n");
 
     deleteFile(filename, &vmState);
     cr_expect_eq(vmState, success);
@@ -759,205 +483,81 @@ Test(impl_builtin, createRenameDeleteFile) {
 
 // Array functions
 Test(impl_builtin, reverseArr) {
-    DataConstant* locals = (DataConstant[]) {createInt(2), createInt(0), createInt(-1)};
-    DataConstant array = createAddr(locals, 0, 3, 3);
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(2), createInt(0), createInt(-1)});
     reverseArr(array);
-    cr_expect_eq(locals[0].value.intVal, -1);
-    cr_expect_eq(locals[1].value.intVal, 0);
-    cr_expect_eq(locals[2].value.intVal, 2);
+    cr_expect_eq(asInt(getArrayStart(array)[0]), -1);
+    cr_expect_eq(asInt(getArrayStart(array)[1]), 0);
+    cr_expect_eq(asInt(getArrayStart(array)[2]), 2);
 }
 
 Test(impl_builtin, sliceArr_valid) {
-    TestArraySetup setup = setupArrayTest(getDefaultConfig());
-
-    setup.frame->lp = 2;
-    setup.frame->locals[0] = createInt(2);
-    setup.frame->locals[1] = createInt(0);
-    setup.frame->locals[2] = createInt(-1);
-    DataConstant array = createAddr(setup.frame->locals, 0, 3, 3);
-    DataConstant result = sliceArr(array, 1, 3, setup.vm, setup.frame, &setup.globalsExpanded, false);
+    VM* vm = setupArrayTest(getDefaultConfig());
+
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(2), createInt(0), createInt(-1)});
+    DataConstant result = sliceArr(array, 1, 3, vm);
     
-    cr_expect_neq(result.type, None);
-    cr_expect_eq(result.length, 2);
-    cr_expect_eq(result.size, array.size);
-    cr_expect_eq((DataConstant *) result.value.address, setup.frame->locals);
-    cr_expect_eq(result.offset, 3);
+    cr_expect_neq(valueType(result), None);
+    cr_expect_eq(getArrayHeader(result)->length, 2);
+    cr_expect_eq(getArrayHeader(result)->capacity, getArrayHeader(array)->capacity);
+    cr_expect_eq(vm->arrays, getArrayHeader(result));
     
-    cr_expect_eq(setup.frame->locals[3].value.intVal, 0);
-    cr_expect_eq(setup.frame->locals[4].value.intVal, -1);
+    cr_expect_eq(asInt(getArrayStart(result)[0]), 0);
+    cr_expect_eq(asInt(getArrayStart(result)[1]), -1);
+    cr_expect_eq(valueType(getArrayStart(result)[2]), None);
 }
 
 Test(impl_builtin, sliceArr_invalid, .init = cr_redirect_stderr) {
-    TestArraySetup setup = setupArrayTest(getDefaultConfig());
+    VM* vm = setupArrayTest(getDefaultConfig());
 
-    DataConstant array = createAddr(setup.frame->locals, 0, 3, 3);
-    DataConstant sliced = sliceArr(array, 4, 3, setup.vm, setup.frame, &setup.globalsExpanded, false);
-    cr_expect_eq(sliced.type, None);
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(2), createInt(0), createInt(-1)});
+    DataConstant sliced = sliceArr(array, 4, 3, vm);
+    cr_expect_eq(valueType(sliced), None);
     cr_expect_stderr_eq_str("Array index out of bounds in call to slice. start: 4, end: 3\n");
-    cr_expect_eq(setup.vm->state, memory_err);
-}
-
-Test(impl_builtin, sliceArr_expandLocals) {
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 4;
-    
-    TestArraySetup setup = setupArrayTest(conf);
-
-    setup.frame->lp = 2;
-    setup.frame->locals[0] = createInt(2);
-    setup.frame->locals[1] = createInt(0);
-    setup.frame->locals[2] = createInt(-1);
-    DataConstant array = createAddr(setup.frame->locals, 0, 3, 3);
-    DataConstant result = sliceArr(array, 1, 3, setup.vm, setup.frame, &setup.globalsExpanded, false);
-    
-    cr_expect_neq(result.type, None);
-    cr_expect_eq(result.length, 2);
-    cr_expect_eq(result.size, array.size);
-    cr_expect_eq((DataConstant *) result.value.address, setup.frame->locals);
-    cr_expect_eq(result.offset, 3);
-    cr_expect_eq(setup.frame->lp, 5);
-    
-    cr_expect_eq(setup.frame->locals[3].value.intVal, 0);
-    cr_expect_eq(setup.frame->locals[4].value.intVal, -1);
-    cr_expect_eq(setup.frame->locals[5].type, None);
-    
-    cr_expect(setup.frame->expandedLocals);
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect_eq(setup.vm->state, success);
-}
-
-Test(impl_builtin, sliceArr_useGlobals) {
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 4;
-    
-    TestArraySetup setup = setupArrayTest(conf);
-
-    setup.frame->lp = 2;
-    setup.frame->locals[0] = createInt(2);
-    setup.frame->locals[1] = createInt(0);
-    setup.frame->locals[2] = createInt(-1);
-    DataConstant array = createAddr(setup.frame->locals, 0, 3, 3);
-    DataConstant result = sliceArr(array, 1, 3, setup.vm, setup.frame, &setup.globalsExpanded, false);
-    
-    cr_expect_neq(result.type, None);
-    cr_expect_eq(result.length, 2);
-    cr_expect_eq(result.size, array.size);
-    cr_expect_eq((DataConstant *) result.value.address, setup.vm->globals);
-    cr_expect_eq(result.offset, 0);
-
-    cr_expect_eq(setup.frame->lp, 2);
-    cr_expect_eq(setup.vm->gp, 2);
-    
-    cr_expect_eq(setup.vm->globals[0].value.intVal, 0);
-    cr_expect_eq(setup.vm->globals[1].value.intVal, -1);
-    cr_expect_eq(setup.vm->globals[2].type, None);
-    
-    cr_expect_not(setup.frame->expandedLocals);
-    cr_expect_not(setup.globalsExpanded);
-    cr_expect_eq(setup.vm->state, success);
-}
-
-Test(impl_builtin, sliceArr_expandGlobals) {
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 3;
-    conf.localsHardMax = BASE_BYTES * 3;
-    conf.globalsSoftMax = BASE_BYTES * 4;
-    conf.globalsHardMax = BASE_BYTES * 10;
-
-    TestArraySetup setup = setupArrayTest(conf);
-
-    setup.frame->lp = 2;
-    setup.frame->locals[0] = createInt(2);
-    setup.frame->locals[1] = createInt(0);
-    setup.frame->locals[2] = createInt(-1);
-    DataConstant array = createAddr(setup.frame->locals, 0, 3, 3);
-    DataConstant result = sliceArr(array, 1, 3, setup.vm, setup.frame, &setup.globalsExpanded, false);
-    
-    cr_expect_neq(result.type, None);
-    cr_expect_eq(result.length, 2);
-    cr_expect_eq(result.size, array.size);
-    cr_expect_eq((DataConstant *) result.value.address, setup.vm->globals);
-    cr_expect_eq(result.offset, 0);
-    cr_expect_eq(setup.frame->lp, 2);
-    cr_expect_eq(setup.vm->gp, 2);
-    
-    cr_expect_eq(setup.vm->globals[0].value.intVal, 0);
-    cr_expect_eq(setup.vm->globals[1].value.intVal, -1);
-    cr_expect_eq(setup.vm->globals[2].type, None);
-    
-    cr_expect_not(setup.frame->expandedLocals);
-    cr_expect(setup.globalsExpanded);
-    cr_expect_eq(setup.vm->state, success);
-}
-
-Test(impl_builtin, sliceArr_localsError, .init = cr_redirect_stderr) {
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.useHeapStorageBackup = false;
-    conf.localsHardMax = BASE_BYTES * 4;
-
-    TestArraySetup setup = setupArrayTest(conf);
-
-    setup.frame->lp = 2;
-    setup.frame->locals[0] = createInt(2);
-    setup.frame->locals[1] = createInt(0);
-    setup.frame->locals[2] = createInt(-1);
-    DataConstant array = createAddr(setup.frame->locals, 0, 3, 3);
-    DataConstant result = sliceArr(array, 1, 3, setup.vm, setup.frame, &setup.globalsExpanded, false);
-    
-    cr_expect_eq(result.type, None);
-    cr_expect_eq(setup.vm->state, memory_err);
-    cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 4\n");
+    cr_expect_eq(vm->state, memory_err);
 }
 
-Test(impl_builtin, sliceArr_globalsError, .init = cr_redirect_stderr) {
+Test(impl_builtin, sliceArr_heapError, .init = cr_redirect_stderr) {
     VMConfig conf = getDefaultConfig();
     conf.dynamicResourceExpansionEnabled = false;
-    conf.useHeapStorageBackup = true;
-    conf.localsHardMax = BASE_BYTES * 3;
-    conf.globalsHardMax = BASE_BYTES * 2;
+    conf.globalsHardMax = BASE_BYTES * 4;
 
-    TestArraySetup setup = setupArrayTest(conf);
+    VM* vm = setupArrayTest(conf);
 
-    setup.frame->lp = 2;
-    setup.frame->locals[0] = createInt(2);
-    setup.frame->locals[1] = createInt(0);
-    setup.frame->locals[2] = createInt(-1);
-    DataConstant array = createAddr(setup.frame->locals, 0, 3, 3);
-    DataConstant result = sliceArr(array, 1, 3, setup.vm, setup.frame, &setup.globalsExpanded, false);
-    
-    cr_expect_eq(result.type, None);
-    cr_expect_eq(setup.vm->state, memory_err);
-    cr_expect_stderr_eq_str("HeapOverflow: Exceeded local storage maximum of 3 and global storage maximum of 2\n");
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(2), createInt(0), createInt(-1)});
+    DataConstant result = sliceArr(array, 1, 3, vm);
+    cr_expect_eq(valueType(result), None);
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 4\n");
+    cr_expect_eq(vm->state, memory_err);
 }
 
 Test(impl_builtin, arrayContains_true) {
-    DataConstant* locals = (DataConstant[]) {createInt(2), createInt(0), createInt(-1)};
-    DataConstant array = createAddr(locals, 0, 3, 3);
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(2), createInt(0), createInt(-1)});
     cr_expect(arrayContains(array, createInt(0)));
 }
 
 Test(impl_builtin, arrayContains_false) {
-    DataConstant* locals = (DataConstant[]) {createInt(2), createInt(0), createInt(-1)};
-    DataConstant array = createAddr(locals, 0, 3, 3);
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(2), createInt(0), createInt(-1)});
     cr_expect_not(arrayContains(array, createInt(5)));
 }
 
 Test(impl_builtin, join_empty) {
-    DataConstant locals[0] = {};
-    DataConstant array = createAddr(locals, 0, 0, 0);
+    DataConstant array = createTestArray(0, 0, NULL);
     char* result = join(array, "");
     cr_expect_str_eq(result, "");
 }
 
 Test(impl_builtin, join_non_empty) {
-    DataConstant* locals = (DataConstant[2]) {createString("hello"), createString("world")};
-    DataConstant array = createAddr(locals, 0, 2, 2);
+    DataConstant array = createTestArray(2, 2, (DataConstant[2]) {createString("hello"), createString("world")});
     char* result = join(array, ", ");
     cr_expect_str_eq(result, "hello, world");
 }
 
+Test(impl_builtin, join_emptyElements) {
+    DataConstant array = createTestArray(4, 4, (DataConstant[4]) {createString(""), createString("a"), createString(""), createString("b")});
+    char* result = join(array, "--");
+    cr_expect_str_eq(result, "--a----b");
+}
+
 bool arraysEqual(DataConstant* array1, DataConstant* array2, int length) {
     for (int i = 0; i < length; i++) {
         if (!isEqual(array1[i], array2[i]))
@@ -967,77 +567,81 @@ bool arraysEqual(DataConstant* array1, DataConstant* array2, int length) {
 }
 
 Test(impl_builtin, sort_strs) {
-    DataConstant* locals = (DataConstant[]) {createString("world"), createString("a"), createString("hello")};
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createString("world"), createString("a"), createString("hello")});
     DataConstant* expected = (DataConstant[]) {createString("a"), createString("hello"), createString("world")};
-    cr_expect_not(arraysEqual(expected, locals, 3));
-    DataConstant array = createAddr(locals, 0, 3, 3);
+    cr_expect_not(arraysEqual(expected, getArrayStart(array), 3));
     sort(array);
-    cr_expect(arraysEqual(expected, locals, 3));
+    cr_expect(arraysEqual(expected, getArrayStart(array), 3));
 }
 
 Test(impl_builtin, sort_bools) {
-    DataConstant* locals = (DataConstant[]) {createBoolean(false), createBoolean(true), createBoolean(true), createNull(), createBoolean(false)};
+    DataConstant array = createTestArray(5, 5, (DataConstant[5]) {createBoolean(false), createBoolean(true), createBoolean(true), createNull(), createBoolean(false)});
     DataConstant* expected = (DataConstant[]) {createNull(), createBoolean(false), createBoolean(false), createBoolean(true), createBoolean(true)};
-    cr_expect_not(arraysEqual(expected, locals, 5));
-    DataConstant array = createAddr(locals, 0, 5, 5);
+    cr_expect_not(arraysEqual(expected, getArrayStart(array), 5));
     sort(array);
-    cr_expect(arraysEqual(expected, locals, 5));
+    cr_expect(arraysEqual(expected, getArrayStart(array), 5));
 }
 
 Test(impl_builtin, sort_ints) {
-    DataConstant* locals = (DataConstant[]) {createInt(9), createInt(-5), createInt(0), createInt(0)};
+    DataConstant array = createTestArray(4, 4, (DataConstant[4]) {createInt(9), createInt(-5), createInt(0), createInt(0)});
     DataConstant* expected = (DataConstant[]) {createInt(-5), createInt(0), createInt(0), createInt(9)};
-    cr_expect_not(arraysEqual(expected, locals, 4));
-    DataConstant array = createAddr(locals, 0, 4, 4);
+    cr_expect_not(arraysEqual(expected, getArrayStart(array), 4));
     sort(array);
-    cr_expect(arraysEqual(expected, locals, 4));
+    cr_expect(arraysEqual(expected, getArrayStart(array), 4));
 }
 
 Test(impl_builtin, sort_doubles) {
-    DataConstant* locals = (DataConstant[]) {createDouble(0.9), createDouble(-0.0001), createDouble(-0.000099), createDouble(0.00001)};
+    DataConstant array = createTestArray(4, 4, (DataConstant[4]) {createDouble(0.9), createDouble(-0.0001), createDouble(-0.000099), createDouble(0.00001)});
     DataConstant* expected = (DataConstant[]) {createDouble(-0.0001), createDouble(-0.000099), createDouble(0.00001), createDouble(0.9)};
-    cr_expect_not(arraysEqual(expected, locals, 4));
-    DataConstant array = createAddr(locals, 0, 4, 4);
+    cr_expect_not(arraysEqual(expected, getArrayStart(array), 4));
     sort(array);
-    cr_expect(arraysEqual(expected, locals, 4));
+    cr_expect(arraysEqual(expected, getArrayStart(array), 4));
 }
 
 Test(impl_builtin, removeByIndex_valid) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createInt(2), createInt(0), createInt(-1)};
-    DataConstant array = createAddr(locals, 0, 3, 3);
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(2), createInt(0), createInt(-1)});
     removeByIndex(&array, 0, &vmState);
-    cr_expect_eq(array.length, 2);
-    cr_expect_eq(array.size, 3);
-    cr_expect_eq(locals[0].value.intVal, 0);
-    cr_expect_eq(locals[1].value.intVal, -1);
-    cr_expect_eq(locals[2].type, None);
+    cr_expect_eq(getArrayHeader(array)->length, 2);
+    cr_expect_eq(getArrayHeader(array)->capacity, 3);
+    cr_expect_eq(asInt(getArrayStart(array)[0]), 0);
+    cr_expect_eq(asInt(getArrayStart(array)[1]), -1);
+    cr_expect_eq(valueType(getArrayStart(array)[2]), None);
 }
 
 Test(impl_builtin, removeByIndex_invalid, .init = cr_redirect_stderr) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createInt(2), createInt(0), createInt(-1)};
-    DataConstant array = createAddr(locals, 0, 3, 3);
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(2), createInt(0), createInt(-1)});
     removeByIndex(&array, 4, &vmState);
     cr_expect_stderr_eq_str("Array index out of bounds\n");
     cr_expect_eq(vmState, memory_err);
 }
 
+Test(impl_builtin, removeAllValues) {
+    DataConstant array = createTestArray(6, 5, (DataConstant[5]) {createInt(1), createInt(2), createInt(1), createInt(1), createInt(3)});
+    removeAllValues(array, createInt(1));
+    cr_expect_eq(getArrayHeader(array)->length, 2);
+    cr_expect_eq(getArrayHeader(array)->capacity, 6);
+    cr_expect_eq(asInt(getArrayStart(array)[0]), 2);
+    cr_expect_eq(asInt(getArrayStart(array)[1]), 3);
+    for (int i = 2; i < 6; i++) {
+        cr_expect_eq(valueType(getArrayStart(array)[i]), None);
+    }
+}
+
 Test(impl_builtin, append_valid) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createBoolean(false), createNone()};
-    DataConstant array = createAddr(locals, 0, 2, 1);
+    DataConstant array = createTestArray(2, 1, (DataConstant[1]) {createBoolean(false)});
     append(&array, createBoolean(true), &vmState);
-    cr_expect_eq(array.size, 2);
-    cr_expect_eq(array.length, 2);
-    cr_expect_eq(locals[1].type, Bool);
-    cr_expect_eq(locals[1].value.boolVal, true);
+    cr_expect_eq(getArrayHeader(array)->capacity, 2);
+    cr_expect_eq(getArrayHeader(array)->length, 2);
+    cr_expect_eq(valueType(getArrayStart(array)[1]), Bool);
+    cr_expect_eq(asBool(getArrayStart(array)[1]), true);
 }
 
 Test(impl_builtin, append_full, .init = cr_redirect_stderr) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createBoolean(false)};
-    DataConstant array = createAddr(locals, 0, 1, 1);
+    DataConstant array = createTestArray(1, 1, (DataConstant[1]) {createBoolean(false)});
     append(&array, createBoolean(true), &vmState);
     cr_expect_stderr_eq_str("Array size limit 1 reached. Cannot insert into array.\n");
     cr_expect_eq(vmState, memory_err);
@@ -1045,19 +649,17 @@ Test(impl_builtin, append_full, .init = cr_redirect_stderr) {
 
 Test(impl_builtin, prepend_valid) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createBoolean(false), createNone()};
-    DataConstant array = createAddr(locals, 0, 2, 1);
+    DataConstant array = createTestArray(2, 1, (DataConstant[1]) {createBoolean(false)});
     prepend(&array, createBoolean(true), &vmState);
-    cr_expect_eq(array.size, 2);
-    cr_expect_eq(array.length, 2);
-    cr_expect_eq(locals[0].type, Bool);
-    cr_expect_eq(locals[0].value.boolVal, true);
+    cr_expect_eq(getArrayHeader(array)->capacity, 2);
+    cr_expect_eq(getArrayHeader(array)->length, 2);
+    cr_expect_eq(valueType(getArrayStart(array)[0]), Bool);
+    cr_expect_eq(asBool(getArrayStart(array)[0]), true);
 }
 
 Test(impl_builtin, prepend_full, .init = cr_redirect_stderr) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createBoolean(false)};
-    DataConstant array = createAddr(locals, 0, 1, 1);
+    DataConstant array = createTestArray(1, 1, (DataConstant[1]) {createBoolean(false)});
     prepend(&array, createBoolean(true), &vmState);
     cr_expect_stderr_eq_str("Array size limit 1 reached. Cannot insert into array.\n");
     cr_expect_eq(vmState, memory_err);
@@ -1065,19 +667,17 @@ Test(impl_builtin, prepend_full, .init = cr_redirect_stderr) {
 
 Test(impl_builtin, insert_valid) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createBoolean(false), createBoolean(false), createNone()};
-    DataConstant array = createAddr(locals, 0, 3, 2);
+    DataConstant array = createTestArray(3, 2, (DataConstant[2]) {createBoolean(false), createBoolean(false)});
     insert(&array, createBoolean(true), 1, &vmState);
-    cr_expect_eq(array.size, 3);
-    cr_expect_eq(array.length, 3);
-    cr_expect_eq(locals[1].type, Bool);
-    cr_expect_eq(locals[1].value.boolVal, true);
+    cr_expect_eq(getArrayHeader(array)->capacity, 3);
+    cr_expect_eq(getArrayHeader(array)->length, 3);
+    cr_expect_eq(valueType(getArrayStart(array)[1]), Bool);
+    cr_expect_eq(asBool(getArrayStart(array)[1]), true);
 }
 
 Test(impl_builtin, insert_out_of_range, .init = cr_redirect_stderr) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createBoolean(false), createBoolean(false), createNone()};
-    DataConstant array = createAddr(locals, 0, 3, 2);
+    DataConstant array = createTestArray(3, 2, (DataConstant[2]) {createBoolean(false), createBoolean(false)});
     insert(&array, createBoolean(true), 3, &vmState);
     cr_expect_stderr_eq_str("Array index 3 out of range 2\n");
     cr_expect_eq(vmState, memory_err);
@@ -1086,8 +686,7 @@ Test(impl_builtin, insert_out_of_range, .init = cr_redirect_stderr) {
 
 Test(impl_builtin, insert_full, .init = cr_redirect_stderr) {
     ExitCode vmState = success;
-    DataConstant* locals = (DataConstant[]) {createBoolean(false)};
-    DataConstant array = createAddr(locals, 0, 1, 1);
+    DataConstant array = createTestArray(1, 1, (DataConstant[1]) {createBoolean(false)});
     insert(&array, createBoolean(true), 0, &vmState);
     cr_expect_stderr_eq_str("Array size limit 1 reached. Cannot insert into array.\n");
     cr_expect_eq(vmState, memory_err);
@@ -0,0 +1,190 @@
+#include <criterion/criterion.h>
+#include <criterion/redirect.h>
+
+#include "utils.h"
+#include "../src/loader.h"
+#include "../src/builtin.h"
+
+TestSuite(Loader);
+
+Test(Loader, decode_operands) {
+    StringVector* body = split("LOAD_CONST 5 STORE LOAD 0 STORE 0 BUILDARR 3 2 CALL add 2 HALT", " ");
+    Instruction* bytecode = decode(body, NULL, 0);
+
+    cr_expect_eq(bytecode[0].opcode, LOAD_CONST);
+    cr_expect_eq(bytecode[0].width, 2);
+    cr_expect_eq(bytecode[0].operands[0], 1);
+    cr_expect_eq(bytecode[2].opcode, STORE);
+    cr_expect_eq(bytecode[2].width, 1);
+    cr_expect_eq(bytecode[2].operands[0], NO_OPERAND);
+    cr_expect_eq(bytecode[3].opcode, LOAD);
+    cr_expect_eq(bytecode[3].operands[0], 0);
+    cr_expect_eq(bytecode[5].opcode, STORE);
+    cr_expect_eq(bytecode[5].width, 2);
+    cr_expect_eq(bytecode[5].operands[0], 0);
+    cr_expect_eq(bytecode[7].opcode, BUILDARR);
+    cr_expect_eq(bytecode[7].width, 3);
+    cr_expect_eq(bytecode[7].operands[0], 3);
+    cr_expect_eq(bytecode[7].operands[1], 2);
+    cr_expect_eq(bytecode[10].opcode, CALL);
+    cr_expect_eq(bytecode[10].operands[0], 2);
+    cr_expect_eq(bytecode[10].operands[1], 11);
+    cr_expect_eq(bytecode[13].opcode, HALT);
+    cr_expect_eq(bytecode[14].opcode, UNKNOWN);
+    cr_expect_eq(bytecode[14].operands[0], NO_OPERAND);
+
+    free(bytecode);
+    freeStringVector(body);
+}
+
+Test(Loader, decode_unknownOpcode) {
+    StringVector* body = split("LOAD_CONST 1 asdf HALT", " ");
+    Instruction* bytecode = decode(body, NULL, 0);
+
+    cr_expect_eq(bytecode[2].opcode, UNKNOWN);
+    cr_expect_eq(bytecode[2].operands[0], 2);
+
+    free(bytecode);
+    freeStringVector(body);
+}
+
+Test(Loader, decode_jumps) {
+    StringVector* body = split("LOAD_CONST true JMPT .end JMP .missing HALT LOAD_CONST 1 EJMPF POP EJMP", " ");
+    JumpPoint jumps[1] = {{".end", 7, 11}};
+    Instruction* bytecode = decode(body, jumps, 1);
+
+    cr_expect_eq(bytecode[2].opcode, JMPT);
+    cr_expect_eq(bytecode[2].operands[0], 7);
+    cr_expect_eq(bytecode[2].operands[2], 0);
+    cr_expect_eq(bytecode[4].opcode, JMP);
+    cr_expect_eq(bytecode[4].operands[0], NO_OPERAND);
+    cr_expect_eq(bytecode[4].operands[1], 5);
+    cr_expect_eq(bytecode[7].block, 0);
+    cr_expect_eq(bytecode[2].block, NO_OPERAND);
+    cr_expect_eq(bytecode[9].opcode, EJMPF);
+    cr_expect_eq(bytecode[9].operands[0], 12);
+
+    free(bytecode);
+    freeStringVector(body);
+}
+
+Test(Loader, linkSourceCode) {
+    char* labels[3] = {"add", "sub", "_entry"};
+    char* bodies[3] = {
+        "LOAD 0 LOAD 1 ADD RET",
+        "LOAD 0 LOAD 1 SUB RET",
+        "LOAD_CONST 1 LOAD_CONST 2 CALL sub 2 CALL println 1 CALL asdf 0 HALT"
+    };
+    int jumpCounts[3] = {0, 0, 0};
+    JumpPoint* jumps[3] = {(JumpPoint[]) {}, (JumpPoint[]) {}, (JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 3);
+    loadSourceCode(src);
+    Instruction* bytecode = src->code[2].bytecode;
+
+    cr_expect_eq(bytecode[4].opcode, CALL);
+    cr_expect_eq(bytecode[4].operands[2], 1);
+    cr_expect_eq(bytecode[7].opcode, CALL_BUILTIN);
+    cr_expect_eq(bytecode[7].operands[2], getBuiltinId("println"));
+    cr_expect_eq(bytecode[10].opcode, CALL);
+    cr_expect_eq(bytecode[10].operands[2], NO_OPERAND);
+
+    cr_free(src);
+}
+
+Test(Loader, lookupFunction) {
+    char* labels[3] = {"add", "sub", "_entry"};
+    char* bodies[3] = {"RET", "RET", "HALT"};
+    int jumpCounts[3] = {0, 0, 0};
+    JumpPoint* jumps[3] = {(JumpPoint[]) {}, (JumpPoint[]) {}, (JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 3);
+    SymbolTable* table = createSymbolTable(src);
+
+    cr_expect_eq(lookupFunction(table, src, "add"), 0);
+    cr_expect_eq(lookupFunction(table, src, "sub"), 1);
+    cr_expect_eq(lookupFunction(table, src, "_entry"), 2);
+    cr_expect_eq(lookupFunction(table, src, "asdf"), -1);
+
+    deleteSymbolTable(table);
+    cr_free(src);
+}
+
+Test(Loader, linkSourceCode_builtinArity, .init = cr_redirect_stderr) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {"LOAD_CONST 1 LOAD_CONST 2 CALL println 2 CALL split 3 HALT"};
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    cr_expect_not(loadSourceCode(src));
+    cr_expect_stderr_eq_str(
+        "Error: builtin function 'println' expects 1 arguments but received 2\n"
+        "Error: builtin function 'split' expects 1 to 2 arguments but received 3\n"
+    );
+
+    cr_free(src);
+}
+
+Test(Loader, buildConstantPool) {
+    StringVector* body = split("LOAD_CONST 1 LOAD_CONST -2.5 LOAD_CONST true LOAD_CONST \"HI\" LOAD_CONST NULL LOAD_CONST NONE POP HALT", " ");
+    Instruction* bytecode = decode(body, NULL, 0);
+    int constCnt;
+    DataConstant* constants = buildConstantPool(body, bytecode, &constCnt);
+
+    cr_expect_eq(constCnt, 6);
+    for (int i = 0; i < constCnt; i++) {
+        cr_expect_eq(bytecode[i * 2].operands[0], i);
+    }
+    cr_expect(isEqual(constants[0], createInt(1)));
+    cr_expect(isEqual(constants[1], createDouble(-2.5)));
+    cr_expect(isEqual(constants[2], createBoolean(true)));
+    cr_expect_str_eq(asString(constants[3]), "HI");
+    cr_expect_eq(valueType(constants[4]), Null);
+    cr_expect_eq(valueType(constants[5]), None);
+
+    free(constants);
+    free(bytecode);
+    freeStringVector(body);
+}
+
+Test(Loader, fuseSuperinstructions) {
+    StringVector* body = split("LOAD 0 LOAD_CONST 1 ADD STORE 0 LOAD 0 LOAD_CONST 10 LT EJMPF LOAD 1 LOAD 0 AGET HALT", " ");
+    Instruction* bytecode = decode(body, NULL, 0);
+    int constCnt;
+    DataConstant* constants = buildConstantPool(body, bytecode, &constCnt);
+    fuseSuperinstructions(body, bytecode);
+
+    cr_expect_eq(bytecode[0].opcode, INC_LOCAL);
+    cr_expect_eq(bytecode[0].width, 7);
+    cr_expect_eq(bytecode[0].operands[0], 0);
+    cr_expect(isEqual(constants[bytecode[0].operands[1]], createInt(1)));
+    cr_expect_eq(bytecode[7].opcode, CMP_LOCAL_CONST_EJMPF);
+    cr_expect_eq(bytecode[7].width, 6);
+    cr_expect(isEqual(constants[bytecode[7].operands[1]], createInt(10)));
+    cr_expect_eq(bytecode[7].operands[2], LT);
+    cr_expect_eq(bytecode[12].opcode, EJMPF);
+    cr_expect_eq(bytecode[13].opcode, LOAD_AGET);
+    cr_expect_eq(bytecode[13].width, 5);
+    cr_expect_eq(bytecode[13].operands[0], 1);
+    cr_expect_eq(bytecode[13].operands[1], 0);
+    cr_expect_eq(bytecode[18].opcode, HALT);
+
+    free(constants);
+    free(bytecode);
+    freeStringVector(body);
+}
+
+Test(Loader, fuseSuperinstructions_jumpPoint) {
+    StringVector* body = split("LOAD 0 LOAD_CONST 1 ADD STORE 0 HALT", " ");
+    JumpPoint jumps[1] = {{".inc", 4, 6}};
+    Instruction* bytecode = decode(body, jumps, 1);
+    int constCnt;
+    DataConstant* constants = buildConstantPool(body, bytecode, &constCnt);
+    fuseSuperinstructions(body, bytecode);
+
+    cr_expect_eq(bytecode[0].opcode, LOAD);
+    cr_expect_eq(bytecode[0].width, 2);
+
+    free(constants);
+    free(bytecode);
+    freeStringVector(body);
+}
\ No newline at end of file
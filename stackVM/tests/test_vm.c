@@ -80,7 +80,7 @@ Test(VM, runJumpPointNotFound, .init = cr_redirect_stderr) {
     testRuntimeError( "JMP .next HALT", "Error: Could not find jump point '.next'\n", unknown_bytecode, false);
 }
 
-Test(VM, checkAndRetrieveArrayValuesTarget_normal) {
+Test(VM, allocateArray_normal) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
         "HALT"
@@ -89,20 +89,26 @@ Test(VM, checkAndRetrieveArrayValuesTarget_normal) {
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    bool globalsExpanded = false;
     VM* vm = init(src, getDefaultConfig());
-    Frame* frame = loadFrame(createStringVector(), jumps[0], 0, 320, 320, 0, 0, NULL);
 
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, 9, &globalsExpanded, false);
-    Frame* changedFrame = arrayTarget.frame;
+    DataConstant array = allocateArray(vm, 9);
 
-    cr_expect_eq(arrayTarget.target, frame->locals);
-    cr_expect_eq(*arrayTarget.targetp, frame->lp);
-    cr_expect_not(changedFrame->expandedLocals);
-    cr_expect_not(globalsExpanded);
+    cr_expect_eq(valueType(array), Addr);
+    cr_expect_eq(getArrayHeader(array)->capacity, 9);
+    cr_expect_eq(getArrayHeader(array)->length, 0);
+    cr_expect_eq(getArrayHeader(array)->elementType, None);
+    cr_expect_eq(valueType(getArrayStart(array)[8]), None);
+    cr_expect_eq(vm->arrays, getArrayHeader(array));
+    cr_expect_eq(vm->heapBytes, sizeof(ArrayHeader) + sizeof(ArrayStorage) + BASE_BYTES * 9);
+    cr_expect_eq(vm->gp, -1);
+    cr_expect_eq(vm->callStack[0]->lp, -1);
+    cr_expect_eq(vm->state, success);
+
+    destroy(vm);
+    cr_free(src);
 }
 
-Test(VM, checkAndRetrieveArrayValuesTarget_expandLocals) {
+Test(VM, allocateArray_heapError, .init = cr_redirect_stderr) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
         "HALT"
@@ -111,23 +117,24 @@ Test(VM, checkAndRetrieveArrayValuesTarget_expandLocals) {
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    bool globalsExpanded = false;
     VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 10;
-    conf.localsHardMax = BASE_BYTES * 20;
+    conf.dynamicResourceExpansionEnabled = false;
+    conf.globalsHardMax = BASE_BYTES * 5;
     VM* vm = init(src, conf);
-    Frame* frame = loadFrame(createStringVector(), jumps[0], 0, 320, conf.localsSoftMax, 0, 0, NULL);
 
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, 10, &globalsExpanded, false);
-    Frame* changedFrame = arrayTarget.frame;
+    DataConstant array = allocateArray(vm, 4);
+
+    cr_expect_eq(valueType(array), None);
+    cr_expect_null(vm->arrays);
+    cr_expect_eq(vm->heapBytes, 0);
+    cr_expect_eq(vm->state, memory_err);
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 5\n");
 
-    cr_expect_eq(arrayTarget.target, frame->locals);
-    cr_expect_eq(*arrayTarget.targetp, frame->lp);
-    cr_expect(changedFrame->expandedLocals);
-    cr_expect_not(globalsExpanded);
+    destroy(vm);
+    cr_free(src);
 }
 
-Test(VM, checkAndRetrieveArrayValuesTarget_useGlobals) {
+Test(VM, allocateArray_sharesGlobalsBudget, .init = cr_redirect_stderr) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
         "HALT"
@@ -136,23 +143,28 @@ Test(VM, checkAndRetrieveArrayValuesTarget_useGlobals) {
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    bool globalsExpanded = false;
     VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 10;
-    conf.localsHardMax = BASE_BYTES * 10;
+    conf.dynamicResourceExpansionEnabled = false;
+    conf.globalsHardMax = BASE_BYTES * 10;
     VM* vm = init(src, conf);
-    Frame* frame = loadFrame(createStringVector(), jumps[0], 0, 320, conf.localsSoftMax, 0, 0, NULL);
 
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, 12, &globalsExpanded, false);
-    Frame* changedFrame = arrayTarget.frame;
+    DataConstant array = allocateArray(vm, 2);
+    cr_expect_eq(valueType(array), Addr);
+    cr_expect_eq(vm->state, success);
+
+    vm->gp = 1; // two global variables leave no room for another array
+    vm->globals[0] = array;
+    vm->globals[1] = createInt(0);
+    array = allocateArray(vm, 1);
+    cr_expect_eq(valueType(array), None);
+    cr_expect_eq(vm->state, memory_err);
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 10\n");
 
-    cr_expect_eq(arrayTarget.target, vm->globals);
-    cr_expect_eq(*arrayTarget.targetp, vm->gp);
-    cr_expect_not(changedFrame->expandedLocals);
-    cr_expect_not(globalsExpanded);
+    destroy(vm);
+    cr_free(src);
 }
 
-Test(VM, checkAndRetrieveArrayValuesTarget_expandGlobals) {
+Test(VM, allocateArray_collectsUnreachableArrays) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
         "HALT"
@@ -161,25 +173,26 @@ Test(VM, checkAndRetrieveArrayValuesTarget_expandGlobals) {
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    bool globalsExpanded = false;
     VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 5;
-    conf.localsHardMax = BASE_BYTES * 5;
-    conf.globalsSoftMax = BASE_BYTES * 10;
-    //displayVMConfig(conf);
+    conf.dynamicResourceExpansionEnabled = false;
+    conf.globalsHardMax = BASE_BYTES * 10;
     VM* vm = init(src, conf);
-    Frame* frame = loadFrame(createStringVector(), jumps[0], 0, 320, conf.localsSoftMax, 0, 0, NULL);
 
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, 15, &globalsExpanded, false);
-    Frame* changedFrame = arrayTarget.frame;
+    DataConstant first = allocateArray(vm, 2);
+    cr_expect_eq(valueType(first), Addr);
+
+    DataConstant second = allocateArray(vm, 2); // nothing refers to the first array any more
+    cr_expect_eq(valueType(second), Addr);
+    cr_expect_eq(vm->state, success);
+    cr_expect_eq(vm->arrays, getArrayHeader(second));
+    cr_expect_null(vm->arrays->next);
+    cr_expect_eq(vm->heapBytes, sizeof(ArrayHeader) + sizeof(ArrayStorage) + 2 * sizeof(DataConstant));
 
-    cr_expect_eq(arrayTarget.target, vm->globals);
-    cr_expect_eq(*arrayTarget.targetp, vm->gp);
-    cr_expect_not(changedFrame->expandedLocals);
-    cr_expect(globalsExpanded);
+    destroy(vm);
+    cr_free(src);
 }
 
-Test(VM, checkAndRetrieveArrayValuesTarget_localsError, .init = cr_redirect_stderr) {
+Test(VM, copyArray) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
         "HALT"
@@ -188,30 +201,49 @@ Test(VM, checkAndRetrieveArrayValuesTarget_localsError, .init = cr_redirect_stde
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    bool globalsExpanded = false;
-    VMConfig conf = getDefaultConfig();
-    conf.useHeapStorageBackup = false;
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 20;
-    //displayVMConfig(conf);
-    VM* vm = init(src, conf);
-    Frame* frame = loadFrame(createStringVector(), jumps[0], 0, 320, conf.localsHardMax, 0, 0, NULL);
+    VM* vm = init(src, getDefaultConfig());
 
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, 21, &globalsExpanded, false);
-    Frame* changedFrame = arrayTarget.frame;
+    DataConstant array = createTestArray(2, 2, (DataConstant[2]) {createInt(1), createInt(5)});
+    DataConstant copy = copyArray(vm, array, 0, 2, 4);
 
-    cr_expect_eq(arrayTarget.target, frame->locals);
-    cr_expect_eq(*arrayTarget.targetp, frame->lp);
-    cr_expect_not(changedFrame->expandedLocals);
-    cr_expect_not(globalsExpanded);
-    cr_expect_eq(vm->state, memory_err);
+    cr_expect_eq(valueType(copy), Addr);
+    cr_expect_neq(asAddress(copy), asAddress(array));
+    cr_expect_eq(getArrayHeader(copy)->capacity, 4);
+    cr_expect_eq(getArrayHeader(copy)->length, 2);
+    cr_expect_eq(getArrayHeader(copy)->elementType, Int);
+    cr_expect(isEqual(getArrayStart(copy)[0], createInt(1)));
+    cr_expect(isEqual(getArrayStart(copy)[1], createInt(5)));
+    cr_expect_eq(valueType(getArrayStart(copy)[2]), None);
+    cr_expect_eq(valueType(getArrayStart(copy)[3]), None);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, copyArray_partial) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    VM* vm = init(src, getDefaultConfig());
 
-    //logStderr(cr_get_redirected_stderr());
+    DataConstant array = createTestArray(3, 3, (DataConstant[3]) {createInt(1), createInt(5), createInt(7)});
+    DataConstant copy = copyArray(vm, array, 1, 1, 3);
 
-    cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 20\n");
+    cr_expect_eq(getArrayHeader(copy)->capacity, 3);
+    cr_expect_eq(getArrayHeader(copy)->length, 1);
+    cr_expect(isEqual(getArrayStart(copy)[0], createInt(5)));
+    cr_expect_eq(valueType(getArrayStart(copy)[1]), None);
+
+    destroy(vm);
+    cr_free(src);
 }
 
-Test(VM, checkAndRetrieveArrayValuesTarget_globalsError, .init = cr_redirect_stderr) {
+Test(VM, copyArray_nested) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
         "HALT"
@@ -220,24 +252,23 @@ Test(VM, checkAndRetrieveArrayValuesTarget_globalsError, .init = cr_redirect_std
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    bool globalsExpanded = false;
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 20;
-    conf.globalsHardMax = BASE_BYTES * 100;
-    VM* vm = init(src, conf);
-    Frame* frame = loadFrame(createStringVector(), jumps[0], 0, 320, conf.localsHardMax, 0, 0, NULL);
+    VM* vm = init(src, getDefaultConfig());
 
-    ArrayTarget arrayTarget = checkAndRetrieveArrayValuesTarget(vm, frame, 101, &globalsExpanded, false);
-    Frame* changedFrame = arrayTarget.frame;
+    DataConstant inner = createTestArray(1, 1, (DataConstant[1]) {createInt(7)});
+    DataConstant outer = createTestArray(2, 2, (DataConstant[2]) {inner, inner});
+    DataConstant copy = copyArray(vm, outer, 0, 2, 2);
 
-    cr_expect_eq(arrayTarget.target, vm->globals);
-    cr_expect_eq(*arrayTarget.targetp, vm->gp);
-    cr_expect_not(changedFrame->expandedLocals);
-    cr_expect_not(globalsExpanded);
-    cr_expect_eq(vm->state, memory_err);
+    DataConstant* elements = getArrayStart(copy);
+    cr_expect_eq(valueType(elements[0]), Addr);
+    cr_expect_eq(valueType(elements[1]), Addr);
+    cr_expect_neq(asAddress(elements[0]), asAddress(inner));
+    cr_expect_neq(asAddress(elements[1]), asAddress(inner));
+    cr_expect(isEqual(getArrayStart(elements[0])[0], createInt(7)));
+    cr_expect(isEqual(getArrayStart(elements[1])[0], createInt(7)));
+    cr_expect_eq(getArrayStart(elements[0]), getArrayStart(inner)); // the copies of the innermost array share its storage
 
-    cr_expect_stderr_eq_str("HeapOverflow: Exceeded local storage maximum of 20 and global storage maximum of 100\n");
+    destroy(vm);
+    cr_free(src);
 }
 
 Test(VM, runPop) {
@@ -293,8 +324,8 @@ Test(VM, runLoadBasicConsts) {
     cr_expect(isEqual(frame->stack[2], createBoolean(false)));
     cr_expect(isEqual(frame->stack[3], createString("HI")));
     cr_expect(isEqual(frame->stack[4], createNull()));
-    cr_expect_eq(frame->stack[5].type, None);
-    cr_expect_not(frame->expandedStack);
+    cr_expect_eq(valueType(frame->stack[5]), None);
+    cr_expect_eq(frame->stackCapacity, vm->stackSoftMax);
 
     destroy(vm);
     cr_free(src);
@@ -329,8 +360,84 @@ Test(VM, runLoadBasicConsts_expandStack) {
     cr_expect(isEqual(frame->stack[2], createBoolean(false)));
     cr_expect(isEqual(frame->stack[3], createString("HI")));
     cr_expect(isEqual(frame->stack[4], createNull()));
-    cr_expect_eq(frame->stack[5].type, None);
-    cr_expect(frame->expandedStack);
+    cr_expect_eq(valueType(frame->stack[5]), None);
+    cr_expect_eq(frame->stackCapacity, 8); // doubled twice from the soft max of 2
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, init_outOfMemory, .init = cr_redirect_stderr) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    VMConfig conf = getDefaultConfig();
+    conf.localsSoftMax = 1L << 62; // no allocator hands out a data stack this large
+    conf.localsHardMax = 1L << 62;
+    cr_expect_null(init(src, conf));
+    char message[128];
+    sprintf(message, "Error: Could not allocate a data stack of %ld values\n", (long) ((1L << 62) / sizeof(DataConstant) + conf.stackSizeSoftMax / sizeof(DataConstant) + 1));
+    cr_expect_stderr_eq_str(message);
+    cr_free(src);
+}
+
+Test(VM, reserveValues_outOfMemory, .init = cr_redirect_stderr) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    VM* vm = init(src, getDefaultConfig());
+    DataConstant* values = vm->values;
+    long capacity = vm->valuesCapacity;
+    cr_expect_not(reserveValues(vm, 1L << 58)); // no allocator hands out 4 EiB
+    cr_expect_eq(vm->state, memory_err);
+    cr_expect_eq(vm->values, values);
+    cr_expect_eq(vm->valuesCapacity, capacity);
+    cr_expect_eq(vm->callStack[0]->stack, values);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, releaseValues_hysteresis) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    VM* vm = init(src, getDefaultConfig());
+    long minimum = vm->valuesMinimum;
+    cr_expect_eq(vm->valuesCapacity, minimum);
+
+    reserveValues(vm, minimum * 6);
+    cr_expect_eq(vm->valuesCapacity, minimum * 8);
+    Frame* frame = vm->callStack[0];
+    cr_expect_eq(frame->stack, vm->values); // the entry frame moved along with the data stack
+
+    frame->stackCapacity = minimum * 2; // the frame still uses a quarter of the data stack
+    releaseValues(vm);
+    cr_expect_eq(vm->valuesCapacity, minimum * 8);
+
+    frame->stackCapacity = vm->stackSoftMax;
+    releaseValues(vm);
+    cr_expect_eq(vm->valuesCapacity, minimum * 4);
+    releaseValues(vm);
+    releaseValues(vm);
+    releaseValues(vm);
+    cr_expect_eq(vm->valuesCapacity, minimum);
+    cr_expect_eq(frame->stack, vm->values);
 
     destroy(vm);
     cr_free(src);
@@ -366,7 +473,7 @@ Test(VM, runLoadBasicConsts_stackError, .init = cr_redirect_stderr) {
     cr_expect(isEqual(frame->stack[2], createBoolean(false)));
     //cr_expect(isEqual(frame->stack[3], createString("HI")));
     //cr_expect(isEqual(frame->stack[4], createNull()));
-    cr_expect_not(frame->expandedStack);
+    cr_expect_eq(frame->stackCapacity, vm->stackSoftMax);
 
     cr_expect_stderr_eq_str("StackOverflow: Exceeded stack space of 4\n");
 
@@ -402,6 +509,91 @@ Test(VM, runStringOps) {
     cr_free(src);
 }
 
+Test(VM, runStringOps_rope) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "LOAD_CONST \"abcdefghij\" REPEATSTR 4 DUP CONCAT LOAD_CONST \"!\" CONCAT DUP DUP EQ HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    VM* vm = init(src, getDefaultConfig());
+    bool verbose = false;
+    if (verbose)
+        displayCode(src);
+    ExitCode status = run(vm, verbose);
+
+    cr_expect_eq(status, success);
+    Frame* frame = vm->callStack[0];
+    cr_expect_eq(frame->sp, 1);
+    cr_expect(isEqual(frame->stack[1], createBoolean(true)));
+
+    // both concatenations are long enough to only record their parts
+    cr_expect_eq(valueType(frame->stack[0]), Rope);
+    RopeNode* rope = getRope(frame->stack[0]);
+    cr_expect_eq(rope, vm->ropes);
+    cr_expect_eq(rope->length, 81);
+    cr_expect_not_null(rope->next);
+    cr_expect_null(rope->next->next);
+    cr_expect_eq(rope->next->length, 80);
+
+    // EQ read the rope, which keeps the characters for later reads and lets go of its parts
+    cr_expect_not_null(rope->flat);
+    cr_expect_eq(valueType(rope->left), None);
+    cr_expect_eq(valueType(rope->right), None);
+    DataConstant string = flattenString(vm, frame->stack[0]);
+    cr_expect_eq(valueType(string), Str);
+    cr_expect_eq(asString(string), rope->flat);
+    cr_expect_str_eq(asString(string), "abcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghijabcdefghij!");
+    cr_expect_null(rope->next->flat);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, runStringOps_view) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "LOAD_CONST 5 LOAD_CONST 0 LOAD_CONST \"hello world\" CALL _slice_s 3 DUP LOAD_CONST \"hello\" EQ "
+        "LOAD_CONST \"r\" LOAD_CONST 3 LOAD_CONST 1 LOAD_CONST 11 LOAD_CONST 6 LOAD_CONST \"hello world\" CALL _slice_s 3 CALL _slice_s 3 CALL _contains_s 2 HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    VM* vm = init(src, getDefaultConfig());
+    ExitCode status = run(vm, false);
+
+    cr_expect_eq(status, success);
+    Frame* frame = vm->callStack[0];
+    cr_expect_eq(frame->sp, 2);
+    cr_expect(isEqual(frame->stack[1], createBoolean(true)));
+    cr_expect(isEqual(frame->stack[2], createBoolean(true)));
+
+    // _contains_s needs a NUL terminated string, so only "or" was copied
+    ViewNode* view = vm->views;
+    cr_expect_str_eq(view->flat, "or");
+    cr_expect_eq(view->start, view->flat);
+    cr_expect_null(view->parent);
+    cr_expect_eq(vm->stringCount, 1);
+
+    // slicing a view borrows from its parent, and EQ reads views in place
+    view = view->next;
+    cr_expect_eq(view->length, 5);
+    cr_expect_eq(view->start, view->parent + 6);
+    cr_expect_null(view->flat);
+    view = view->next;
+    cr_expect_eq(valueType(frame->stack[0]), View);
+    cr_expect_eq(getView(frame->stack[0]), view);
+    cr_expect_eq(view->start, view->parent);
+    cr_expect_null(view->flat);
+    cr_expect_null(view->next);
+
+    destroy(vm);
+    cr_free(src);
+}
+
 typedef struct {
     char* operator;
     bool result;
@@ -440,8 +632,8 @@ ParameterizedTest(DataCompare* comparisons, VM, runDUPAndCompare) {
     cr_expect_eq(frame->pc, 5);
     cr_expect_eq(frame->sp, 0);
 
-    cr_expect_eq(frame->stack[0].type, Bool);
-    cr_expect_eq(frame->stack[0].value.boolVal, comparisons->result);
+    cr_expect_eq(valueType(frame->stack[0]), Bool);
+    cr_expect_eq(asBool(frame->stack[0]), comparisons->result);
 
     destroy(vm);
     cr_free(src);
@@ -521,8 +713,8 @@ ParameterizedTest(BooleanOperation* operation, VM, runBinaryBooleanOperations) {
     cr_expect_eq(frame->pc, 6);
     cr_expect_eq(frame->sp, 0);
 
-    cr_expect_eq(frame->stack[0].type, Bool);
-    cr_expect_eq(frame->stack[0].value.boolVal, operation->result);
+    cr_expect_eq(valueType(frame->stack[0]), Bool);
+    cr_expect_eq(asBool(frame->stack[0]), operation->result);
 
     destroy(vm);
     cr_free(src);
@@ -575,8 +767,8 @@ ParameterizedTest(BitwiseOperation* operation, VM, runBinaryBitwiseOperations) {
     cr_expect_eq(frame->pc, 6);
     cr_expect_eq(frame->sp, 0);
 
-    cr_expect_eq(frame->stack[0].type, Int);
-    cr_expect_eq(frame->stack[0].value.intVal, operation->result);
+    cr_expect_eq(valueType(frame->stack[0]), Int);
+    cr_expect_eq(asInt(frame->stack[0]), operation->result);
 
     destroy(vm);
     cr_free(src);
@@ -610,7 +802,7 @@ Test(VM, runLoadAndStore) {
     cr_expect(isEqual(frame->locals[0], createBoolean(false)));
     cr_expect(isEqual(vm->globals[0], createInt(2)));
 
-    cr_expect_not(frame->expandedLocals);
+    cr_expect(frame->localsCapacity <= vm->localsSoftMax);
 
     destroy(vm);
     cr_free(src);
@@ -647,7 +839,7 @@ Test(VM, runLoadAndStore_expandLocalsAndGlobals) {
     cr_expect(isEqual(frame->locals[0], createBoolean(false)));
     cr_expect(isEqual(vm->globals[0], createInt(2)));
 
-    cr_expect(frame->expandedLocals);
+    cr_expect(frame->localsCapacity > vm->localsSoftMax); // the locals window grew past the soft max
 
     destroy(vm);
     cr_free(src);
@@ -682,7 +874,7 @@ Test(VM, runLoadAndStore_localsError, .init = cr_redirect_stderr) {
 
     cr_expect(isEqual(frame->locals[0], createBoolean(false)));
 
-    cr_expect_not(frame->expandedLocals);
+    cr_expect(frame->localsCapacity <= vm->localsSoftMax);
 
     cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 1\n");
 
@@ -690,6 +882,37 @@ Test(VM, runLoadAndStore_localsError, .init = cr_redirect_stderr) {
     cr_free(src);
 }
 
+Test(VM, runLoadAndStore_growGlobals) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "LOAD_CONST 1 GSTORE LOAD_CONST 2 GSTORE LOAD_CONST 3 GSTORE LOAD_CONST 4 GSTORE LOAD_CONST 5 GSTORE HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    VMConfig conf = getDefaultConfig();
+    conf.globalsSoftMax = BASE_BYTES;
+    VM* vm = init(src, conf);
+    DataConstant* globals = vm->globals;
+    cr_expect_eq(vm->globalsReserved, conf.globalsHardMax);
+    bool verbose = false;
+    if (verbose)
+        displayCode(src);
+    ExitCode status = run(vm, verbose);
+
+    cr_expect_eq(status, success);
+    cr_expect_eq(vm->gp, 4);
+    cr_expect_eq(vm->globalsCapacity, 8); // doubled from the soft max instead of jumping to the 512M hard max
+    cr_expect_eq(vm->globals, globals); // growing inside the reservation never moves the globals
+    for (int i = 0; i < 5; i++) {
+        cr_expect(isEqual(vm->globals[i], createInt(i + 1)));
+    }
+
+    destroy(vm);
+    cr_free(src);
+}
+
 Test(VM, runLoadAndStore_globalsError, .init = cr_redirect_stderr) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
@@ -719,7 +942,7 @@ Test(VM, runLoadAndStore_globalsError, .init = cr_redirect_stderr) {
 
     cr_expect(isEqual(vm->globals[0], createBoolean(false)));
 
-    cr_expect_not(frame->expandedLocals);
+    cr_expect(frame->localsCapacity <= vm->localsSoftMax);
 
     cr_expect_stderr_eq_str("HeapOverflow: Global storage hard maximum of 1 reached\n");
 
@@ -948,8 +1171,118 @@ Test(VM, runWithFunctionCall_addWithReturn) {
     cr_expect_eq(frame->pc, 8);
     cr_expect_eq(frame->sp, 0);
     cr_expect_eq(frame->lp, -1);
-    cr_expect_eq(frame->stack[0].type, Dbl);
-    cr_expect_eq(frame->stack[0].value.dblVal, 3.718);
+    cr_expect_eq(valueType(frame->stack[0]), Dbl);
+    cr_expect_eq(asDouble(frame->stack[0]), 3.718);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, runWithFunctionCall_reusesFrames) {
+    char* labels[3] = {"double", "add", "_entry"};
+    char* bodies[3] = {
+        "LOAD 0 LOAD 0 CALL add 2 RET",
+        "LOAD 0 LOAD 1 ADD RET",
+        "LOAD_CONST 1 LOAD_CONST 2 CALL add 2 CALL double 1 LOAD_CONST 4 CALL add 2 HALT"
+    };
+    int jumpCounts[3] = {0, 0, 0};
+    JumpPoint* jumps[3] = {(JumpPoint[]) {}, (JumpPoint[]) {}, (JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 3);
+
+    VM* vm = init(src, getDefaultConfig());
+    bool verbose = false;
+    if (verbose)
+        displayCode(src);
+    ExitCode status = run(vm, verbose);
+
+    cr_expect_eq(status, success);
+    cr_expect_eq(vm->fp, 0);
+    cr_expect_eq(vm->frameCount, 3); // four calls, but never more than three frames at once
+    Frame* frame = vm->callStack[0];
+    cr_expect_eq(frame->sp, 0);
+    cr_expect(isEqual(frame->stack[0], createInt(10)));
+    frame = vm->callStack[1]; // last used by the final call to add
+    cr_expect_eq(frame->instructions, src->code[1].body);
+    cr_expect_eq(frame->lp, 1);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, runWithFunctionCall_growLocals) {
+    char* labels[2] = {"spill", "_entry"};
+    char* bodies[2] = {
+        "LOAD_CONST 100 LOAD 0 STORE LOAD 0 STORE LOAD 0 STORE LOAD 0 STORE LOAD 0 STORE LOAD 0 STORE LOAD 0 STORE LOAD 0 STORE LOAD 0 STORE LOAD 1 ADD RET",
+        "LOAD_CONST 1 LOAD_CONST 2 CALL spill 2 LOAD_CONST 3 LOAD_CONST 4 CALL spill 2 HALT"
+    };
+    int jumpCounts[2] = {0, 0};
+    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
+
+    VM* vm = init(src, getDefaultConfig());
+    bool verbose = false;
+    if (verbose)
+        displayCode(src);
+    ExitCode status = run(vm, verbose);
+
+    cr_expect_eq(status, success);
+    Frame* frame = vm->callStack[0];
+    cr_expect_eq(frame->sp, 1);
+    cr_expect(isEqual(frame->stack[0], createInt(101)));
+    cr_expect(isEqual(frame->stack[1], createInt(103)));
+    frame = vm->callStack[1];
+    cr_expect_eq(frame->locals, vm->values + 1); // the arguments became the callee's locals where the caller pushed them
+    cr_expect_eq(frame->lp, 10);
+    cr_expect_eq(frame->localsCapacity, 16); // the second call starts with the window the first one grew to
+    cr_expect_eq(vm->localsHints[0], 16);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, releaseLocalsHint_hysteresis) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+
+    VM* vm = init(src, getDefaultConfig());
+    Frame* frame = vm->callStack[0];
+    vm->localsHints[0] = 64; // left behind by one deep call
+    frame->lp = 15; // the call used a quarter of the hint
+    releaseLocalsHint(vm, frame);
+    cr_expect_eq(vm->localsHints[0], 64);
+
+    frame->lp = 1;
+    releaseLocalsHint(vm, frame);
+    cr_expect_eq(vm->localsHints[0], 32);
+    releaseLocalsHint(vm, frame);
+    releaseLocalsHint(vm, frame);
+    cr_expect_eq(vm->localsHints[0], 8);
+    releaseLocalsHint(vm, frame);
+    cr_expect_eq(vm->localsHints[0], 8); // never below the first window growLocals makes
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, runWithFunctionCall_localsHintKeptWhenUsed) {
+    char* labels[2] = {"deep", "_entry"};
+    char* bodies[2] = {
+        "LOAD_CONST 1 STORE LOAD_CONST 2 STORE LOAD_CONST 3 STORE LOAD_CONST 4 STORE LOAD_CONST 5 STORE LOAD_CONST 6 STORE LOAD_CONST 7 STORE LOAD_CONST 8 STORE LOAD_CONST 9 STORE RET",
+        "CALL deep 0 HALT"
+    };
+    int jumpCounts[2] = {0, 0};
+    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
+
+    VM* vm = init(src, getDefaultConfig());
+    ExitCode status = run(vm, false);
+    cr_expect_eq(status, success);
+    cr_expect_eq(vm->localsHints[0], 16); // nine locals grew the window past 8 and used more than a quarter of it
 
     destroy(vm);
     cr_free(src);
@@ -982,10 +1315,10 @@ Test(VM, runWithFunctionCall_framesError, .init = cr_redirect_stderr) {
     cr_expect_eq(frame->pc, 9);
     cr_expect_eq(frame->sp, 0);
     cr_expect_eq(frame->lp, 1);
-    cr_expect_eq(frame->stack[0].type, Dbl);
-    cr_expect_eq(frame->stack[0].value.dblVal, 3.718);
-    cr_expect_eq(frame->stack[1].type, Dbl);
-    cr_expect_eq(frame->stack[1].value.dblVal, 3.718);
+    cr_expect_eq(valueType(frame->stack[0]), Dbl);
+    cr_expect_eq(asDouble(frame->stack[0]), 3.718);
+    cr_expect_eq(valueType(frame->stack[1]), Dbl);
+    cr_expect_eq(asDouble(frame->stack[1]), 3.718);
 
     cr_expect_stderr_eq_str("StackOverflow: Number of frames exceeded frame hard maximum of 2\n");
 
@@ -1015,62 +1348,52 @@ Test(VM, runWithFunctionCall_arrayReturn) {
     cr_expect_eq(frame->instructions->length, 7);
     cr_expect_eq(frame->pc, 7);
     cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(frame->lp, 2);
+    cr_expect_eq(frame->lp, 0);
 
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].value.address, frame->locals);
-    cr_expect_eq(frame->stack[0].offset, 1);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[0].length, 2);
+    cr_expect_eq(valueType(frame->stack[0]), Addr);
+    cr_expect_eq(getArrayHeader(frame->stack[0]), vm->arrays);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->capacity, 2);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->length, 2);
     
-    cr_expect_eq(frame->locals[1].value.intVal, 1);
-    cr_expect_eq(frame->locals[2].value.intVal, 2);
+    cr_expect_eq(asInt(getArrayStart(frame->stack[0])[0]), 1);
+    cr_expect_eq(asInt(getArrayStart(frame->stack[0])[1]), 2);
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runWithFunctionCall_arrayReturn_expandLocals) {
-    char* labels[2] = {"test", "_entry"};
+Test(VM, runWithFunctionCall_arrayReturnFromLocals) {
+    char* labels[2] = {"build", "_entry"};
     char* bodies[2] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 RET",
-        "LOAD_CONST true STORE CALL test 0 HALT"
+        "LOAD_CONST 3 LOAD_CONST 2 LOAD_CONST 1 BUILDARR 4 3 STORE LOAD_CONST 4 LOAD 0 CALL append 2 LOAD 0 RET",
+        "CALL build 0 HALT"
     };
     int jumpCounts[2] = {0, 0};
     JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
 
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES;
-    VM* vm = init(src, conf);
+    VM* vm = init(src, getDefaultConfig());
     bool verbose = false;
     if (verbose)
         displayCode(src);
     ExitCode status = run(vm, verbose);
 
     cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 7);
-    cr_expect_eq(frame->pc, 7);
     cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(frame->lp, 2);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].value.address, frame->locals);
-    cr_expect_eq(frame->stack[0].offset, 1);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect(frame->expandedLocals);
-
-    cr_expect_eq(frame->locals[1].value.intVal, 1);
-    cr_expect_eq(frame->locals[2].value.intVal, 2);
+    cr_expect_eq(valueType(frame->stack[0]), Addr);
+    // the caller receives the callee's array itself, returning it copies nothing
+    cr_expect_eq(getArrayHeader(frame->stack[0]), vm->arrays);
+    cr_expect_null(vm->arrays->next);
+    cr_expect_eq(vm->heapBytes, sizeof(ArrayHeader) + sizeof(ArrayStorage) + 4 * sizeof(DataConstant));
+    cr_expect_eq(getArrayHeader(frame->stack[0])->length, 4);
+    cr_expect_eq(asInt(getArrayStart(frame->stack[0])[3]), 4);
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runWithFunctionCall_arrayReturn_useGlobals) {
+Test(VM, runWithFunctionCall_arrayReturn_heapError, .init = cr_redirect_stderr) {
     char* labels[2] = {"test", "_entry"};
     char* bodies[2] = {
         "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 RET",
@@ -1082,145 +1405,22 @@ Test(VM, runWithFunctionCall_arrayReturn_useGlobals) {
 
     VMConfig conf = getDefaultConfig();
     conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 2;
+    conf.globalsHardMax = BASE_BYTES * 3;
     VM* vm = init(src, conf);
     bool verbose = false;
     if (verbose)
         displayCode(src);
     ExitCode status = run(vm, verbose);
 
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 7);
+    cr_expect_eq(status, memory_err);
+    cr_expect_eq(vm->fp, 1);
+    Frame* frame = vm->callStack[1];
     cr_expect_eq(frame->pc, 7);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_eq(vm->gp, 1);
+    cr_expect_eq(frame->sp, 1);
+    cr_expect_eq(vm->gp, -1);
+    cr_expect_null(vm->arrays);
 
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].value.address, vm->globals);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect_not(frame->expandedLocals);
-
-    cr_expect_eq(vm->globals[0].value.intVal, 1);
-    cr_expect_eq(vm->globals[1].value.intVal, 2);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, runWithFunctionCall_arrayReturn_expandGlobals) {
-    char* labels[2] = {"test", "_entry"};
-    char* bodies[2] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 RET",
-        "LOAD_CONST true STORE CALL test 0 HALT"
-    };
-    int jumpCounts[2] = {0, 0};
-    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
-
-    VMConfig conf = getDefaultConfig();
-    conf.localsHardMax = BASE_BYTES * 2;
-    conf.globalsSoftMax = BASE_BYTES * 2;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 7);
-    cr_expect_eq(frame->pc, 7);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_eq(vm->gp, 1);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].value.address, vm->globals);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect_not(frame->expandedLocals);
-
-    cr_expect_eq(vm->globals[0].value.intVal, 1);
-    cr_expect_eq(vm->globals[1].value.intVal, 2);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, runWithFunctionCall_arrayReturn_localsError, .init = cr_redirect_stderr) {
-    char* labels[2] = {"test", "_entry"};
-    char* bodies[2] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 RET",
-        "LOAD_CONST true STORE CALL test 0 HALT"
-    };
-    int jumpCounts[2] = {0, 0};
-    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
-
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.useHeapStorageBackup = false;
-    conf.localsHardMax = BASE_BYTES * 2;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, memory_err);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 7);
-    cr_expect_eq(frame->pc, 6);
-    cr_expect_eq(frame->sp, -1);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_eq(vm->gp, -1);
-
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 2\n");
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, runWithFunctionCall_arrayReturn_globalsError, .init = cr_redirect_stderr) {
-    char* labels[2] = {"test", "_entry"};
-    char* bodies[2] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 RET",
-        "LOAD_CONST true STORE CALL test 0 HALT"
-    };
-    int jumpCounts[2] = {0, 0};
-    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
-
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 2;
-    conf.globalsHardMax = BASE_BYTES;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, memory_err);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 7);
-    cr_expect_eq(frame->pc, 6);
-    cr_expect_eq(frame->sp, -1);
-    cr_expect_eq(frame->lp, 0);
-    cr_expect_eq(vm->gp, -1);
-
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_stderr_eq_str("HeapOverflow: Exceeded local storage maximum of 2 and global storage maximum of 1\n");
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 3\n");
 
     destroy(vm);
     cr_free(src);
@@ -1233,465 +1433,10 @@ Test(VM, runWithFunctionCall_nestedArrayReturn) {
         "LOAD_CONST true STORE CALL test 0 HALT"
     };
     int jumpCounts[2] = {0, 0};
-    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
-
-    VM* vm = init(src, getDefaultConfig());
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 7);
-    cr_expect_eq(frame->pc, 7);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(frame->lp, 4);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].value.address, frame->locals);
-    cr_expect_eq(frame->stack[0].offset, 3);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[0].length, 1);
-
-    cr_expect_eq(frame->locals[1].value.intVal, 1);
-    cr_expect_eq(frame->locals[2].value.intVal, 2);
-    cr_expect_eq(frame->locals[3].type, Addr);
-    cr_expect_eq(frame->locals[3].value.address, frame->locals);
-    cr_expect_eq(frame->locals[3].offset, 1);
-    cr_expect_eq(frame->locals[3].size, 2);
-    cr_expect_eq(frame->locals[3].length, 2);
-    cr_expect_eq(frame->locals[4].type, None);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, runUknownFunction, .init = cr_redirect_stderr) {
-    testRuntimeError("CALL asdf 0 HALT", "Error: could not find function 'asdf'\n", unknown_bytecode, false);
-}
-
-Test(VM, runArrayGet) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 5 2 LOAD_CONST 1 AGET HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VM* vm = init(src, getDefaultConfig());
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 11);
-    cr_expect_eq(frame->pc, 11);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 4);
-
-    cr_expect(isEqual(frame->stack[0], createInt(2)));
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    for (int i = 2; i < 5; i++) {
-        cr_expect_eq(frame->locals[i].type, None);
-    }
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, buildArrayOneParam) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 BUILDARR 0 HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VM* vm = init(src, getDefaultConfig());
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 5);
-    cr_expect_eq(frame->pc, 5);
-    cr_expect_eq(frame->sp, 1);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 1);
-
-    cr_expect(isEqual(frame->stack[0], createInt(2)));
-    cr_expect_eq(frame->stack[1].type, Addr);
-    cr_expect_eq(frame->stack[1].length, 0);
-    cr_expect_eq(frame->stack[1].size, 2);
-    cr_expect_eq(frame->stack[1].offset, 0);
-    cr_expect_eq(frame->locals[0].type, None);
-    cr_expect_eq(frame->locals[1].type, None);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, buildArray_expandLocals) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 BUILDARR 3 1 HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 2;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 6);
-    cr_expect_eq(frame->pc, 6);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 2);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].length, 1);
-    cr_expect_eq(frame->stack[0].size, 3);
-    cr_expect_eq(frame->stack[0].value.address, frame->locals);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->locals[0].value.intVal, 2);
-    cr_expect_eq(frame->locals[1].type, None);
-    cr_expect_eq(frame->locals[2].type, None);
-
-    cr_expect(frame->expandedLocals);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, buildArray_useGlobals) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 BUILDARR 3 1 HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 6);
-    cr_expect_eq(frame->pc, 6);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, 2);
-    cr_expect_eq(frame->lp, -1);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].length, 1);
-    cr_expect_eq(frame->stack[0].size, 3);
-    cr_expect_eq(frame->stack[0].value.address, vm->globals);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(vm->globals[0].value.intVal, 2);
-    cr_expect_eq(vm->globals[1].type, None);
-    cr_expect_eq(vm->globals[2].type, None);
-
-    cr_expect_not(frame->expandedLocals);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, buildArray_expandGlobals) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 BUILDARR 3 1 HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES;
-    conf.globalsSoftMax = BASE_BYTES;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 6);
-    cr_expect_eq(frame->pc, 6);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, 2);
-    cr_expect_eq(frame->lp, -1);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].length, 1);
-    cr_expect_eq(frame->stack[0].size, 3);
-    cr_expect_eq(frame->stack[0].value.address, vm->globals);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(vm->globals[0].value.intVal, 2);
-    cr_expect_eq(vm->globals[1].type, None);
-    cr_expect_eq(vm->globals[2].type, None);
-
-    cr_expect_not(frame->expandedLocals);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, buildArray_localsError, .init = cr_redirect_stderr) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 BUILDARR 3 1 HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.useHeapStorageBackup = false;
-    conf.localsHardMax = BASE_BYTES * 2;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, memory_err);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 6);
-    cr_expect_eq(frame->pc, 5);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, -1);
-
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 2\n");
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, buildArray_globalsError, .init = cr_redirect_stderr) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 BUILDARR 3 1 HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES;
-    conf.globalsHardMax = BASE_BYTES;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, memory_err);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 6);
-    cr_expect_eq(frame->pc, 5);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, -1);
-
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_stderr_eq_str("HeapOverflow: Exceeded local storage maximum of 1 and global storage maximum of 1\n");
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, runArrayWrite) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 5 2 STORE LOAD_CONST 0 LOAD 5 LOAD_CONST 1 ASTORE STORE 5 LOAD_CONST 4 LOAD 5 LOAD_CONST 2 ASTORE STORE 5 HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VM* vm = init(src, getDefaultConfig());
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 27);
-
-    cr_expect_eq(frame->pc, 27);
-    cr_expect_eq(frame->sp, -1);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 5);
-
-    cr_expect_eq(frame->locals[5].type, Addr);
-    cr_expect_eq(frame->locals[5].value.address, frame->locals);
-    cr_expect_eq(frame->locals[5].offset, 0);
-    cr_expect_eq(frame->locals[5].length, 3);
-    cr_expect_eq(frame->locals[5].size, 5);
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(0)));
-    cr_expect(isEqual(frame->locals[2], createInt(4)));
-    for (int i = 3; i < 5; i++) {
-        cr_expect_eq(frame->locals[i].type, None);
-    }
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, runArrayConcat) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 3 2 LOAD_CONST 1 LOAD_CONST 0 BUILDARR 2 2 CONCAT HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VM* vm = init(src, getDefaultConfig());
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 16);
-
-    cr_expect_eq(frame->pc, 16);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 9);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].length, 4);
-    cr_expect_eq(frame->stack[0].size, 5);
-    cr_expect_eq(frame->stack[0].offset, 5);
-    cr_expect_eq(frame->stack[0].value.address, frame->locals);
-
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect_eq(frame->locals[2].type, None);
-    cr_expect(isEqual(frame->locals[3], createInt(0)));
-    cr_expect(isEqual(frame->locals[4], createInt(1)));
-
-    cr_expect(isEqual(frame->locals[5], createInt(1)));
-    cr_expect(isEqual(frame->locals[6], createInt(2)));
-    cr_expect(isEqual(frame->locals[7], createInt(0)));
-    cr_expect(isEqual(frame->locals[8], createInt(1)));
-    cr_expect_eq(frame->locals[9].type, None);
-    cr_expect_not(frame->expandedLocals);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, runArrayConcat_expandLocals) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 3 2 LOAD_CONST 1 LOAD_CONST 0 BUILDARR 2 2 CONCAT HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
-
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 8;
-    VM* vm = init(src, conf);
-    bool verbose = false;
-    if (verbose)
-        displayCode(src);
-    ExitCode status = run(vm, verbose);
-
-    cr_expect_eq(status, success);
-    cr_expect_eq(vm->fp, 0);
-    Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 16);
-
-    cr_expect_eq(frame->pc, 16);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 9);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].length, 4);
-    cr_expect_eq(frame->stack[0].size, 5);
-    cr_expect_eq(frame->stack[0].offset, 5);
-    cr_expect_eq(frame->stack[0].value.address, frame->locals);
-
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect_eq(frame->locals[2].type, None);
-    cr_expect(isEqual(frame->locals[3], createInt(0)));
-    cr_expect(isEqual(frame->locals[4], createInt(1)));
-
-    cr_expect(isEqual(frame->locals[5], createInt(1)));
-    cr_expect(isEqual(frame->locals[6], createInt(2)));
-    cr_expect(isEqual(frame->locals[7], createInt(0)));
-    cr_expect(isEqual(frame->locals[8], createInt(1)));
-    cr_expect_eq(frame->locals[9].type, None);
-    cr_expect(frame->expandedLocals);
-
-    destroy(vm);
-    cr_free(src);
-}
-
-Test(VM, runArrayConcat_useGlobals) {
-    char* labels[1] = {"_entry"};
-    char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 3 2 LOAD_CONST 1 LOAD_CONST 0 BUILDARR 2 2 CONCAT HALT"
-    };
-    int jumpCounts[1] = {0};
-    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
-    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
 
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 8;
-    VM* vm = init(src, conf);
+    VM* vm = init(src, getDefaultConfig());
     bool verbose = false;
     if (verbose)
         displayCode(src);
@@ -1700,50 +1445,41 @@ Test(VM, runArrayConcat_useGlobals) {
     cr_expect_eq(status, success);
     cr_expect_eq(vm->fp, 0);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 16);
-
-    cr_expect_eq(frame->pc, 16);
+    cr_expect_eq(frame->instructions->length, 7);
+    cr_expect_eq(frame->pc, 7);
     cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, 4);
-    cr_expect_eq(frame->lp, 4);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].length, 4);
-    cr_expect_eq(frame->stack[0].size, 5);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].value.address, vm->globals);
-
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect_eq(frame->locals[2].type, None);
-    cr_expect(isEqual(frame->locals[3], createInt(0)));
-    cr_expect(isEqual(frame->locals[4], createInt(1)));
-
-    cr_expect(isEqual(vm->globals[0], createInt(1)));
-    cr_expect(isEqual(vm->globals[1], createInt(2)));
-    cr_expect(isEqual(vm->globals[2], createInt(0)));
-    cr_expect(isEqual(vm->globals[3], createInt(1)));
-    cr_expect_eq(vm->globals[4].type, None);
-    cr_expect_not(frame->expandedLocals);
+    cr_expect_eq(frame->lp, 0);
+
+    cr_expect_eq(valueType(frame->stack[0]), Addr);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->capacity, 2);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->length, 1);
+
+    DataConstant inner = getArrayStart(frame->stack[0])[0];
+    cr_expect_eq(valueType(inner), Addr);
+    cr_expect_eq(getArrayHeader(inner)->capacity, 2);
+    cr_expect_eq(getArrayHeader(inner)->length, 2);
+    cr_expect_eq(valueType(getArrayStart(frame->stack[0])[1]), None);
+    cr_expect_eq(asInt(getArrayStart(inner)[0]), 1);
+    cr_expect_eq(asInt(getArrayStart(inner)[1]), 2);
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayConcat_expandGlobals) {
+Test(VM, runUknownFunction, .init = cr_redirect_stderr) {
+    testRuntimeError("CALL asdf 0 HALT", "Error: could not find function 'asdf'\n", unknown_bytecode, false);
+}
+
+Test(VM, runArrayGet) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 3 2 LOAD_CONST 1 LOAD_CONST 0 BUILDARR 2 2 CONCAT HALT"
+        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 5 2 LOAD_CONST 1 AGET HALT"
     };
     int jumpCounts[1] = {0};
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 8;
-    conf.localsHardMax = BASE_BYTES * 8;
-    conf.globalsSoftMax = BASE_BYTES * 2;
-    VM* vm = init(src, conf);
+    VM* vm = init(src, getDefaultConfig());
     bool verbose = false;
     if (verbose)
         displayCode(src);
@@ -1752,76 +1488,65 @@ Test(VM, runArrayConcat_expandGlobals) {
     cr_expect_eq(status, success);
     cr_expect_eq(vm->fp, 0);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 16);
-
-    cr_expect_eq(frame->pc, 16);
+    cr_expect_eq(frame->instructions->length, 11);
+    cr_expect_eq(frame->pc, 11);
     cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, 4);
-    cr_expect_eq(frame->lp, 4);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].length, 4);
-    cr_expect_eq(frame->stack[0].size, 5);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].value.address, vm->globals);
-
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect_eq(frame->locals[2].type, None);
-    cr_expect(isEqual(frame->locals[3], createInt(0)));
-    cr_expect(isEqual(frame->locals[4], createInt(1)));
-
-    cr_expect(isEqual(vm->globals[0], createInt(1)));
-    cr_expect(isEqual(vm->globals[1], createInt(2)));
-    cr_expect(isEqual(vm->globals[2], createInt(0)));
-    cr_expect(isEqual(vm->globals[3], createInt(1)));
-    cr_expect_eq(vm->globals[4].type, None);
-    cr_expect_not(frame->expandedLocals);
+    cr_expect_eq(vm->gp, -1);
+    cr_expect_eq(frame->lp, -1);
+
+    cr_expect(isEqual(frame->stack[0], createInt(2)));
+    cr_expect_not_null(vm->arrays);
+    cr_expect_eq(vm->arrays->capacity, 5);
+    cr_expect(isEqual(vm->arrays->storage->values[0], createInt(1)));
+    cr_expect(isEqual(vm->arrays->storage->values[1], createInt(2)));
+    for (int i = 2; i < 5; i++) {
+        cr_expect_eq(valueType(vm->arrays->storage->values[i]), None);
+    }
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayConcat_localsError, .init = cr_redirect_stderr) {
+Test(VM, buildArrayOneParam) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 3 2 LOAD_CONST 1 LOAD_CONST 0 BUILDARR 2 2 CONCAT HALT"
+        "LOAD_CONST 2 BUILDARR 0 HALT"
     };
     int jumpCounts[1] = {0};
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.useHeapStorageBackup = false;
-    conf.localsHardMax = BASE_BYTES * 8;
-    VM* vm = init(src, conf);
+    VM* vm = init(src, getDefaultConfig());
     bool verbose = false;
     if (verbose)
         displayCode(src);
     ExitCode status = run(vm, verbose);
 
-    cr_expect_eq(status, memory_err);
+    cr_expect_eq(status, success);
     cr_expect_eq(vm->fp, 0);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 16);
-
-    cr_expect_eq(frame->pc, 15);
-    cr_expect_eq(frame->sp, -1);
+    cr_expect_eq(frame->instructions->length, 5);
+    cr_expect_eq(frame->pc, 5);
+    cr_expect_eq(frame->sp, 1);
     cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 4);
+    cr_expect_eq(frame->lp, -1);
 
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 8\n");
+    cr_expect(isEqual(frame->stack[0], createInt(2)));
+    cr_expect_eq(valueType(frame->stack[1]), Addr);
+    cr_expect_eq(getArrayHeader(frame->stack[1])->length, 0);
+    cr_expect_eq(getArrayHeader(frame->stack[1])->capacity, 2);
+    cr_expect_eq(getArrayHeader(frame->stack[1]), vm->arrays);
+    cr_expect_eq(valueType(getArrayStart(frame->stack[1])[0]), None);
+    cr_expect_eq(valueType(getArrayStart(frame->stack[1])[1]), None);
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayConcat_globalsError, .init = cr_redirect_stderr) {
+Test(VM, buildArray_heapError, .init = cr_redirect_stderr) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 3 2 LOAD_CONST 1 LOAD_CONST 0 BUILDARR 2 2 CONCAT HALT"
+        "LOAD_CONST 2 BUILDARR 3 1 HALT"
     };
     int jumpCounts[1] = {0};
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
@@ -1829,8 +1554,7 @@ Test(VM, runArrayConcat_globalsError, .init = cr_redirect_stderr) {
 
     VMConfig conf = getDefaultConfig();
     conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 8;
-    conf.globalsHardMax = BASE_BYTES * 3;
+    conf.globalsHardMax = BASE_BYTES * 4;
     VM* vm = init(src, conf);
     bool verbose = false;
     if (verbose)
@@ -1840,24 +1564,23 @@ Test(VM, runArrayConcat_globalsError, .init = cr_redirect_stderr) {
     cr_expect_eq(status, memory_err);
     cr_expect_eq(vm->fp, 0);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 16);
-
-    cr_expect_eq(frame->pc, 15);
-    cr_expect_eq(frame->sp, -1);
+    cr_expect_eq(frame->instructions->length, 6);
+    cr_expect_eq(frame->pc, 5);
+    cr_expect_eq(frame->sp, 0);
     cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 4);
+    cr_expect_eq(frame->lp, -1);
+    cr_expect_null(vm->arrays);
 
-    cr_expect_not(frame->expandedLocals);
-    cr_expect_stderr_eq_str("HeapOverflow: Exceeded local storage maximum of 8 and global storage maximum of 3\n");
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 4\n");
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayCopy) {
+Test(VM, runArrayWrite) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 DUP COPYARR HALT"
+        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 5 2 STORE LOAD_CONST 0 LOAD 0 LOAD_CONST 1 ASTORE STORE 0 LOAD_CONST 4 LOAD 0 LOAD_CONST 2 ASTORE STORE 0 HALT"
     };
     int jumpCounts[1] = {0};
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
@@ -1872,43 +1595,39 @@ Test(VM, runArrayCopy) {
     cr_expect_eq(status, success);
     cr_expect_eq(vm->fp, 0);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 10);
+    cr_expect_eq(frame->instructions->length, 27);
 
-    cr_expect_eq(frame->pc, 10);
-    cr_expect_eq(frame->sp, 1);
+    cr_expect_eq(frame->pc, 27);
+    cr_expect_eq(frame->sp, -1);
     cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 3);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[1].type, Addr);
-    cr_expect_eq(frame->stack[1].offset, 2);
-    cr_expect_eq(frame->stack[1].length, 2);
-    cr_expect_eq(frame->stack[1].size, 2);
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect(isEqual(frame->locals[2], createInt(1)));
-    cr_expect(isEqual(frame->locals[3], createInt(2)));
-    cr_expect_not(frame->expandedLocals);
+    cr_expect_eq(frame->lp, 0);
+
+    cr_expect_eq(valueType(frame->locals[0]), Addr);
+    cr_expect_eq(getArrayHeader(frame->locals[0]), vm->arrays);
+    cr_expect_eq(getArrayHeader(frame->locals[0])->length, 3);
+    cr_expect_eq(getArrayHeader(frame->locals[0])->capacity, 5);
+    DataConstant* elements = getArrayStart(frame->locals[0]);
+    cr_expect(isEqual(elements[0], createInt(1)));
+    cr_expect(isEqual(elements[1], createInt(0)));
+    cr_expect(isEqual(elements[2], createInt(4)));
+    for (int i = 3; i < 5; i++) {
+        cr_expect_eq(valueType(elements[i]), None);
+    }
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayCopy_expandLocals) {
+Test(VM, runArrayConcat) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 DUP COPYARR HALT"
+        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 3 2 LOAD_CONST 1 LOAD_CONST 0 BUILDARR 2 2 CONCAT HALT"
     };
     int jumpCounts[1] = {0};
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    VMConfig conf = getDefaultConfig();
-    conf.localsSoftMax = BASE_BYTES * 3;
-    VM* vm = init(src, conf);
+    VM* vm = init(src, getDefaultConfig());
     bool verbose = false;
     if (verbose)
         displayCode(src);
@@ -1917,35 +1636,41 @@ Test(VM, runArrayCopy_expandLocals) {
     cr_expect_eq(status, success);
     cr_expect_eq(vm->fp, 0);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 10);
+    cr_expect_eq(frame->instructions->length, 16);
 
-    cr_expect_eq(frame->pc, 10);
-    cr_expect_eq(frame->sp, 1);
+    cr_expect_eq(frame->pc, 16);
+    cr_expect_eq(frame->sp, 0);
     cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 3);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[1].type, Addr);
-    cr_expect_eq(frame->stack[1].offset, 2);
-    cr_expect_eq(frame->stack[1].length, 2);
-    cr_expect_eq(frame->stack[1].size, 2);
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect(isEqual(frame->locals[2], createInt(1)));
-    cr_expect(isEqual(frame->locals[3], createInt(2)));
-    cr_expect(frame->expandedLocals);
+    cr_expect_eq(frame->lp, -1);
+
+    cr_expect_eq(valueType(frame->stack[0]), Addr);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->length, 4);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->capacity, 5);
+    cr_expect_eq(getArrayHeader(frame->stack[0]), vm->arrays);
+
+    ArrayHeader* rhs = vm->arrays->next;
+    ArrayHeader* lhs = rhs->next;
+    cr_expect(isEqual(lhs->storage->values[0], createInt(1)));
+    cr_expect(isEqual(lhs->storage->values[1], createInt(2)));
+    cr_expect_eq(valueType(lhs->storage->values[2]), None);
+    cr_expect(isEqual(rhs->storage->values[0], createInt(0)));
+    cr_expect(isEqual(rhs->storage->values[1], createInt(1)));
+
+    DataConstant* elements = getArrayStart(frame->stack[0]);
+    cr_expect(isEqual(elements[0], createInt(1)));
+    cr_expect(isEqual(elements[1], createInt(2)));
+    cr_expect(isEqual(elements[2], createInt(0)));
+    cr_expect(isEqual(elements[3], createInt(1)));
+    cr_expect_eq(valueType(elements[4]), None);
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayCopy_useGlobals) {
+Test(VM, runArrayConcat_heapError, .init = cr_redirect_stderr) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 DUP COPYARR HALT"
+        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 3 2 LOAD_CONST 1 LOAD_CONST 0 BUILDARR 2 2 CONCAT HALT"
     };
     int jumpCounts[1] = {0};
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
@@ -1953,42 +1678,30 @@ Test(VM, runArrayCopy_useGlobals) {
 
     VMConfig conf = getDefaultConfig();
     conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 3;
+    conf.globalsHardMax = BASE_BYTES * 20;
     VM* vm = init(src, conf);
     bool verbose = false;
     if (verbose)
         displayCode(src);
     ExitCode status = run(vm, verbose);
 
-    cr_expect_eq(status, success);
+    cr_expect_eq(status, memory_err);
     cr_expect_eq(vm->fp, 0);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 10);
+    cr_expect_eq(frame->instructions->length, 16);
 
-    cr_expect_eq(frame->pc, 10);
-    cr_expect_eq(frame->sp, 1);
-    cr_expect_eq(vm->gp, 1);
-    cr_expect_eq(frame->lp, 1);
+    cr_expect_eq(frame->pc, 15);
+    cr_expect_eq(frame->sp, -1);
+    cr_expect_eq(vm->gp, -1);
+    cr_expect_eq(frame->lp, -1);
 
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[1].type, Addr);
-    cr_expect_eq(frame->stack[1].offset, 0);
-    cr_expect_eq(frame->stack[1].length, 2);
-    cr_expect_eq(frame->stack[1].size, 2);
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect(isEqual(vm->globals[0], createInt(1)));
-    cr_expect(isEqual(vm->globals[1], createInt(2)));
-    cr_expect_not(frame->expandedLocals);
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 20\n");
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayCopy_expandGlobals) {
+Test(VM, runArrayCopy) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
         "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 DUP COPYARR HALT"
@@ -1997,11 +1710,7 @@ Test(VM, runArrayCopy_expandGlobals) {
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 3;
-    conf.globalsSoftMax = BASE_BYTES * 3;
-    VM* vm = init(src, conf);
+    VM* vm = init(src, getDefaultConfig());
     bool verbose = false;
     if (verbose)
         displayCode(src);
@@ -2014,71 +1723,64 @@ Test(VM, runArrayCopy_expandGlobals) {
 
     cr_expect_eq(frame->pc, 10);
     cr_expect_eq(frame->sp, 1);
-    cr_expect_eq(vm->gp, 1);
-    cr_expect_eq(frame->lp, 1);
+    cr_expect_eq(vm->gp, -1);
+    cr_expect_eq(frame->lp, -1);
 
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect_eq(frame->stack[1].type, Addr);
-    cr_expect_eq(frame->stack[1].offset, 0);
-    cr_expect_eq(frame->stack[1].length, 2);
-    cr_expect_eq(frame->stack[1].size, 2);
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect(isEqual(vm->globals[0], createInt(1)));
-    cr_expect(isEqual(vm->globals[1], createInt(2)));
-    cr_expect_not(frame->expandedLocals);
+    cr_expect_eq(valueType(frame->stack[0]), Addr);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->length, 2);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->capacity, 2);
+    cr_expect_eq(valueType(frame->stack[1]), Addr);
+    cr_expect_neq(asAddress(frame->stack[1]), asAddress(frame->stack[0]));
+    cr_expect_eq(getArrayHeader(frame->stack[1])->length, 2);
+    cr_expect_eq(getArrayHeader(frame->stack[1])->capacity, 2);
+    cr_expect(isEqual(getArrayStart(frame->stack[0])[0], createInt(1)));
+    cr_expect(isEqual(getArrayStart(frame->stack[0])[1], createInt(2)));
+    cr_expect(isEqual(getArrayStart(frame->stack[1])[0], createInt(1)));
+    cr_expect(isEqual(getArrayStart(frame->stack[1])[1], createInt(2)));
+    // nothing has been written yet, so the copy still shares the original's storage
+    cr_expect_eq(getArrayStart(frame->stack[1]), getArrayStart(frame->stack[0]));
+    cr_expect_eq(getArrayHeader(frame->stack[0])->storage->refs, 2);
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayCopy_localsError, .init = cr_redirect_stderr) {
+Test(VM, runArrayCopy_writeUnshares) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
-        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 DUP COPYARR HALT"
+        "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 DUP COPYARR STORE LOAD_CONST 9 LOAD 0 LOAD_CONST 0 ASTORE HALT"
     };
     int jumpCounts[1] = {0};
     JumpPoint* jumps[1] = {(JumpPoint[]) {}};
     SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
 
-    VMConfig conf = getDefaultConfig();
-    conf.dynamicResourceExpansionEnabled = false;
-    conf.useHeapStorageBackup = false;
-    conf.localsHardMax = BASE_BYTES * 3;
-    VM* vm = init(src, conf);
+    VM* vm = init(src, getDefaultConfig());
     bool verbose = false;
     if (verbose)
         displayCode(src);
     ExitCode status = run(vm, verbose);
 
-    cr_expect_eq(status, memory_err);
-    cr_expect_eq(vm->fp, 0);
+    cr_expect_eq(status, success);
     Frame* frame = vm->callStack[0];
-    cr_expect_eq(frame->instructions->length, 10);
-
-    cr_expect_eq(frame->pc, 9);
-    cr_expect_eq(frame->sp, 0);
-    cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 1);
-
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect_not(frame->expandedLocals);
-
-    cr_expect_stderr_eq_str("StackOverflow: Exceeded local storage maximum of 3\n");
+    cr_expect_eq(frame->sp, 1);
+    cr_expect_eq(asAddress(frame->stack[1]), asAddress(frame->locals[0]));
+
+    DataConstant original = frame->stack[0];
+    DataConstant copy = frame->stack[1];
+    cr_expect_neq(getArrayStart(copy), getArrayStart(original));
+    cr_expect_eq(getArrayHeader(original)->storage->refs, 1);
+    cr_expect_eq(getArrayHeader(copy)->storage->refs, 1);
+    cr_expect(isEqual(getArrayStart(original)[0], createInt(1)));
+    cr_expect(isEqual(getArrayStart(original)[1], createInt(2)));
+    cr_expect(isEqual(getArrayStart(copy)[0], createInt(9)));
+    cr_expect(isEqual(getArrayStart(copy)[1], createInt(2)));
+    cr_expect_eq(vm->heapBytes, 2 * (sizeof(ArrayHeader) + sizeof(ArrayStorage) + 2 * sizeof(DataConstant)));
 
     destroy(vm);
     cr_free(src);
 }
 
-Test(VM, runArrayCopy_globalsError, .init = cr_redirect_stderr) {
+Test(VM, runArrayCopy_heapError, .init = cr_redirect_stderr) {
     char* labels[1] = {"_entry"};
     char* bodies[1] = {
         "LOAD_CONST 2 LOAD_CONST 1 BUILDARR 2 2 DUP COPYARR HALT"
@@ -2089,8 +1791,7 @@ Test(VM, runArrayCopy_globalsError, .init = cr_redirect_stderr) {
 
     VMConfig conf = getDefaultConfig();
     conf.dynamicResourceExpansionEnabled = false;
-    conf.localsHardMax = BASE_BYTES * 3;
-    conf.globalsHardMax = BASE_BYTES * 1;
+    conf.globalsHardMax = BASE_BYTES * 10;
     VM* vm = init(src, conf);
     bool verbose = false;
     if (verbose)
@@ -2105,17 +1806,14 @@ Test(VM, runArrayCopy_globalsError, .init = cr_redirect_stderr) {
     cr_expect_eq(frame->pc, 9);
     cr_expect_eq(frame->sp, 0);
     cr_expect_eq(vm->gp, -1);
-    cr_expect_eq(frame->lp, 1);
+    cr_expect_eq(frame->lp, -1);
 
-    cr_expect_eq(frame->stack[0].type, Addr);
-    cr_expect_eq(frame->stack[0].offset, 0);
-    cr_expect_eq(frame->stack[0].length, 2);
-    cr_expect_eq(frame->stack[0].size, 2);
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect_not(frame->expandedLocals);
+    cr_expect_eq(valueType(frame->stack[0]), Addr);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->length, 2);
+    cr_expect_eq(getArrayHeader(frame->stack[0])->capacity, 2);
+    cr_expect_eq(getArrayHeader(frame->stack[0]), vm->arrays);
 
-    cr_expect_stderr_eq_str("HeapOverflow: Exceeded local storage maximum of 3 and global storage maximum of 1\n");
+    cr_expect_stderr_eq_str("HeapOverflow: Exceeded global storage maximum of 10\n");
 
     destroy(vm);
     cr_free(src);
@@ -2142,27 +1840,22 @@ Test(VM, runArrayGlobalStore) {
     cr_expect_eq(frame->instructions->length, 12);
     cr_expect_eq(frame->pc, 12);
     cr_expect_eq(frame->sp, -1);
-    cr_expect_eq(vm->gp, 6);
-    cr_expect_eq(frame->lp, 4);
+    cr_expect_eq(vm->gp, 1);
+    cr_expect_eq(frame->lp, -1);
 
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    for (int i = 2; i < 5; i++) {
-        cr_expect_eq(frame->locals[i].type, None);
-    }
+    cr_expect(isEqual(vm->globals[0], createDouble(3.14)));
+    cr_expect_eq(valueType(vm->globals[1]), Addr);
+    cr_expect_eq(getArrayHeader(vm->globals[1]), vm->arrays);
+    cr_expect_eq(getArrayHeader(vm->globals[1])->length, 2);
+    cr_expect_eq(getArrayHeader(vm->globals[1])->capacity, 5);
 
-    cr_expect(isEqual(vm->globals[1], createInt(1)));
-    cr_expect(isEqual(vm->globals[2], createInt(2)));
-    for (int i = 3; i < 6; i++) {
-        cr_expect_eq(vm->globals[i].type, None);
+    DataConstant* elements = getArrayStart(vm->globals[1]);
+    cr_expect(isEqual(elements[0], createInt(1)));
+    cr_expect(isEqual(elements[1], createInt(2)));
+    for (int i = 2; i < 5; i++) {
+        cr_expect_eq(valueType(elements[i]), None);
     }
 
-    cr_expect_eq(vm->globals[6].type, Addr);
-    cr_expect_eq(vm->globals[6].value.address, vm->globals);
-    cr_expect_eq(vm->globals[6].offset, 1);
-    cr_expect_eq(vm->globals[6].length, 2);
-    cr_expect_eq(vm->globals[6].size, 5);
-
     destroy(vm);
     cr_free(src);
 }
@@ -2188,63 +1881,28 @@ Test(VM, runArrayGlobalStoreNested) {
     cr_expect_eq(frame->instructions->length, 23);
     cr_expect_eq(frame->pc, 23);
     cr_expect_eq(frame->sp, -1);
-    cr_expect_eq(vm->gp, 11);
-    cr_expect_eq(frame->lp, 9);
-
-    // locals
-    cr_expect(isEqual(frame->locals[0], createInt(1)));
-    cr_expect(isEqual(frame->locals[1], createInt(2)));
-    cr_expect_eq(frame->locals[2].type, None);
-    cr_expect_eq(frame->locals[3].type, None);
-    cr_expect(isEqual(frame->locals[4], createInt(1)));
-    cr_expect_eq(frame->locals[5].type, None);
-
-    cr_expect_eq(frame->locals[6].type, Addr);
-    // NOTE: GSTORE will change the local address to a global one for each nested array, but we don't need those values anymore so it doesn't matter
-    // cr_expect_eq(frame->locals[6].value.address, vm->globals);
-    cr_expect_eq(frame->locals[6].offset, 1);
-    cr_expect_eq(frame->locals[6].size, 2);
-    cr_expect_eq(frame->locals[6].length, 1);
-    cr_expect_eq(frame->locals[7].type, Addr);
-    cr_expect_eq(frame->locals[7].offset, 3);
-    cr_expect_eq(frame->locals[7].size, 2);
-    cr_expect_eq(frame->locals[7].length, 0);
-    cr_expect_eq(frame->locals[8].type, Addr);
-    cr_expect_eq(frame->locals[8].offset, 5);
-    cr_expect_eq(frame->locals[8].size, 2);
-    cr_expect_eq(frame->locals[8].length, 2);
-    cr_expect_eq(frame->locals[9].type, None);
-
-    // globals
-    cr_expect(isEqual(vm->globals[1], createInt(1)));
-    cr_expect_eq(vm->globals[2].type, None);
-    cr_expect_eq(vm->globals[3].type, None);
-    cr_expect_eq(vm->globals[4].type, None);
-    cr_expect(isEqual(vm->globals[5], createInt(1)));
-    cr_expect(isEqual(vm->globals[6], createInt(2)));
-
-    cr_expect_eq(vm->globals[7].type, Addr);
-    cr_expect_eq(vm->globals[7].value.address, vm->globals);
-    cr_expect_eq(vm->globals[7].offset, 1);
-    cr_expect_eq(vm->globals[7].size, 2);
-    cr_expect_eq(vm->globals[7].length, 1);
-    cr_expect_eq(vm->globals[8].type, Addr);
-    cr_expect_eq(vm->globals[8].value.address, vm->globals);
-    cr_expect_eq(vm->globals[8].offset, 3);
-    cr_expect_eq(vm->globals[8].size, 2);
-    cr_expect_eq(vm->globals[8].length, 0);
-    cr_expect_eq(vm->globals[9].type, Addr);
-    cr_expect_eq(vm->globals[9].value.address, vm->globals);
-    cr_expect_eq(vm->globals[9].offset, 5);
-    cr_expect_eq(vm->globals[9].size, 2);
-    cr_expect_eq(vm->globals[9].length, 2);
-    cr_expect_eq(vm->globals[10].type, None);
-
-    cr_expect_eq(vm->globals[11].type, Addr);
-    cr_expect_eq(vm->globals[11].value.address, vm->globals);
-    cr_expect_eq(vm->globals[11].offset, 7);
-    cr_expect_eq(vm->globals[11].size, 4);
-    cr_expect_eq(vm->globals[11].length, 3);
+    cr_expect_eq(vm->gp, 1);
+    cr_expect_eq(frame->lp, -1);
+
+    cr_expect_eq(valueType(vm->globals[1]), Addr);
+    cr_expect_eq(getArrayHeader(vm->globals[1])->capacity, 4);
+    cr_expect_eq(getArrayHeader(vm->globals[1])->length, 3);
+
+    DataConstant* elements = getArrayStart(vm->globals[1]);
+    cr_expect_eq(valueType(elements[0]), Addr);
+    cr_expect_eq(getArrayHeader(elements[0])->capacity, 2);
+    cr_expect_eq(getArrayHeader(elements[0])->length, 1);
+    cr_expect(isEqual(getArrayStart(elements[0])[0], createInt(1)));
+    cr_expect_eq(valueType(getArrayStart(elements[0])[1]), None);
+    cr_expect_eq(valueType(elements[1]), Addr);
+    cr_expect_eq(getArrayHeader(elements[1])->capacity, 2);
+    cr_expect_eq(getArrayHeader(elements[1])->length, 0);
+    cr_expect_eq(valueType(elements[2]), Addr);
+    cr_expect_eq(getArrayHeader(elements[2])->capacity, 2);
+    cr_expect_eq(getArrayHeader(elements[2])->length, 2);
+    cr_expect(isEqual(getArrayStart(elements[2])[0], createInt(1)));
+    cr_expect(isEqual(getArrayStart(elements[2])[1], createInt(2)));
+    cr_expect_eq(valueType(elements[3]), None);
 
     destroy(vm);
     cr_free(src);
@@ -2268,6 +1926,69 @@ Test(VM, runArrayGetOutOfRange, .init = cr_redirect_stderr) {
     );
 }
 
+Test(VM, runArrayGetAtCapacity, .init = cr_redirect_stderr) {
+    testRuntimeError(
+        "LOAD_CONST 1 LOAD_CONST 2 BUILDARR 2 2 LOAD_CONST 2 AGET HALT",
+        "Error: Array index 2 out of range 2\n",
+        memory_err,
+        false
+    );
+}
+
+Test(VM, runArrayLoadGetAtCapacity, .init = cr_redirect_stderr) {
+    testRuntimeError(
+        "LOAD_CONST 1 LOAD_CONST 2 BUILDARR 2 2 STORE LOAD_CONST 2 STORE LOAD 0 LOAD 1 AGET HALT", // fused into LOAD_AGET
+        "Error: Array index 2 out of range 2\n",
+        memory_err,
+        false
+    );
+}
+
+Test(VM, runArrayGetNotArray, .init = cr_redirect_stderr) {
+    testRuntimeError(
+        "LOAD_CONST 5 LOAD_CONST 0 AGET HALT",
+        "Error: AGET expects an array operand\n",
+        operation_err,
+        false
+    );
+}
+
+Test(VM, runArrayStoreNotArray, .init = cr_redirect_stderr) {
+    testRuntimeError(
+        "LOAD_CONST 1 LOAD_CONST \"abc\" LOAD_CONST 0 ASTORE HALT",
+        "Error: ASTORE expects an array operand\n",
+        operation_err,
+        false
+    );
+}
+
+Test(VM, runArrayCopyNotArray, .init = cr_redirect_stderr) {
+    testRuntimeError(
+        "LOAD_CONST null COPYARR HALT",
+        "Error: COPYARR expects an array operand\n",
+        operation_err,
+        false
+    );
+}
+
+Test(VM, runArrayConcatNotArray, .init = cr_redirect_stderr) {
+    testRuntimeError(
+        "BUILDARR 2 0 LOAD_CONST 5 CONCAT HALT",
+        "Error: CONCAT expects an array operand\n",
+        operation_err,
+        false
+    );
+}
+
+Test(VM, runConcatNotStringOrArray, .init = cr_redirect_stderr) {
+    testRuntimeError(
+        "LOAD_CONST 5 LOAD_CONST 6 CONCAT HALT",
+        "Error: CONCAT expects string or array operands\n",
+        operation_err,
+        false
+    );
+}
+
 Test(VM, runArrayStoreOutOfRange, .init = cr_redirect_stderr) {
     testRuntimeError(
         "LOAD_CONST 1 LOAD_CONST 2 BUILDARR 2 2 LOAD_CONST 10 ASTORE HALT",
@@ -2284,4 +2005,123 @@ Test(VM, runArrayWritePastLength, .init = cr_redirect_stderr) {
         memory_err,
         false
     );
+}
+
+int tracedInstructions = 0;
+bool tracedHalt = false;
+
+void countTracedInstruction(UNUSED VM* vm, UNUSED Instruction* instr) {
+    tracedInstructions++;
+}
+
+void recordTracedHalt(UNUSED VM* vm) {
+    tracedHalt = true;
+}
+
+Test(VM, runWithTraceHooks) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {
+        "LOAD_CONST true POP HALT"
+    };
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+    TraceHooks hooks = {
+        .onInstruction = countTracedInstruction,
+        .onHalt = recordTracedHalt
+    };
+
+    VM* vm = init(src, getDefaultConfig());
+    vm->hooks = &hooks;
+    ExitCode status = run(vm, false);
+
+    cr_expect_eq(status, success);
+    cr_expect_eq(tracedInstructions, 3);
+    cr_expect(tracedHalt);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, runAdaptiveQuickening) {
+    char* labels[2] = {"add", "_entry"};
+    char* bodies[2] = {
+        "LOAD 0 LOAD 1 ADD RET",
+        "LOAD_CONST 1 LOAD_CONST 2 CALL add 2 LOAD_CONST 3 LOAD_CONST 4 CALL add 2 LT HALT"
+    };
+    int jumpCounts[2] = {0, 0};
+    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
+
+    VM* vm = init(src, getDefaultConfig());
+    ExitCode status = run(vm, false);
+
+    cr_expect_eq(status, success);
+    Frame* frame = vm->callStack[0];
+    cr_expect_eq(frame->sp, 0);
+    cr_expect(isEqual(frame->stack[0], createBoolean(true)));
+    cr_expect_eq(src->code[0].bytecode[4].opcode, ADD_INT_INT);
+    cr_expect_eq(src->code[1].bytecode[14].opcode, LT_INT_INT);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, runAdaptiveQuickening_deoptimize) {
+    char* labels[2] = {"add", "_entry"};
+    char* bodies[2] = {
+        "LOAD 0 LOAD 1 ADD RET",
+        "LOAD_CONST 1 LOAD_CONST 2 CALL add 2 LOAD_CONST 1.5 LOAD_CONST 2.5 CALL add 2 LOAD_CONST 0.5 LOAD_CONST 0.25 CALL add 2 HALT"
+    };
+    int jumpCounts[2] = {0, 0};
+    JumpPoint* jumps[2] = {(JumpPoint[]) {}, (JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 2);
+
+    VM* vm = init(src, getDefaultConfig());
+    ExitCode status = run(vm, false);
+
+    cr_expect_eq(status, success);
+    Frame* frame = vm->callStack[0];
+    cr_expect_eq(frame->sp, 2);
+    cr_expect(isEqual(frame->stack[0], createInt(3)));
+    cr_expect(isEqual(frame->stack[1], createDouble(4.0)));
+    cr_expect(isEqual(frame->stack[2], createDouble(0.75)));
+    // the int specialization deoptimized on the doubles and the next call specialized for doubles
+    cr_expect_eq(src->code[0].bytecode[4].opcode, ADD_DBL_DBL);
+    cr_expect_eq(src->code[0].bytecode[4].operands[1], 1);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, runAdaptiveQuickening_disabled) {
+    char* labels[1] = {"_entry"};
+    char* bodies[1] = {"LOAD_CONST 1 LOAD_CONST 2 ADD HALT"};
+    int jumpCounts[1] = {0};
+    JumpPoint* jumps[1] = {(JumpPoint[]) {}};
+    SourceCode* src = createSource(labels, bodies, jumpCounts, jumps, 1);
+    VMConfig conf = getDefaultConfig();
+    conf.adaptiveSpecializationEnabled = false;
+
+    VM* vm = init(src, conf);
+    ExitCode status = run(vm, false);
+
+    cr_expect_eq(status, success);
+    cr_expect(isEqual(vm->callStack[0]->stack[0], createInt(3)));
+    cr_expect_eq(src->code[0].bytecode[4].opcode, ADD);
+
+    destroy(vm);
+    cr_free(src);
+}
+
+Test(VM, quickenInstruction_maxDeoptimizations) {
+    Instruction instr = {ADD, 1, NO_OPERAND, {0, NO_OPERAND, NO_OPERAND}};
+    for (int i = 0; i < MAX_DEOPTIMIZATIONS; i++) {
+        quickenInstruction(&instr, Int);
+        cr_expect_eq(instr.opcode, ADD_INT_INT);
+        deoptimizeInstruction(&instr);
+        cr_expect_eq(instr.opcode, ADD);
+    }
+    quickenInstruction(&instr, Int);
+    cr_expect_eq(instr.opcode, ADD);
 }
\ No newline at end of file
@@ -15,6 +15,8 @@ SourceCode* createSource(char** labels, char** bodies, int* jumpCounts, JumpPoin
     SourceCode* src = cr_malloc(sizeof(SourceCode));
     SourceCode code;
     code.length = length;
+    code.loaded = false;
+    code.mapping = NULL;
 
     for (int i = 0; i < length; i++) {
         code.code[i].label = labels[i];
@@ -24,10 +26,30 @@ SourceCode* createSource(char** labels, char** bodies, int* jumpCounts, JumpPoin
             code.code[i].jumpPoints[j] = jumps[i][j];
         }
     }
-    src = &code;
+    *src = code;
     return src;
 }
 
+DataConstant createTestArray(int capacity, int length, DataConstant* elements) { // arrays normally come from allocateArray on a running VM
+    ArrayHeader* array = cr_malloc(sizeof(ArrayHeader));
+    array->capacity = capacity;
+    array->length = 0;
+    array->elementType = None;
+    array->holdsArrays = false;
+    array->marked = false;
+    array->next = NULL;
+    array->storage = cr_malloc(sizeof(ArrayStorage) + sizeof(DataConstant) * capacity);
+    array->storage->refs = 1;
+    for (int i = 0; i < capacity; i++) {
+        array->storage->values[i] = createNone();
+    }
+    for (int i = 0; i < length; i++) {
+        setArrayElement(array, i, elements[i]);
+        array->length++;
+    }
+    return createAddr(array);
+}
+
 void logStdout(FILE* stdout) {
     char buff[1024];
     while(fgets(buff, 1024, stdout)) {
@@ -2,9 +2,11 @@
 #define TEST_UTILS_H
 
 #include "../src/filereader.h"
+#include "../src/dataconstant.h"
 
 char* cr_strdup(const char* str);
 SourceCode* createSource(char** labels, char** bodies, int* jumpCounts, JumpPoint** jumps, int length);
+DataConstant createTestArray(int capacity, int length, DataConstant* elements);
 void logStdout(FILE* stdout);
 void logStderr(FILE* stderr);
 